@@ -0,0 +1,59 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef __GOODRACER_BUS_H__
+#define __GOODRACER_BUS_H__
+
+/* Single producer fan-out bus for consolidated fix records.
+ *
+ * The producer writes into a preallocated ring and every subscriber has its
+ * own cursor into it, like the LMAX Disruptor. Unlike the Disruptor the
+ * producer never waits for a subscriber: a subscriber that falls more than
+ * the ring capacity behind skips the records that got overwritten and
+ * counts them as dropped. Inline subscribers run on the producer's thread
+ * right after each publish, threaded subscribers run on a thread of their
+ * own and are woken up through an eventfd.
+ */
+#define GR_BUS_DEFAULT_CAPACITY 256
+#define GR_BUS_MAX_SUBSCRIBERS 8
+
+typedef struct {
+    gr_fix_t fix;
+    gr_lap_state_t lap;
+    int lap_events; /* GR_LAPTIMER_EVENT_* bitmask for this fix */
+} gr_bus_record_t;
+
+typedef void (* gr_bus_consumer_t)(const gr_bus_record_t *, void *arg);
+
+typedef struct {
+    uint64_t delivered;
+    uint64_t dropped; /* overwritten before the subscriber got to them */
+} gr_bus_stats_t;
+
+typedef struct gr_bus_t_ gr_bus_t;
+
+/* capacity is rounded up to a power of 2 */
+gr_bus_t *gr_bus_create(size_t capacity);
+
+/* stops and joins all the subscriber threads and frees the bus */
+void gr_bus_free(gr_bus_t *);
+
+/* called first thing on every subscriber thread, e.g. to set its
+ * scheduling. has to be set before the threaded subscribers are added */
+typedef void (* gr_bus_thread_init_t)(const char *name, void *arg);
+int gr_bus_set_thread_init(gr_bus_t *, gr_bus_thread_init_t cb, void *arg);
+
+/* returns the subscriber index or -1 on error. threaded subscribers start
+ * right away. without pthread support threaded subscribers run inline.
+ */
+int gr_bus_subscribe(gr_bus_t *, const char *name, gr_bus_consumer_t cb,
+                void *arg, bool threaded);
+
+/* copy the record into the ring and run the inline subscribers. never blocks */
+int gr_bus_publish(gr_bus_t *, const gr_bus_record_t *);
+
+int gr_bus_get_stats(const gr_bus_t *, int subscriber, gr_bus_stats_t *);
+
+#endif /* __GOODRACER_BUS_H__ */
@@ -0,0 +1,71 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef __GOODRACER_DISPLAY_H__
+#define __GOODRACER_DISPLAY_H__
+
+/* the UI always draws into the framebuffer of the display, the backend is
+ * only what the framebuffer is sent to. the I2C backend drives the SSD1306
+ * OLED, the virtual backend keeps a copy of the display RAM in memory and
+ * can dump every frame to a PBM file, so the render path can be run and
+ * checked on a machine without the hardware.
+ */
+typedef struct gr_disp_t_ gr_disp_t;
+
+typedef struct {
+    const char *name;
+    /* send the whole framebuffer */
+    int (*update)(gr_disp_t *);
+    /* send one 8 pixel high page of the framebuffer */
+    int (*update_page)(gr_disp_t *, uint8_t page);
+    /* optional, called once all the pages of a chunked frame are sent */
+    int (*frame_done)(gr_disp_t *);
+    int (*clear)(gr_disp_t *);
+    /* release the backend data */
+    void (*close)(gr_disp_t *);
+} gr_disp_backend_t;
+
+struct gr_disp_t_ {
+    const gr_disp_backend_t *backend;
+    void *backend_data; /* owned by the backend */
+    ssd1306_i2c_t *oled; /* NULL unless it is the I2C backend */
+    ssd1306_framebuffer_t *fbp;
+    gr_ui_t *ui; /* screens drawn into fbp, owned by the display */
+    volatile int _ref; //reference counting
+};
+
+/* create a display with a framebuffer of the given size for any backend.
+ * the backend data is closed with the display, also on failure */
+gr_disp_t *gr_display_create(const gr_disp_backend_t *backend, void *data,
+                    uint8_t width, uint8_t height);
+
+/* setup the I2C display for SSD1306 OLED display */
+gr_disp_t *gr_display_i2c_setup(const char *dev, uint8_t addr,
+                    uint8_t width, uint8_t height);
+
+/* queue the page writes on the I2C bus scheduler instead of writing them
+ * right away. the scheduler is run by the system */
+int gr_display_i2c_set_bus(gr_disp_t *, gr_i2cbus_t *);
+
+/* in-memory display. if dump_prefix is not NULL every frame is written to
+ * dump_prefixNNNNNN.pbm with the lit pixels in black */
+gr_disp_t *gr_display_virtual_setup(uint8_t width, uint8_t height,
+                    const char *dump_prefix);
+/* the display RAM of the virtual display in the SSD1306 page layout, which
+ * is what would be on the OLED. NULL for other backends */
+const uint8_t *gr_display_virtual_ram(const gr_disp_t *, size_t *len);
+uint64_t gr_display_virtual_frames(const gr_disp_t *);
+
+/* cleanup the display object */
+void gr_display_cleanup(gr_disp_t *);
+/* increment reference count */
+void gr_display_inc_ref(gr_disp_t *);
+
+int gr_display_update(gr_disp_t *);
+int gr_display_update_page(gr_disp_t *, uint8_t page);
+int gr_display_frame_done(gr_disp_t *);
+int gr_display_clear(gr_disp_t *);
+
+#endif /* __GOODRACER_DISPLAY_H__ */
@@ -0,0 +1,60 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef __GOODRACER_FIX_H__
+#define __GOODRACER_FIX_H__
+
+/* compact consolidated fix record.
+ * the GPS emits position and speed over different NMEA sentences, so the
+ * system merges every parsed sentence into one of these and all the
+ * consumers (lap timer, telemetry, etc.) work off of it instead of the
+ * parser's gpsdata_data_t.
+ */
+typedef struct {
+    uint64_t mono_ns; /* CLOCK_MONOTONIC time at which the fix was processed */
+    uint64_t rx_ns; /* CLOCK_MONOTONIC time the first byte of its epoch arrived, 0 if unknown */
+    int64_t utc_ms; /* GPS UTC time of day of the fix, -1 if unknown */
+    int32_t lat_e7; /* latitude in 1e-7 degrees, negative is south */
+    int32_t lon_e7; /* longitude in 1e-7 degrees, negative is west */
+    float speed_kmph; /* NAN if the GPS has not reported a speed yet */
+    uint32_t seq; /* incremented once per epoch, when it is complete */
+    uint8_t state; /* GR_FIX_STATE_* flags of the merge */
+} gr_fix_t;
+
+/* the position of a new epoch is in, its speed is not */
+#define GR_FIX_STATE_PENDING 0x01
+/* the GPS sends no speed after the position, so the position completes the
+ * epoch. cleared by the next speed */
+#define GR_FIX_STATE_NO_SPEED 0x02
+
+#define GR_FIX_HAS_POSITION(F) ((F)->seq > 0)
+
+/* read CLOCK_MONOTONIC in nanoseconds */
+uint64_t gr_monotonic_ns();
+
+/* reset the consolidated fix */
+void gr_fix_init(gr_fix_t *);
+
+/* merge the parsed GPS data item into the consolidated fix.
+ * an epoch starts with the first item whose position or UTC time is new, GGA
+ * on the MTK3339, and is complete once a speed is merged after it, from the
+ * RMC or VTG of the same epoch. returns 1 when the epoch is complete, so once
+ * per epoch with its own speed, 0 otherwise and -1 on error.
+ */
+int gr_fix_update(gr_fix_t *, const gpsdata_data_t *item, uint64_t mono_ns);
+
+/* UTC time of day in milliseconds from the time field of a raw GGA or RMC
+ * sentence, from any talker. returns -1 for other sentences or if the time
+ * field is empty.
+ */
+int64_t gr_nmea_utc_ms(const char *sentence, size_t len);
+
+#define GR_FIX_MS_PER_DAY 86400000LL
+
+/* convert decimal degrees to and from the 1e-7 degree fixed point */
+#define GR_FIX_DEG_TO_E7(D) ((int32_t)lround((D) * 1e7))
+#define GR_FIX_E7_TO_DEG(E) ((double)(E) / 1e7)
+
+#endif /* __GOODRACER_FIX_H__ */
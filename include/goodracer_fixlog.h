@@ -0,0 +1,54 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef __GOODRACER_FIXLOG_H__
+#define __GOODRACER_FIXLOG_H__
+
+/* binary fix log. a 16 byte header followed by fixed size records, all in
+ * the byte order of the machine that wrote it, which in practice is always
+ * little-endian (ARM/x86).
+ *   header: 8 bytes GR_FIXLOG_MAGIC | u32 version | u32 record size
+ *   record: gr_fixlog_record_t
+ * version 2 added rx_ns and utc_ms. version 1 logs, which have neither, are
+ * still read.
+ */
+#define GR_FIXLOG_MAGIC "GRFIXLOG"
+#define GR_FIXLOG_VERSION 2
+
+typedef struct {
+    uint64_t mono_ns;
+    uint64_t rx_ns; /* 0 if unknown */
+    int64_t utc_ms; /* -1 if unknown */
+    int32_t lat_e7;
+    int32_t lon_e7;
+    float speed_kmph;
+    uint32_t seq;
+} gr_fixlog_record_t;
+
+typedef struct {
+    uint64_t mono_ns;
+    int32_t lat_e7;
+    int32_t lon_e7;
+    float speed_kmph;
+    uint32_t seq;
+} gr_fixlog_record_v1_t;
+
+typedef struct gr_fixlog_t_ gr_fixlog_t;
+
+/* open a log for writing, truncating any existing file */
+gr_fixlog_t *gr_fixlog_open(const char *path);
+
+/* buffered, flushed every few seconds worth of fixes */
+int gr_fixlog_write(gr_fixlog_t *, const gr_fix_t *);
+
+void gr_fixlog_close(gr_fixlog_t *);
+
+/* returns true if the file starts with a fix log header */
+bool gr_fixlog_is_fixlog(const char *path);
+
+/* read a whole fix log into memory. *fixes must be freed by the caller */
+int gr_fixlog_read_all(const char *path, gr_fix_t **fixes, size_t *num);
+
+#endif /* __GOODRACER_FIXLOG_H__ */
@@ -0,0 +1,84 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef __GOODRACER_HISTORY_H__
+#define __GOODRACER_HISTORY_H__
+
+/* session history of fixed size for endurance races.
+ *
+ * the positions of the lap in progress and the last few laps are kept at
+ * full resolution in the first tier. when it fills up, its oldest lap moves to
+ * the next tier with only every GR_HISTORY_DECIMATION-th point, and the
+ * oldest lap of the last tier loses its points. the summary of a lap, its
+ * time and splits, outlives its points until the summary slots run out too.
+ * the best lap is copied in full resolution when it is set and the best
+ * sectors are tracked with the lap they were driven in, so both are there
+ * no matter how long ago they happened. all the memory is allocated at
+ * create and split between the parts by a fixed ratio.
+ */
+#define GR_HISTORY_MIN_BYTES (16 * 1024)
+#define GR_HISTORY_TIERS 3
+#define GR_HISTORY_DECIMATION 4
+
+typedef struct {
+    uint32_t t_ms; /* since the start of the lap */
+    int32_t lat_e7;
+    int32_t lon_e7;
+    float speed_kmph;
+} gr_history_point_t;
+
+typedef struct {
+    uint32_t lap; /* lap number, 1 is the first lap after the start */
+    uint32_t lap_ms; /* 0 while in progress or if it was never finished */
+    uint32_t sector_ms[GR_LAPTIMER_MAX_GATES];
+    uint8_t num_sectors;
+    uint8_t tier; /* GR_HISTORY_TIERS once the points are gone */
+    uint32_t stride; /* fixes per point kept */
+    size_t num_points;
+} gr_history_lap_t;
+
+typedef struct {
+    size_t max_bytes;
+    size_t used_bytes; /* allocated, never more than max_bytes */
+    size_t lap_slots;
+    size_t best_points; /* capacity of the best lap copy */
+    size_t tier_points[GR_HISTORY_TIERS]; /* capacity */
+    size_t tier_used[GR_HISTORY_TIERS];
+    size_t tier_laps[GR_HISTORY_TIERS];
+    uint64_t fixes;
+    uint32_t laps;
+    uint32_t demoted[GR_HISTORY_TIERS]; /* laps moved out of each tier */
+    uint32_t forgotten; /* lap summaries dropped */
+    uint32_t decimated; /* times the lap in progress was thinned out */
+} gr_history_stats_t;
+
+typedef struct gr_history_t_ gr_history_t;
+
+/* max_bytes covers everything, including the object itself */
+gr_history_t *gr_history_create(size_t max_bytes);
+void gr_history_free(gr_history_t *);
+
+/* feed every fix with the lap state and the lap timer events it caused.
+ * nothing is kept until the lap timer has started */
+int gr_history_update(gr_history_t *, const gr_fix_t *, const gr_lap_state_t *,
+                int events);
+
+/* laps whose summary is still kept, including the one in progress. index 0
+ * is the newest */
+size_t gr_history_num_laps(const gr_history_t *);
+const gr_history_lap_t *gr_history_lap(const gr_history_t *, size_t idx);
+/* copy out the points of a lap, returns the number copied */
+size_t gr_history_lap_points(const gr_history_t *, size_t idx,
+                gr_history_point_t *points, size_t max);
+
+/* NULL if no lap has been completed */
+const gr_history_lap_t *gr_history_best_lap(const gr_history_t *);
+const gr_history_point_t *gr_history_best_points(const gr_history_t *, size_t *num);
+/* 0 if the sector has not been timed. lap may be NULL */
+uint32_t gr_history_best_sector(const gr_history_t *, uint8_t sector, uint32_t *lap);
+
+int gr_history_get_stats(const gr_history_t *, gr_history_stats_t *);
+
+#endif /* __GOODRACER_HISTORY_H__ */
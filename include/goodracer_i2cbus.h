@@ -0,0 +1,87 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef __GOODRACER_I2CBUS_H__
+#define __GOODRACER_I2CBUS_H__
+
+/* I2C transaction scheduler.
+ *
+ * all the users of an I2C bus queue their transactions here instead of
+ * writing to the bus themselves. a transaction is a write followed by an
+ * optional read with a repeated start, which is a register read for most
+ * sensors, and it is never split. the queue is run from the event loop one
+ * transaction at a time in order of priority, then deadline, then arrival,
+ * so a sensor read queued behind a display frame goes out right after the
+ * display page that is on the bus. a transaction with a tag replaces the
+ * queued one of the same device and tag, so a display page drawn again
+ * before it was sent is only sent once.
+ */
+#define GR_I2CBUS_QUEUE_SIZE 64
+#define GR_I2CBUS_MAX_DEVICES 8
+#define GR_I2CBUS_MAX_WRITE 272
+#define GR_I2CBUS_MAX_READ 32
+
+typedef enum {
+    GR_I2CBUS_PRIO_SENSOR = 0,
+    GR_I2CBUS_PRIO_CONTROL,
+    GR_I2CBUS_PRIO_DISPLAY
+} gr_i2cbus_prio_t;
+
+/* rc is 0 or -1, rbuf has rlen bytes read on success */
+typedef void (* gr_i2cbus_done_t)(int rc, const uint8_t *rbuf, size_t rlen, void *arg);
+
+typedef struct {
+    uint8_t addr; /* 7-bit device address */
+    gr_i2cbus_prio_t priority;
+    uint64_t deadline_ns; /* monotonic, 0 for none */
+    uint32_t tag; /* 0 never replaces a queued transaction */
+    const uint8_t *wbuf; /* copied on submit */
+    size_t wlen;
+    size_t rlen;
+    gr_i2cbus_done_t cb; /* may be NULL */
+    void *arg;
+} gr_i2cbus_txn_t;
+
+typedef struct gr_i2cbus_t_ gr_i2cbus_t;
+
+/* the Linux I2C adapter, e.g. /dev/i2c-1. needs I2C_FUNC_I2C, so the
+ * SMBus-only i2c-stub driver is not enough for it */
+gr_i2cbus_t *gr_i2cbus_setup(const char *dev);
+
+/* simulated bus of the given clock that takes as long as the real one would.
+ * every device added has 256 byte registers, the first byte written is the
+ * register address and the rest are written to the registers from there.
+ * reads continue from the last register address. transactions to devices
+ * not added fail like a NACK */
+gr_i2cbus_t *gr_i2cbus_mock_setup(uint32_t clock_hz);
+int gr_i2cbus_mock_add_device(gr_i2cbus_t *, uint8_t addr);
+const uint8_t *gr_i2cbus_mock_registers(const gr_i2cbus_t *, uint8_t addr);
+
+void gr_i2cbus_cleanup(gr_i2cbus_t *);
+void gr_i2cbus_inc_ref(gr_i2cbus_t *);
+
+/* never blocks. returns -1 if the queue is full */
+int gr_i2cbus_submit(gr_i2cbus_t *, const gr_i2cbus_txn_t *);
+size_t gr_i2cbus_pending(const gr_i2cbus_t *);
+
+/* run queued transactions until the queue is empty or budget_ns is used up,
+ * at least one if any are queued. returns the number run */
+int gr_i2cbus_run(gr_i2cbus_t *, uint64_t budget_ns);
+
+typedef struct {
+    uint64_t transactions;
+    uint64_t bytes;
+    uint64_t errors;
+    uint64_t superseded; /* replaced by a newer one with the same tag */
+    uint64_t deadline_misses; /* started after the deadline */
+    uint64_t bus_ns; /* total time on the bus */
+    uint64_t max_txn_ns;
+    uint64_t max_wait_ns; /* from submit to start */
+} gr_i2cbus_stats_t;
+
+/* per device statistics, -1 if nothing was ever queued for addr */
+int gr_i2cbus_get_stats(const gr_i2cbus_t *, uint8_t addr, gr_i2cbus_stats_t *);
+
+#endif /* __GOODRACER_I2CBUS_H__ */
@@ -0,0 +1,69 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef __GOODRACER_LAPTIMER_H__
+#define __GOODRACER_LAPTIMER_H__
+
+#define GR_LAPTIMER_MAX_GATES 8
+
+/* a timing gate is a line segment across the track. gate 0 is always the
+ * start/finish line and the rest are the sector splits in track order.
+ */
+typedef struct {
+    int32_t lat1_e7;
+    int32_t lon1_e7;
+    int32_t lat2_e7;
+    int32_t lon2_e7;
+} gr_gate_t;
+
+typedef struct {
+    uint32_t lap; /* number of completed laps */
+    bool started; /* start/finish line has been crossed at least once */
+    uint8_t sector; /* sector the car is in, 0 based */
+    uint8_t num_sectors; /* same as the number of gates */
+    uint64_t lap_start_ns; /* monotonic time of the current lap start */
+    uint64_t sector_start_ns; /* monotonic time of the current sector start */
+    uint32_t last_lap_ms; /* 0 if no lap completed */
+    uint32_t best_lap_ms; /* 0 if no lap completed */
+    uint32_t best_lap; /* lap number of the best lap */
+    uint32_t sector_ms[GR_LAPTIMER_MAX_GATES]; /* splits of the current or last lap */
+    uint32_t best_sector_ms[GR_LAPTIMER_MAX_GATES]; /* 0 if not yet timed */
+} gr_lap_state_t;
+
+/* events returned by gr_laptimer_update() */
+#define GR_LAPTIMER_EVENT_NONE 0x0
+#define GR_LAPTIMER_EVENT_SECTOR 0x1
+#define GR_LAPTIMER_EVENT_LAP 0x2
+#define GR_LAPTIMER_EVENT_START 0x4
+
+typedef struct gr_laptimer_t_ gr_laptimer_t;
+
+gr_laptimer_t *gr_laptimer_create();
+
+void gr_laptimer_free(gr_laptimer_t *);
+
+/* add gates in track order. the first gate added is the start/finish line */
+int gr_laptimer_add_gate(gr_laptimer_t *, const gr_gate_t *);
+
+size_t gr_laptimer_num_gates(const gr_laptimer_t *);
+
+/* forget all laps and go back to waiting for the start/finish line */
+void gr_laptimer_reset(gr_laptimer_t *);
+
+/* feed a fix to the lap timer. the crossing time is interpolated between the
+ * previous fix and this one. returns a bitmask of GR_LAPTIMER_EVENT_* values
+ * or -1 on error.
+ */
+int gr_laptimer_update(gr_laptimer_t *, const gr_fix_t *);
+
+const gr_lap_state_t *gr_laptimer_state(const gr_laptimer_t *);
+
+/* milliseconds elapsed in the current lap at monotonic time now_ns */
+uint32_t gr_lap_state_elapsed_ms(const gr_lap_state_t *, uint64_t now_ns);
+
+/* parse a gate given as "lat1,lon1,lat2,lon2" in decimal degrees */
+int gr_gate_parse(const char *str, gr_gate_t *gate);
+
+#endif /* __GOODRACER_LAPTIMER_H__ */
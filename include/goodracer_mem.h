@@ -0,0 +1,49 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef __GOODRACER_MEM_H__
+#define __GOODRACER_MEM_H__
+
+/* memory for all GoodRacer objects goes through these.
+ * by default they are calloc/free. in arena mode, which is meant for the low
+ * RAM boards, everything comes out of a single block of a fixed budget
+ * allocated at startup and nothing is ever returned to the heap, so a long
+ * session cannot fragment it. in both modes any allocation made through
+ * these while the event loop is running is counted. allocations that
+ * libraries make with malloc() themselves are neither in the arena nor
+ * counted.
+ */
+void *gr_mem_calloc(size_t num, size_t size);
+void *gr_mem_realloc(void *ptr, size_t size);
+char *gr_mem_strdup(const char *s);
+/* memory from the arena is released with the arena, this is a no-op for it */
+void gr_mem_free(void *ptr);
+
+typedef struct {
+    size_t budget; /* 0 if not in arena mode */
+    size_t used;
+    uint64_t arena_allocs;
+    uint64_t heap_allocs;
+    uint64_t failed; /* requests over the budget */
+    uint64_t running_allocs; /* made while the event loop was running */
+    int64_t running_heap_growth; /* change in process heap use since run start, INT64_MIN if unknown */
+} gr_mem_stats_t;
+
+/* switch to arena mode with a budget in bytes. has to be called before any
+ * object is created and cannot be undone until gr_mem_arena_cleanup().
+ */
+int gr_mem_arena_setup(size_t budget);
+/* only after everything allocated from the arena has been freed */
+void gr_mem_arena_cleanup();
+bool gr_mem_arena_enabled();
+
+/* marks the start and end of gr_system_run() */
+void gr_mem_set_running(bool flag);
+void gr_mem_get_stats(gr_mem_stats_t *);
+
+#define GR_CALLOC gr_mem_calloc
+#define GR_STRDUP gr_mem_strdup
+
+#endif /* __GOODRACER_MEM_H__ */
@@ -0,0 +1,46 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef __GOODRACER_RT_H__
+#define __GOODRACER_RT_H__
+
+/* real-time mode for a car computer that is busy with other work.
+ * the memory of the process is locked and the stack prefaulted so the event
+ * loop never waits on a page fault, and the event loop thread runs under
+ * SCHED_FIFO, optionally pinned to a CPU. helper threads such as the fix
+ * logger run one priority below the event loop on the same CPU. all of it
+ * needs CAP_SYS_NICE and CAP_IPC_LOCK or a suitable RLIMIT_RTPRIO and
+ * RLIMIT_MEMLOCK, and whatever does not take effect is reported and
+ * otherwise ignored.
+ */
+#define GR_RT_STACK_PREFAULT (256 * 1024)
+
+typedef struct {
+    bool lock_memory;
+    int priority; /* SCHED_FIFO priority 1-99, 0 to leave the scheduling alone */
+    int cpu; /* -1 to leave the affinity alone */
+} gr_rt_config_t;
+
+typedef struct {
+    bool memory_locked;
+    size_t locked_kb; /* VmLck of the process, 0 if unknown */
+    bool fifo;
+    int priority;
+    bool pinned; /* runs only on the requested CPU */
+    long minor_faults; /* of the process so far, -1 if unknown */
+    long major_faults;
+} gr_rt_report_t;
+
+/* lock the memory and set up the calling thread as the event loop thread */
+int gr_rt_setup(const gr_rt_config_t *);
+/* for helper threads, called from the thread itself */
+int gr_rt_setup_helper(const gr_rt_config_t *, const char *name);
+
+/* read back what is in effect for the calling thread. returns -1 if anything
+ * that was asked for did not take effect */
+int gr_rt_check(const gr_rt_config_t *, gr_rt_report_t *);
+void gr_rt_log_report(const gr_rt_config_t *, const gr_rt_report_t *);
+
+#endif /* __GOODRACER_RT_H__ */
@@ -0,0 +1,106 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef __GOODRACER_SHM_H__
+#define __GOODRACER_SHM_H__
+
+/* GoodRacer publishes its latest state into a POSIX shared memory segment
+ * protected by a seqlock. There is one writer, the goodracer process, and any
+ * number of readers. Readers never block the writer and never make a system
+ * call once the segment is mapped; they retry if they raced with a write.
+ *
+ * gr_shm_read() is inline so a reader that maps the segment itself with
+ * shm_open() and mmap(PROT_READ) only needs this header. Otherwise:
+ *   gr_shm_layout_t *lay = gr_shm_reader_open("/goodracer");
+ *   gr_shm_state_t st;
+ *   if (gr_shm_read(lay, &st) == 0) { ... }
+ *   gr_shm_reader_close(lay);
+ *
+ * Readers must check that the magic, version and state size match before
+ * trusting the layout. Any change to gr_shm_state_t requires bumping
+ * GR_SHM_VERSION.
+ */
+#define GR_SHM_MAGIC 0x47525348 /* GRSH */
+#define GR_SHM_VERSION 2
+#define GR_SHM_DEFAULT_NAME "/goodracer"
+#define GR_SHM_MAX_SECTORS 8
+#define GR_SHM_READ_RETRIES 1000
+
+typedef struct {
+    uint64_t publish_ns; /* CLOCK_MONOTONIC time of the last publish */
+    /* position */
+    uint64_t fix_ns; /* CLOCK_MONOTONIC time of the fix */
+    uint64_t fix_rx_ns; /* CLOCK_MONOTONIC time its first byte arrived, 0 if unknown */
+    int64_t fix_utc_ms; /* GPS UTC time of day of the fix, -1 if unknown */
+    uint32_t fix_seq;
+    int32_t lat_e7;
+    int32_t lon_e7;
+    float speed_kmph; /* NAN if unknown */
+    /* lap state */
+    uint32_t lap;
+    uint8_t started;
+    uint8_t sector;
+    uint8_t num_sectors;
+    uint8_t _pad;
+    uint64_t lap_start_ns;
+    uint32_t last_lap_ms;
+    uint32_t best_lap_ms;
+    uint32_t sector_ms[GR_SHM_MAX_SECTORS];
+    uint32_t best_sector_ms[GR_SHM_MAX_SECTORS];
+} gr_shm_state_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size; /* offset of the state from the start */
+    uint32_t state_size;
+    int32_t writer_pid; /* 0 once the writer has exited */
+    uint32_t seq; /* seqlock counter, odd while a write is in progress */
+    uint32_t _pad;
+    gr_shm_state_t state;
+} gr_shm_layout_t;
+
+/* take a consistent snapshot of the state. returns 0 on success and -1 if
+ * the layout does not match or the writer kept the lock for too long.
+ */
+static inline int gr_shm_read(const gr_shm_layout_t *lay, gr_shm_state_t *out)
+{
+    if (!lay || !out)
+        return -1;
+    if (lay->magic != GR_SHM_MAGIC || lay->version != GR_SHM_VERSION ||
+        lay->state_size != sizeof(gr_shm_state_t))
+        return -1;
+    for (int i = 0; i < GR_SHM_READ_RETRIES; ++i) {
+        uint32_t s1 = __atomic_load_n(&(lay->seq), __ATOMIC_ACQUIRE);
+        if (s1 & 1)
+            continue;
+        memcpy(out, (const void *)&(lay->state), sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint32_t s2 = __atomic_load_n(&(lay->seq), __ATOMIC_RELAXED);
+        if (s1 == s2)
+            return 0;
+    }
+    return -1;
+}
+
+/* map an existing segment read-only. returns NULL on error */
+gr_shm_layout_t *gr_shm_reader_open(const char *name);
+void gr_shm_reader_close(gr_shm_layout_t *);
+
+/* opaque writer object */
+typedef struct gr_shm_t_ gr_shm_t;
+
+/* create or take over the named segment. name must start with a '/' */
+gr_shm_t *gr_shm_setup(const char *name);
+
+void gr_shm_cleanup(gr_shm_t *);
+
+void gr_shm_inc_ref(gr_shm_t *);
+
+/* publish the latest fix and lap state. lap may be NULL */
+int gr_shm_publish(gr_shm_t *, const gr_fix_t *, const gr_lap_state_t *lap,
+                uint64_t now_ns);
+
+#endif /* __GOODRACER_SHM_H__ */
@@ -9,9 +9,12 @@
 /* opaque system structure */
 typedef struct gr_sys_t_ gr_sys_t;
 
-/* setup the system event loop and default handlers
+/* setup the system event loop and default handlers. with a real-time
+ * configuration the calling thread, which has to be the one that runs the
+ * event loop, and the bus subscriber threads are set up for it and what took
+ * effect is logged. NULL leaves everything as it is.
  */
-gr_sys_t *gr_system_setup();
+gr_sys_t *gr_system_setup(const gr_rt_config_t *rt);
 
 /* cleanup the system event loop and handlers */
 void gr_system_cleanup(gr_sys_t *);
@@ -23,28 +26,41 @@ int gr_system_run(gr_sys_t *);
 void gr_system_set_verbose(gr_sys_t *, bool);
 bool gr_system_is_verbose(const gr_sys_t *);
 
-/* display related functions */
-typedef struct gr_disp_t_ {
-    ssd1306_i2c_t *oled;
-    ssd1306_framebuffer_t *fbp;
-    volatile int _ref; //reference counting
-} gr_disp_t;
-
-/* setup the I2C display for SSD1306 OLED display */
-gr_disp_t *gr_display_i2c_setup(const char *dev, uint8_t addr,
-                    uint8_t width, uint8_t height);
-
-/* cleanup the display object */
-void gr_display_cleanup(gr_disp_t *);
-/* increment reference count */
-void gr_display_inc_ref(gr_disp_t *);
+/* run the I2C bus scheduler from the event loop for up to budget_us per
+ * loop iteration. the display and any sensors on the bus queue their
+ * transactions on it */
+int gr_system_set_i2cbus(gr_sys_t *, gr_i2cbus_t *, uint32_t budget_us);
+gr_i2cbus_t *gr_system_get_i2cbus(const gr_sys_t *);
 
 /* opaque GPS struct */
 typedef struct gr_gps_t_ gr_gps_t;
 
-/* tell the system about the display */
+/* tell the system about the display. SIGUSR1 switches to the next screen
+ * of its UI */
 int gr_system_set_display(gr_sys_t *, gr_disp_t *, bool);
 
+/* send what the UI drew to the display. by default the whole framebuffer is
+ * written in one blocking I2C transfer. with chunked transfers only the
+ * pages drawn since the last update are queued, and at most pages_per_iter of
+ * them are written from an idle watcher in each event loop iteration, so a
+ * GPS read is never stuck behind a full frame. a new update supersedes the
+ * queued pages of the previous one and they are sent from the newer
+ * framebuffer. pages_per_iter of 0 goes back to whole frames.
+ */
+int gr_system_update_display(gr_sys_t *);
+int gr_system_set_display_chunked(gr_sys_t *, uint8_t pages_per_iter);
+
+typedef struct {
+    uint64_t frames;
+    uint64_t superseded; /* frames queued before the previous one was sent */
+    uint64_t pages_sent;
+    uint64_t errors;
+    uint64_t io_ns; /* total time spent writing to the display */
+    uint64_t max_iter_ns; /* worst display I/O in a single loop iteration */
+} gr_display_stats_t;
+
+int gr_system_get_display_stats(const gr_sys_t *, gr_display_stats_t *);
+
 gr_gps_t *gr_gps_setup(const char *dev, uint32_t baud_rate);
 
 void gr_gps_cleanup(gr_gps_t *);
@@ -57,4 +73,131 @@ int gr_system_watch_gps(gr_sys_t *sys, gr_gps_t *gps,
             gr_gps_on_error_t err_cb /* callback called when error in reading data from GPS */
             );
 
+/* the GPS is reopened and reconfigured with exponential backoff whenever it
+ * fails or goes silent. the gap is from the last data received before the
+ * outage to the first data parsed after the reopen, which is how long the
+ * system went without fixes. the recovery time is from the detected failure
+ * to the same point, and leaves out the time it took to detect it.
+ */
+typedef struct {
+    uint32_t disconnects;
+    uint32_t reconnects;
+    uint32_t attempts; /* reopen attempts across all outages */
+    uint32_t last_gap_ms;
+    uint32_t max_gap_ms;
+    uint32_t last_recovery_ms;
+    uint32_t max_recovery_ms;
+} gr_gps_stats_t;
+
+int gr_system_get_gps_stats(const gr_sys_t *, gr_gps_stats_t *);
+
+/* every read from the GPS is stamped with CLOCK_MONOTONIC, corrected for
+ * the bytes still in flight at the baud rate, and the first byte of each
+ * epoch is matched with the UTC time in its GGA or RMC sentence. the offset
+ * between the two clocks is the smallest difference seen over the last
+ * GR_GPS_TIMING_WINDOW epochs, since the transport can only add delay.
+ * it includes the fixed output latency of the GPS itself, which cannot be
+ * seen without the PPS signal.
+ */
+#define GR_GPS_TIMING_WINDOW 32
+
+typedef struct {
+    bool valid; /* at least one epoch has been seen */
+    int64_t offset_ns; /* CLOCK_MONOTONIC minus GPS UTC */
+    uint64_t epochs;
+    uint64_t last_jitter_ns; /* arrival of the last epoch later than the offset */
+    uint64_t max_jitter_ns;
+    uint64_t last_delay_ns; /* from arrival to the fix being processed */
+    uint64_t avg_delay_ns;
+    uint64_t max_delay_ns;
+} gr_gps_timing_t;
+
+int gr_system_get_gps_timing(const gr_sys_t *, gr_gps_timing_t *);
+/* CLOCK_MONOTONIC time of a GPS UTC time of day near the current one, or 0
+ * if the offset is not known yet */
+uint64_t gr_system_gps_utc_to_mono(const gr_sys_t *, int64_t utc_ms);
+
+/* power saving while the car is stationary. below idle_below_kmph for
+ * idle_after_ms the GPS is told to fix less often with PMTK300/PMTK220, the
+ * display is refreshed at most every idle_display_ms and the event loop
+ * collects I/O for a while before waking up, so one wakeup reads a whole
+ * burst of sentences. the first speed above active_above_kmph, from any
+ * sentence that carries one, puts everything back right away, before the
+ * epoch it belongs to is published. the fix interval is re-applied when the
+ * GPS is reconnected.
+ */
+typedef enum {
+    GR_POWER_MODE_ACTIVE = 0,
+    GR_POWER_MODE_IDLE,
+    GR_POWER_MODE_MAX
+} gr_power_mode_t;
+
+#define GR_POWER_IDLE_BELOW_KMPH 3.0f
+#define GR_POWER_IDLE_AFTER_MS 30000
+#define GR_POWER_ACTIVE_ABOVE_KMPH 6.0f
+#define GR_POWER_ACTIVE_FIX_MS 1000
+#define GR_POWER_IDLE_FIX_MS 5000
+#define GR_POWER_IDLE_DISPLAY_MS 2000
+#define GR_POWER_IDLE_COLLECT_MS 50
+
+typedef struct {
+    float idle_below_kmph;
+    uint32_t idle_after_ms;
+    float active_above_kmph;
+    uint16_t active_fix_ms; /* GPS fix interval, 100 - 10000 */
+    uint16_t idle_fix_ms;
+    uint32_t idle_display_ms;
+    uint32_t idle_collect_ms; /* how long the loop waits to collect I/O */
+} gr_power_config_t;
+
+void gr_power_config_init(gr_power_config_t *);
+
+typedef struct {
+    uint64_t time_ns; /* spent in the mode */
+    uint64_t wakeups; /* event loop iterations */
+    uint64_t busy_ns; /* from wakeup to going back to sleep */
+    uint64_t fixes;
+    uint64_t display_frames;
+    uint32_t entered;
+} gr_power_mode_stats_t;
+
+typedef struct {
+    gr_power_mode_t mode;
+    gr_power_mode_stats_t modes[GR_POWER_MODE_MAX];
+} gr_power_stats_t;
+
+int gr_system_set_power(gr_sys_t *, const gr_power_config_t *);
+gr_power_mode_t gr_system_get_power_mode(const gr_sys_t *);
+/* the time in the current mode is counted up to now */
+int gr_system_get_power_stats(const gr_sys_t *, gr_power_stats_t *);
+/* whether the display should be drawn now. always true unless stationary */
+bool gr_system_display_due(const gr_sys_t *, uint64_t now_ns);
+
+/* add a timing gate to the system lap timer. the first gate added is the
+ * start/finish line and the rest are sector splits in track order */
+int gr_system_add_gate(gr_sys_t *, const gr_gate_t *);
+
+/* latest consolidated fix and lap state */
+const gr_fix_t *gr_system_get_fix(const gr_sys_t *);
+const gr_lap_state_t *gr_system_get_lap_state(const gr_sys_t *);
+
+/* subscribe to the consolidated fix records. inline consumers run on the
+ * event loop right after a fix is processed, threaded consumers run on their
+ * own thread and skip records if they fall too far behind, so they can never
+ * hold up the GPS processing. returns the subscriber index or -1 on error.
+ */
+int gr_system_subscribe(gr_sys_t *, const char *name, gr_bus_consumer_t cb,
+                void *arg, bool threaded);
+
+/* stream the consolidated state to the pit over UDP */
+int gr_system_set_telemetry(gr_sys_t *, gr_telemetry_t *);
+
+/* publish the consolidated state to local processes via shared memory */
+int gr_system_set_shm(gr_sys_t *, gr_shm_t *);
+
+/* keep the laps of the session in at most max_bytes of memory */
+int gr_system_set_history(gr_sys_t *, size_t max_bytes);
+/* NULL if not set. it is fed on the event loop, so read it only there */
+const gr_history_t *gr_system_get_history(const gr_sys_t *);
+
 #endif /* __GOODRACER_SYSTEM_H__ */
@@ -0,0 +1,86 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef __GOODRACER_TELEMETRY_H__
+#define __GOODRACER_TELEMETRY_H__
+
+/* Telemetry datagram format, all integers in network byte order:
+ *
+ *  header (32 bytes):
+ *   u32 magic (GR_TELEMETRY_MAGIC) | u8 version | u8 num fixes | u16 flags
+ *   u32 packet sequence
+ *   u32 completed laps | u32 current lap elapsed ms
+ *   u32 last lap ms | u32 best lap ms
+ *   u8 sector | u8 num sectors | u16 reserved
+ *  first fix (18 bytes):
+ *   u32 monotonic ms | u32 fix seq | i32 lat 1e-7 deg | i32 lon 1e-7 deg
+ *   u16 speed in 0.01 kmph (0xFFFF is unknown)
+ *  every other fix, as zig-zag varints relative to the previous fix:
+ *   monotonic ms | fix seq | lat | lon | speed
+ */
+#define GR_TELEMETRY_MAGIC 0x47525431 /* GRT1 */
+#define GR_TELEMETRY_VERSION 1
+#define GR_TELEMETRY_HEADER_SIZE 32
+#define GR_TELEMETRY_FIX_SIZE 18
+#define GR_TELEMETRY_PACKET_MAX 512
+#define GR_TELEMETRY_BATCH_MAX 32
+#define GR_TELEMETRY_SPEED_UNKNOWN 0xFFFF
+
+typedef struct {
+    uint8_t version;
+    uint8_t num_fixes;
+    uint16_t flags;
+    uint32_t seq;
+    uint32_t lap;
+    uint32_t lap_elapsed_ms;
+    uint32_t last_lap_ms;
+    uint32_t best_lap_ms;
+    uint8_t sector;
+    uint8_t num_sectors;
+} gr_telemetry_header_t;
+
+/* decodes a datagram into the header and up to max_fixes fixes. the
+ * monotonic time in the decoded fixes has millisecond resolution.
+ * returns the number of fixes decoded or -1 on a malformed packet.
+ */
+int gr_telemetry_decode(const uint8_t *buf, size_t len,
+                gr_telemetry_header_t *hdr, gr_fix_t *fixes, size_t max_fixes);
+
+/* opaque telemetry publisher */
+typedef struct gr_telemetry_t_ gr_telemetry_t;
+
+/* dest is "host:port" or "[ipv6]:port". multicast destinations are detected
+ * automatically. max_pps caps the packets per second and batch is the max
+ * number of fixes per packet.
+ */
+gr_telemetry_t *gr_telemetry_setup(const char *dest, uint32_t max_pps,
+                        uint8_t batch);
+
+void gr_telemetry_cleanup(gr_telemetry_t *);
+
+void gr_telemetry_inc_ref(gr_telemetry_t *);
+
+/* interval in seconds at which gr_telemetry_flush() should be called */
+double gr_telemetry_interval(const gr_telemetry_t *);
+
+/* queue a fix for sending. never blocks. lap may be NULL */
+int gr_telemetry_push(gr_telemetry_t *, const gr_fix_t *, const gr_lap_state_t *lap);
+
+/* send whatever the rate cap allows using a single non-blocking sendmmsg()
+ * and return the number of packets sent or -1 on error.
+ */
+int gr_telemetry_flush(gr_telemetry_t *, uint64_t now_ns);
+
+typedef struct {
+    uint64_t packets_sent;
+    uint64_t fixes_sent;
+    uint64_t bytes_sent;
+    uint64_t packets_dropped; /* dropped because the send queue was full */
+    uint64_t send_errors;
+} gr_telemetry_stats_t;
+
+void gr_telemetry_get_stats(const gr_telemetry_t *, gr_telemetry_stats_t *);
+
+#endif /* __GOODRACER_TELEMETRY_H__ */
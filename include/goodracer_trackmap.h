@@ -0,0 +1,47 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef __GOODRACER_TRACKMAP_H__
+#define __GOODRACER_TRACKMAP_H__
+
+/* track outline for the minimap.
+ * positions are collected, either from a fix log or while driving the first
+ * lap, and then built once: projected to meters around the track center and
+ * simplified down to the points that matter at display resolution. the UI
+ * rasterizes the built outline into a cached bitmap of its own size.
+ */
+#define GR_TRACKMAP_DEFAULT_POINTS 4096
+
+typedef struct gr_trackmap_t_ gr_trackmap_t;
+
+/* all the memory is allocated here, so collecting never allocates */
+gr_trackmap_t *gr_trackmap_create(size_t max_points);
+void gr_trackmap_free(gr_trackmap_t *);
+
+/* points closer than a couple of meters to the previous one are skipped.
+ * returns -1 once full or after the map is built */
+int gr_trackmap_add_point(gr_trackmap_t *, int32_t lat_e7, int32_t lon_e7);
+size_t gr_trackmap_num_points(const gr_trackmap_t *);
+
+/* project and simplify the collected points */
+int gr_trackmap_build(gr_trackmap_t *);
+bool gr_trackmap_is_built(const gr_trackmap_t *);
+
+/* collect all the positions of a fix log and build the map */
+int gr_trackmap_load(gr_trackmap_t *, const char *fixlog_path);
+
+/* draw the outline into a 1-bpp row-major bitmap of width x height, with
+ * rows padded to whole bytes and the first pixel in the MSB */
+int gr_trackmap_rasterize(const gr_trackmap_t *, uint8_t width, uint8_t height,
+                uint8_t *bitmap, size_t len);
+
+/* pixel of the position in a bitmap of the same size, -1 if not built */
+int gr_trackmap_locate(const gr_trackmap_t *, uint8_t width, uint8_t height,
+                int32_t lat_e7, int32_t lon_e7, int *x, int *y);
+
+#define GR_TRACKMAP_BITMAP_SIZE(W,H) ((size_t)(((W) + 7) / 8) * (size_t)(H))
+#define GR_TRACKMAP_PIXEL(B,W,X,Y) (((B)[(size_t)(Y) * (((W) + 7) / 8) + ((X) / 8)] >> (7 - ((X) % 8))) & 1)
+
+#endif /* __GOODRACER_TRACKMAP_H__ */
@@ -0,0 +1,89 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef __GOODRACER_UI_H__
+#define __GOODRACER_UI_H__
+
+/* retained mode layout for the OLED.
+ * a screen is a set of widgets with fixed regions, each bound to one value
+ * of the consolidated state. on every render the widgets on the current
+ * screen format their value and only the ones whose output changed are
+ * cleared and drawn again, so the cost of a frame follows what changed and
+ * not how busy the screen is.
+ */
+#define GR_UI_MAX_SCREENS 4
+#define GR_UI_MAX_WIDGETS 8
+#define GR_UI_MAX_TEXT 24
+
+typedef enum {
+    GR_UI_VALUE_LATITUDE = 0,
+    GR_UI_VALUE_LONGITUDE,
+    GR_UI_VALUE_SPEED, /* kmph */
+    GR_UI_VALUE_LAP_TIME, /* running time of the current lap */
+    GR_UI_VALUE_LAST_LAP,
+    GR_UI_VALUE_BEST_LAP,
+    GR_UI_VALUE_DELTA, /* last lap against the best lap */
+    GR_UI_VALUE_LAP_NUMBER
+} gr_ui_value_t;
+
+typedef struct {
+    uint8_t x;
+    uint8_t y;
+    uint8_t w;
+    uint8_t h;
+} gr_ui_rect_t;
+
+typedef struct gr_ui_t_ gr_ui_t;
+
+/* the framebuffer is not owned by the UI. font_file can be NULL to use the
+ * built-in font */
+gr_ui_t *gr_ui_create(ssd1306_framebuffer_t *fbp, const char *font_file);
+void gr_ui_free(gr_ui_t *);
+
+/* returns the screen index or -1 on error */
+int gr_ui_add_screen(gr_ui_t *, const char *name);
+/* text widget showing the formatted value. text that is larger than the
+ * rect is not clipped, but it is wiped and redrawn wherever it went */
+int gr_ui_add_text(gr_ui_t *, int screen, gr_ui_value_t value,
+                gr_ui_rect_t rect, uint8_t fontsize);
+/* horizontal bar filled in proportion to the value over max */
+int gr_ui_add_bar(gr_ui_t *, int screen, gr_ui_value_t value,
+                gr_ui_rect_t rect, float max);
+/* track minimap with a dot for the car. the outline is rasterized once
+ * into a cached bitmap when the track map is first seen built, after that
+ * a frame only redraws the pixels around the old and new car position */
+int gr_ui_add_map(gr_ui_t *, int screen, gr_ui_rect_t rect);
+/* the track map is not owned by the UI and can be built later */
+void gr_ui_set_trackmap(gr_ui_t *, const gr_trackmap_t *);
+/* position, lap timing, lap times and map screens laid out for the
+ * framebuffer size */
+int gr_ui_add_default_screens(gr_ui_t *);
+
+size_t gr_ui_num_screens(const gr_ui_t *);
+int gr_ui_current_screen(const gr_ui_t *);
+/* switching screens redraws everything on the next render */
+int gr_ui_set_screen(gr_ui_t *, int screen);
+int gr_ui_next_screen(gr_ui_t *);
+
+/* bring the framebuffer up to date with the state. returns the number of
+ * widgets drawn, 0 if the framebuffer did not change, or -1 on error.
+ */
+int gr_ui_render(gr_ui_t *, const gr_fix_t *fix, const gr_lap_state_t *lap,
+                uint64_t now_ns);
+
+/* bitmask of the 8 pixel high display pages drawn into since the last call,
+ * which also clears it */
+uint32_t gr_ui_take_dirty_pages(gr_ui_t *);
+
+typedef struct {
+    uint64_t frames; /* renders that changed the framebuffer */
+    uint64_t widgets_drawn;
+    uint64_t widgets_skipped; /* unchanged and not drawn */
+    uint64_t render_ns; /* total time spent drawing */
+} gr_ui_stats_t;
+
+void gr_ui_get_stats(const gr_ui_t *, gr_ui_stats_t *);
+
+#endif /* __GOODRACER_UI_H__ */
@@ -8,6 +8,7 @@
 #include <gpsutils.h>
 #include <gpsdata.h>
 #include <ssd1306_i2c.h>
+#include <goodracer_mem.h>
 
 #ifndef GRLOG_PTR
 #define GRLOG_PTR GPSUTILS_LOG_PTR
@@ -20,6 +21,6 @@
 #define GRLOG_DEBUG GPSUTILS_DEBUG
 #define GRLOG_NONE GPSUTILS_NONE
 #define GRLOG_OUTOFMEM GPSUTILS_ERROR_NOMEM
-#define GR_FREE GPSUTILS_FREE
+#define GR_FREE(A) do { gr_mem_free(A); (A) = NULL; } while (0)
 
 #endif /* __GOODRACER_UTILS_H__ */
@@ -0,0 +1,845 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ *
+ * offline session analyzer. reads recorded NMEA logs or binary fix logs,
+ * splits them into laps with the same lap timer that goodracer uses and
+ * writes lap tables, sector bests, speed traces and lap-to-lap deltas.
+ * files are loaded in parallel and laps are analyzed in parallel.
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_POPT
+#include <popt.h>
+#endif
+#ifdef GOODRACER_HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef GOODRACER_HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef GOODRACER_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_MATH_H
+#include <math.h>
+#endif
+#ifdef GOODRACER_HAVE_LIMITS_H
+#include <limits.h>
+#endif
+#ifdef GOODRACER_HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_laptimer.h>
+#include <goodracer_fixlog.h>
+
+/* speed traces and deltas are sampled every so many meters of the lap */
+#define GR_AN_BIN_M 10.0
+#define GR_AN_EARTH_RADIUS_M 6371008.8
+#define GR_AN_FORMAT_CSV 0x1
+#define GR_AN_FORMAT_JSON 0x2
+
+typedef struct {
+    gr_gate_t gates[GR_LAPTIMER_MAX_GATES];
+    size_t num_gates;
+    unsigned threads;
+    int formats;
+    bool trace;
+    char prefix[PATH_MAX];
+    const char **files;
+    size_t num_files;
+} gr_an_args_t;
+
+typedef struct {
+    const char *path;
+    gr_fix_t *fixes;
+    size_t num_fixes;
+    size_t cap;
+    uint64_t num_sentences;
+    int rc;
+} gr_an_file_t;
+
+typedef struct {
+    size_t file;
+    uint32_t lap; /* lap number within the file, 1 based */
+    size_t start; /* index of the last fix before the lap start crossing */
+    size_t end; /* index of the first fix after the lap end crossing */
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint32_t lap_ms;
+    uint8_t num_sectors;
+    uint32_t sector_ms[GR_LAPTIMER_MAX_GATES];
+    /* filled in by the parallel analysis */
+    double distance_m;
+    double min_kmph;
+    double max_kmph;
+    double avg_kmph;
+    size_t num_bins;
+    float *bin_speed; /* kmph at every GR_AN_BIN_M */
+    double *bin_time_ms; /* time into the lap at every GR_AN_BIN_M */
+    double *bin_delta_ms; /* against the best lap */
+    double delta_ms; /* at the end of the shorter of the two laps */
+} gr_an_lap_t;
+
+typedef struct {
+    gr_an_args_t *args;
+    gr_an_file_t *files;
+    gr_an_lap_t *laps;
+    size_t num_laps;
+    size_t cap_laps;
+    ssize_t best; /* index of the best lap */
+    uint32_t best_sector_ms[GR_LAPTIMER_MAX_GATES];
+    ssize_t best_sector_lap[GR_LAPTIMER_MAX_GATES];
+} gr_an_ctx_t;
+
+typedef void (* gr_an_task_t)(gr_an_ctx_t *, size_t idx);
+
+#ifdef GOODRACER_HAVE_PTHREAD
+typedef struct {
+    gr_an_ctx_t *ctx;
+    gr_an_task_t fn;
+    size_t num;
+    size_t next;
+} gr_an_pool_t;
+
+static void *gr_an_worker(void *arg)
+{
+    gr_an_pool_t *pool = (gr_an_pool_t *)arg;
+    size_t idx;
+    while ((idx = __atomic_fetch_add(&(pool->next), 1, __ATOMIC_RELAXED)) < pool->num) {
+        pool->fn(pool->ctx, idx);
+    }
+    return NULL;
+}
+#endif
+
+/* runs fn on every index from 0 to num - 1 on up to threads threads */
+static void gr_an_parallel(gr_an_ctx_t *ctx, size_t num, unsigned threads,
+                    gr_an_task_t fn)
+{
+#ifdef GOODRACER_HAVE_PTHREAD
+    if (threads > num)
+        threads = (unsigned)num;
+    if (threads > 1) {
+        gr_an_pool_t pool = { .ctx = ctx, .fn = fn, .num = num, .next = 0 };
+        pthread_t *tids = calloc(threads, sizeof(pthread_t));
+        if (tids) {
+            unsigned started = 0;
+            for (unsigned i = 0; i < threads; ++i) {
+                if (pthread_create(&tids[i], NULL, gr_an_worker, &pool) != 0)
+                    break;
+                started++;
+            }
+            /* the current thread helps too, and covers for failed creates */
+            gr_an_worker(&pool);
+            for (unsigned i = 0; i < started; ++i) {
+                pthread_join(tids[i], NULL);
+            }
+            GR_FREE(tids);
+            return;
+        }
+    }
+#else
+    (void)threads;
+#endif
+    for (size_t i = 0; i < num; ++i) {
+        fn(ctx, i);
+    }
+}
+
+static double gr_an_now()
+{
+    return (double)gr_monotonic_ns() / 1e9;
+}
+
+static int gr_an_file_append(gr_an_file_t *f, const gr_fix_t *fix)
+{
+    if (f->num_fixes == f->cap) {
+        size_t cap = f->cap ? (2 * f->cap) : 4096;
+        gr_fix_t *tmp = realloc(f->fixes, cap * sizeof(gr_fix_t));
+        if (!tmp) {
+            GRLOG_OUTOFMEM(cap * sizeof(gr_fix_t));
+            return -1;
+        }
+        f->fixes = tmp;
+        f->cap = cap;
+    }
+    memcpy(&(f->fixes[f->num_fixes]), fix, sizeof(*fix));
+    f->num_fixes++;
+    return 0;
+}
+
+/* NMEA logs have no monotonic clock so the fix time is the GPS UTC time of
+ * the epoch, carried across midnight */
+static int gr_an_load_nmea(gr_an_file_t *f)
+{
+    int rc = 0;
+    FILE *fp = fopen(f->path, "r");
+    if (!fp) {
+        int err = errno;
+        GRLOG_ERROR("Failed to open %s. Error: %s(%d)\n", f->path, strerror(err), err);
+        return -1;
+    }
+    gpsdata_parser_t *parser = gpsdata_parser_create();
+    if (!parser) {
+        GRLOG_ERROR("Failed to create GPS data parser object\n");
+        fclose(fp);
+        return -1;
+    }
+    char *line = NULL;
+    size_t linesz = 0;
+    ssize_t len = 0;
+    int64_t last_utc = -1;
+    int64_t days = 0;
+    bool have_time = false;
+    uint64_t now_ns = 0;
+    gr_fix_t fix;
+    gr_fix_init(&fix);
+    while (rc == 0 && (len = getline(&line, &linesz, fp)) > 0) {
+        int64_t utc = gr_nmea_utc_ms(line, (size_t)len);
+        if (utc >= 0) {
+            if (last_utc >= 0 && (utc + (GR_FIX_MS_PER_DAY / 2)) < last_utc)
+                days++;
+            last_utc = utc;
+            now_ns = (uint64_t)(days * GR_FIX_MS_PER_DAY + utc) * 1000000ULL;
+            have_time = true;
+        }
+        size_t onum = 0;
+        gpsdata_data_t *datalistp = NULL;
+        f->num_sentences++;
+        if (gpsdata_parser_parse(parser, line, (size_t)len, &datalistp, &onum) < 0) {
+            gpsdata_parser_reset(parser);
+            continue;
+        }
+        if (datalistp) {
+            const gpsdata_data_t *item = NULL;
+            LL_FOREACH(datalistp, item) {
+                /* one fix per epoch, once its speed is in */
+                if (have_time && gr_fix_update(&fix, item, now_ns) > 0) {
+                    if (gr_an_file_append(f, &fix) < 0) {
+                        rc = -1;
+                        break;
+                    }
+                }
+            }
+        }
+        gpsdata_list_free(&(datalistp));
+    }
+    GR_FREE(line);
+    gpsdata_parser_free(parser);
+    fclose(fp);
+    return rc;
+}
+
+static void gr_an_load_task(gr_an_ctx_t *ctx, size_t idx)
+{
+    gr_an_file_t *f = &(ctx->files[idx]);
+    if (gr_fixlog_is_fixlog(f->path)) {
+        f->rc = gr_fixlog_read_all(f->path, &(f->fixes), &(f->num_fixes));
+        f->num_sentences = f->num_fixes;
+    } else {
+        f->rc = gr_an_load_nmea(f);
+    }
+    if (f->rc < 0) {
+        GRLOG_ERROR("Failed to load %s\n", f->path);
+    } else {
+        GRLOG_DEBUG("Loaded %zu fixes from %s\n", f->num_fixes, f->path);
+    }
+}
+
+static int gr_an_add_lap(gr_an_ctx_t *ctx, const gr_an_lap_t *lap)
+{
+    if (ctx->num_laps == ctx->cap_laps) {
+        size_t cap = ctx->cap_laps ? (2 * ctx->cap_laps) : 64;
+        gr_an_lap_t *tmp = realloc(ctx->laps, cap * sizeof(gr_an_lap_t));
+        if (!tmp) {
+            GRLOG_OUTOFMEM(cap * sizeof(gr_an_lap_t));
+            return -1;
+        }
+        ctx->laps = tmp;
+        ctx->cap_laps = cap;
+    }
+    memcpy(&(ctx->laps[ctx->num_laps]), lap, sizeof(*lap));
+    ctx->num_laps++;
+    return 0;
+}
+
+/* lap splitting is sequential per file since every crossing depends on the
+ * previous fix, but it is cheap compared to the per lap analysis */
+static int gr_an_split_laps(gr_an_ctx_t *ctx, size_t fidx)
+{
+    const gr_an_file_t *f = &(ctx->files[fidx]);
+    gr_laptimer_t *lt = gr_laptimer_create();
+    if (!lt)
+        return -1;
+    for (size_t i = 0; i < ctx->args->num_gates; ++i) {
+        gr_laptimer_add_gate(lt, &(ctx->args->gates[i]));
+    }
+    int rc = 0;
+    size_t start = 0;
+    uint64_t start_ns = 0;
+    bool started = false;
+    for (size_t i = 0; i < f->num_fixes && rc == 0; ++i) {
+        int events = gr_laptimer_update(lt, &(f->fixes[i]));
+        if (events <= 0)
+            continue;
+        const gr_lap_state_t *st = gr_laptimer_state(lt);
+        if ((events & GR_LAPTIMER_EVENT_LAP) && started) {
+            gr_an_lap_t lap = { 0 };
+            lap.file = fidx;
+            lap.lap = st->lap;
+            lap.start = start;
+            lap.end = i;
+            lap.start_ns = start_ns;
+            lap.end_ns = st->lap_start_ns;
+            lap.lap_ms = st->last_lap_ms;
+            lap.num_sectors = st->num_sectors;
+            memcpy(lap.sector_ms, st->sector_ms, sizeof(lap.sector_ms));
+            rc = gr_an_add_lap(ctx, &lap);
+        }
+        if (events & (GR_LAPTIMER_EVENT_LAP | GR_LAPTIMER_EVENT_START)) {
+            started = true;
+            start = (i > 0) ? (i - 1) : 0;
+            start_ns = st->lap_start_ns;
+        }
+    }
+    gr_laptimer_free(lt);
+    return rc;
+}
+
+static double gr_an_distance_m(const gr_fix_t *a, const gr_fix_t *b)
+{
+    double lat1 = GR_FIX_E7_TO_DEG(a->lat_e7) * M_PI / 180.0;
+    double lat2 = GR_FIX_E7_TO_DEG(b->lat_e7) * M_PI / 180.0;
+    double dlat = lat2 - lat1;
+    double dlon = GR_FIX_E7_TO_DEG(b->lon_e7 - a->lon_e7) * M_PI / 180.0;
+    double h = sin(dlat / 2) * sin(dlat / 2) +
+                cos(lat1) * cos(lat2) * sin(dlon / 2) * sin(dlon / 2);
+    return 2.0 * GR_AN_EARTH_RADIUS_M * asin(sqrt(h));
+}
+
+static void gr_an_lap_task(gr_an_ctx_t *ctx, size_t idx)
+{
+    gr_an_lap_t *lap = &(ctx->laps[idx]);
+    const gr_fix_t *fixes = ctx->files[lap->file].fixes;
+    double dist = 0.0;
+    size_t nspeed = 0;
+    lap->min_kmph = INFINITY;
+    lap->max_kmph = 0.0;
+    /* upper bound on the bins from the straight line distances */
+    for (size_t i = lap->start + 1; i <= lap->end; ++i) {
+        dist += gr_an_distance_m(&fixes[i - 1], &fixes[i]);
+    }
+    size_t maxbins = (size_t)(dist / GR_AN_BIN_M) + 2;
+    lap->bin_speed = calloc(maxbins, sizeof(float));
+    lap->bin_time_ms = calloc(maxbins, sizeof(double));
+    lap->bin_delta_ms = calloc(maxbins, sizeof(double));
+    if (!lap->bin_speed || !lap->bin_time_ms || !lap->bin_delta_ms) {
+        GRLOG_OUTOFMEM(maxbins * (sizeof(float) + 2 * sizeof(double)));
+        return;
+    }
+    dist = 0.0;
+    size_t nbins = 0;
+    for (size_t i = lap->start + 1; i <= lap->end; ++i) {
+        const gr_fix_t *a = &fixes[i - 1];
+        const gr_fix_t *b = &fixes[i];
+        double seg = gr_an_distance_m(a, b);
+        double ta = ((double)a->mono_ns - (double)lap->start_ns) / 1e6;
+        double tb = ((double)b->mono_ns - (double)lap->start_ns) / 1e6;
+        if (tb > ta) {
+            /* clip the segments that straddle the start and end crossings */
+            double lo = (ta < 0) ? (-ta / (tb - ta)) : 0.0;
+            double lap_len_ms = ((double)lap->end_ns - (double)lap->start_ns) / 1e6;
+            double hi = (tb > lap_len_ms) ? ((lap_len_ms - ta) / (tb - ta)) : 1.0;
+            if (hi > lo) {
+                double va = isnan(a->speed_kmph) ? (seg / (tb - ta)) * 3600.0 : a->speed_kmph;
+                double vb = isnan(b->speed_kmph) ? (seg / (tb - ta)) * 3600.0 : b->speed_kmph;
+                double d0 = dist;
+                double d1 = dist + seg * (hi - lo);
+                while (nbins < maxbins && (nbins * GR_AN_BIN_M) <= d1) {
+                    double f = (d1 > d0) ? (((nbins * GR_AN_BIN_M) - d0) / (d1 - d0)) : 0.0;
+                    if (f < 0)
+                        f = 0;
+                    f = lo + f * (hi - lo);
+                    lap->bin_time_ms[nbins] = ta + f * (tb - ta);
+                    lap->bin_speed[nbins] = (float)(va + f * (vb - va));
+                    nbins++;
+                }
+                dist = d1;
+                if (vb > lap->max_kmph)
+                    lap->max_kmph = vb;
+                if (vb < lap->min_kmph)
+                    lap->min_kmph = vb;
+                nspeed++;
+            }
+        }
+    }
+    lap->distance_m = dist;
+    lap->num_bins = nbins;
+    lap->avg_kmph = (lap->lap_ms > 0) ? (dist / ((double)lap->lap_ms / 1000.0)) * 3.6 : 0.0;
+    if (nspeed == 0)
+        lap->min_kmph = 0.0;
+}
+
+static void gr_an_delta_task(gr_an_ctx_t *ctx, size_t idx)
+{
+    gr_an_lap_t *lap = &(ctx->laps[idx]);
+    const gr_an_lap_t *best = &(ctx->laps[ctx->best]);
+    size_t n = (lap->num_bins < best->num_bins) ? lap->num_bins : best->num_bins;
+    if (!lap->bin_delta_ms || !lap->bin_time_ms || !best->bin_time_ms)
+        return;
+    for (size_t i = 0; i < n; ++i) {
+        lap->bin_delta_ms[i] = lap->bin_time_ms[i] - best->bin_time_ms[i];
+    }
+    lap->delta_ms = (double)lap->lap_ms - (double)best->lap_ms;
+}
+
+static void gr_an_find_bests(gr_an_ctx_t *ctx)
+{
+    ctx->best = -1;
+    for (size_t s = 0; s < GR_LAPTIMER_MAX_GATES; ++s) {
+        ctx->best_sector_ms[s] = 0;
+        ctx->best_sector_lap[s] = -1;
+    }
+    for (size_t i = 0; i < ctx->num_laps; ++i) {
+        const gr_an_lap_t *lap = &(ctx->laps[i]);
+        if (ctx->best < 0 || lap->lap_ms < ctx->laps[ctx->best].lap_ms)
+            ctx->best = (ssize_t)i;
+        for (size_t s = 0; s < lap->num_sectors; ++s) {
+            if (lap->sector_ms[s] > 0 && (ctx->best_sector_lap[s] < 0 ||
+                lap->sector_ms[s] < ctx->best_sector_ms[s])) {
+                ctx->best_sector_ms[s] = lap->sector_ms[s];
+                ctx->best_sector_lap[s] = (ssize_t)i;
+            }
+        }
+    }
+}
+
+static FILE *gr_an_open_output(const gr_an_args_t *args, const char *suffix)
+{
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s%s", args->prefix, suffix);
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        int err = errno;
+        GRLOG_ERROR("Failed to open %s. Error: %s(%d)\n", path, strerror(err), err);
+    } else {
+        GRLOG_INFO("Writing %s\n", path);
+    }
+    return fp;
+}
+
+/* file paths can hold anything but a NUL, so every string field is quoted
+ * and escaped */
+static void gr_an_csv_string(FILE *fp, const char *str)
+{
+    fputc('"', fp);
+    for (const char *c = str; *c != '\0'; ++c) {
+        if (*c == '"')
+            fputc('"', fp);
+        fputc(*c, fp);
+    }
+    fputc('"', fp);
+}
+
+static void gr_an_json_string(FILE *fp, const char *str)
+{
+    fputc('"', fp);
+    for (const unsigned char *c = (const unsigned char *)str; *c != '\0'; ++c) {
+        switch (*c) {
+        case '"':
+            fputs("\\\"", fp);
+            break;
+        case '\\':
+            fputs("\\\\", fp);
+            break;
+        case '\n':
+            fputs("\\n", fp);
+            break;
+        case '\r':
+            fputs("\\r", fp);
+            break;
+        case '\t':
+            fputs("\\t", fp);
+            break;
+        default:
+            if (*c < 0x20)
+                fprintf(fp, "\\u%04x", *c);
+            else
+                fputc(*c, fp);
+            break;
+        }
+    }
+    fputc('"', fp);
+}
+
+static int gr_an_write_csv(const gr_an_ctx_t *ctx)
+{
+    const gr_an_args_t *args = ctx->args;
+    size_t nsec = args->num_gates;
+    FILE *fp = gr_an_open_output(args, "laps.csv");
+    if (!fp)
+        return -1;
+    fprintf(fp, "file,lap,lap_time_s");
+    for (size_t s = 0; s < nsec; ++s)
+        fprintf(fp, ",sector%zu_s", s + 1);
+    fprintf(fp, ",distance_m,min_kmph,max_kmph,avg_kmph,delta_to_best_s,best\n");
+    for (size_t i = 0; i < ctx->num_laps; ++i) {
+        const gr_an_lap_t *lap = &(ctx->laps[i]);
+        gr_an_csv_string(fp, ctx->files[lap->file].path);
+        fprintf(fp, ",%u,%0.3f", lap->lap, lap->lap_ms / 1000.0);
+        for (size_t s = 0; s < nsec; ++s)
+            fprintf(fp, ",%0.3f", lap->sector_ms[s] / 1000.0);
+        fprintf(fp, ",%0.1f,%0.2f,%0.2f,%0.2f,%+0.3f,%d\n", lap->distance_m,
+                lap->min_kmph, lap->max_kmph, lap->avg_kmph, lap->delta_ms / 1000.0,
+                ((ssize_t)i == ctx->best) ? 1 : 0);
+    }
+    fclose(fp);
+
+    fp = gr_an_open_output(args, "sectors.csv");
+    if (!fp)
+        return -1;
+    uint64_t theoretical = 0;
+    fprintf(fp, "sector,best_s,file,lap\n");
+    for (size_t s = 0; s < nsec; ++s) {
+        if (ctx->best_sector_lap[s] < 0)
+            continue;
+        const gr_an_lap_t *lap = &(ctx->laps[ctx->best_sector_lap[s]]);
+        fprintf(fp, "%zu,%0.3f,", s + 1, ctx->best_sector_ms[s] / 1000.0);
+        gr_an_csv_string(fp, ctx->files[lap->file].path);
+        fprintf(fp, ",%u\n", lap->lap);
+        theoretical += ctx->best_sector_ms[s];
+    }
+    fprintf(fp, "theoretical,%0.3f,,\n", theoretical / 1000.0);
+    fclose(fp);
+
+    if (args->trace) {
+        fp = gr_an_open_output(args, "trace.csv");
+        if (!fp)
+            return -1;
+        fprintf(fp, "file,lap,distance_m,time_s,speed_kmph,delta_to_best_s\n");
+        for (size_t i = 0; i < ctx->num_laps; ++i) {
+            const gr_an_lap_t *lap = &(ctx->laps[i]);
+            for (size_t b = 0; b < lap->num_bins; ++b) {
+                gr_an_csv_string(fp, ctx->files[lap->file].path);
+                fprintf(fp, ",%u,%0.0f,%0.3f,%0.2f,%+0.3f\n", lap->lap, b * GR_AN_BIN_M,
+                        lap->bin_time_ms[b] / 1000.0, lap->bin_speed[b],
+                        lap->bin_delta_ms[b] / 1000.0);
+            }
+        }
+        fclose(fp);
+    }
+    return 0;
+}
+
+static int gr_an_write_json(const gr_an_ctx_t *ctx, uint64_t num_fixes,
+                double elapsed)
+{
+    const gr_an_args_t *args = ctx->args;
+    FILE *fp = gr_an_open_output(args, "summary.json");
+    if (!fp)
+        return -1;
+    fprintf(fp, "{\n  \"files\": [");
+    for (size_t i = 0; i < args->num_files; ++i) {
+        fprintf(fp, "%s", (i > 0) ? ", " : "");
+        gr_an_json_string(fp, ctx->files[i].path);
+    }
+    fprintf(fp, "],\n  \"fixes\": %" PRIu64 ",\n  \"seconds\": %0.3f,\n"
+            "  \"fixes_per_second\": %0.0f,\n  \"threads\": %u,\n",
+            num_fixes, elapsed, (elapsed > 0) ? (num_fixes / elapsed) : 0.0,
+            args->threads);
+    if (ctx->best >= 0) {
+        const gr_an_lap_t *best = &(ctx->laps[ctx->best]);
+        fprintf(fp, "  \"best_lap\": { \"file\": ");
+        gr_an_json_string(fp, ctx->files[best->file].path);
+        fprintf(fp, ", \"lap\": %u, \"time_s\": %0.3f },\n", best->lap,
+                best->lap_ms / 1000.0);
+    }
+    fprintf(fp, "  \"best_sectors_s\": [");
+    uint64_t theoretical = 0;
+    for (size_t s = 0; s < args->num_gates; ++s) {
+        fprintf(fp, "%s%0.3f", (s > 0) ? ", " : "", ctx->best_sector_ms[s] / 1000.0);
+        theoretical += ctx->best_sector_ms[s];
+    }
+    fprintf(fp, "],\n  \"theoretical_best_s\": %0.3f,\n  \"laps\": [\n",
+            theoretical / 1000.0);
+    for (size_t i = 0; i < ctx->num_laps; ++i) {
+        const gr_an_lap_t *lap = &(ctx->laps[i]);
+        fprintf(fp, "    { \"file\": ");
+        gr_an_json_string(fp, ctx->files[lap->file].path);
+        fprintf(fp, ", \"lap\": %u, \"time_s\": %0.3f, \"sectors_s\": [",
+                lap->lap, lap->lap_ms / 1000.0);
+        for (size_t s = 0; s < args->num_gates; ++s) {
+            fprintf(fp, "%s%0.3f", (s > 0) ? ", " : "", lap->sector_ms[s] / 1000.0);
+        }
+        fprintf(fp, "], \"distance_m\": %0.1f, \"min_kmph\": %0.2f, \"max_kmph\": %0.2f,"
+                " \"avg_kmph\": %0.2f, \"delta_to_best_s\": %0.3f }%s\n",
+                lap->distance_m, lap->min_kmph, lap->max_kmph, lap->avg_kmph,
+                lap->delta_ms / 1000.0, (i + 1 < ctx->num_laps) ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    return 0;
+}
+
+static struct poptOption gr_an_args_table[] = {
+    {
+        .longName = "gate",
+        .shortName = 'g',
+        .argInfo = POPT_ARG_STRING,
+        .arg = NULL,
+        .val = 'g',
+        .descrip = "Add a timing gate. The first gate is the start/finish line and the rest are sector splits in track order. Can be repeated.",
+        .argDescrip = "lat1,lon1,lat2,lon2"
+    },
+    {
+        .longName = "output",
+        .shortName = 'o',
+        .argInfo = POPT_ARG_STRING,
+        .arg = NULL,
+        .val = 'o',
+        .descrip = "Prefix of the output files. Default is goodracer-",
+        .argDescrip = "/path/to/session-"
+    },
+    {
+        .longName = "format",
+        .shortName = 'f',
+        .argInfo = POPT_ARG_STRING,
+        .arg = NULL,
+        .val = 'f',
+        .descrip = "Output format. Default is all.",
+        .argDescrip = "csv | json | all"
+    },
+    {
+        .longName = "threads",
+        .shortName = 'j',
+        .argInfo = POPT_ARG_INT,
+        .arg = NULL,
+        .val = 'j',
+        .descrip = "Number of threads. Default is the number of online CPUs.",
+        .argDescrip = "1 - 256"
+    },
+    {
+        .longName = "trace",
+        .shortName = 't',
+        .argInfo = POPT_ARG_NONE,
+        .arg = NULL,
+        .val = 't',
+        .descrip = "Write the per lap speed and delta traces as CSV",
+        .argDescrip = NULL
+    },
+    {
+        .longName = "verbose",
+        .shortName = 'v',
+        .argInfo = POPT_ARG_NONE,
+        .arg = NULL,
+        .val = 'v',
+        .descrip = "Do verbose logging",
+        .argDescrip = NULL
+    },
+    POPT_AUTOHELP
+    POPT_TABLEEND
+};
+
+static int gr_an_args_parse(int argc, const char **argv, gr_an_args_t *args,
+                    poptContext *pctx)
+{
+    int opt = 0, rc = 0;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    args->threads = (ncpu > 0) ? (unsigned)ncpu : 1;
+    args->formats = GR_AN_FORMAT_CSV | GR_AN_FORMAT_JSON;
+    snprintf(args->prefix, sizeof(args->prefix), "goodracer-");
+    poptContext ctx = poptGetContext(argv[0], argc, argv, gr_an_args_table, 0);
+    if (!ctx) {
+        GRLOG_ERROR("poptGetContext() error\n");
+        return -1;
+    }
+    poptSetOtherOptionHelp(ctx, "[OPTIONS] <session.nmea | session.grlog>...");
+    while ((opt = poptGetNextOpt(ctx)) >= 0) {
+        char *argbuf = NULL;
+        switch (opt) {
+        case 'g':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                if (args->num_gates >= GR_LAPTIMER_MAX_GATES) {
+                    GRLOG_ERROR("Only %d timing gates are supported\n", GR_LAPTIMER_MAX_GATES);
+                    rc = -1;
+                } else if (gr_gate_parse(argbuf, &(args->gates[args->num_gates])) < 0) {
+                    rc = -1;
+                } else {
+                    args->num_gates++;
+                }
+            }
+            break;
+        case 'o':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                snprintf(args->prefix, sizeof(args->prefix), "%s", argbuf);
+            }
+            break;
+        case 'f':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                if (strcmp(argbuf, "csv") == 0) {
+                    args->formats = GR_AN_FORMAT_CSV;
+                } else if (strcmp(argbuf, "json") == 0) {
+                    args->formats = GR_AN_FORMAT_JSON;
+                } else if (strcmp(argbuf, "all") == 0) {
+                    args->formats = GR_AN_FORMAT_CSV | GR_AN_FORMAT_JSON;
+                } else {
+                    GRLOG_ERROR("Invalid output format %s\n", argbuf);
+                    rc = -1;
+                }
+            }
+            break;
+        case 'j':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                unsigned long n = strtoul(argbuf, NULL, 10);
+                if (n == 0 || n > 256) {
+                    GRLOG_WARN("Invalid number of threads %s. Using %u\n", argbuf, args->threads);
+                } else {
+                    args->threads = (unsigned)n;
+                }
+            }
+            break;
+        case 't':
+            args->trace = true;
+            break;
+        case 'v':
+            GRLOG_LEVEL_SET(DEBUG);
+            break;
+        default:
+            rc = -1;
+            break;
+        }
+        GR_FREE(argbuf);
+    }
+    if (opt < -1) {
+        GRLOG_ERROR("%s %s: %s\n", argv[0], poptBadOption(ctx, POPT_BADOPTION_NOALIAS), poptStrerror(opt));
+        rc = -1;
+    }
+    args->files = poptGetArgs(ctx);
+    while (args->files && args->files[args->num_files])
+        args->num_files++;
+    if (rc == 0 && args->num_files == 0) {
+        GRLOG_ERROR("No session files given\n");
+        rc = -1;
+    }
+    if (rc == 0 && args->num_gates == 0) {
+        GRLOG_ERROR("At least the start/finish --gate is needed to find laps\n");
+        rc = -1;
+    }
+    if (rc < 0) {
+        poptPrintHelp(ctx, stdout, 0);
+    }
+    /* the file names belong to the context so it is freed by the caller */
+    *pctx = ctx;
+    return rc;
+}
+
+int main(int argc, const char **argv)
+{
+    int rc = 0;
+    gr_an_args_t args;
+    gr_an_ctx_t ctx;
+    poptContext pctx = NULL;
+    uint64_t num_fixes = 0;
+
+    memset(&args, 0, sizeof(args));
+    memset(&ctx, 0, sizeof(ctx));
+    GRLOG_LEVEL_SET(INFO);
+    if (gr_an_args_parse(argc, argv, &args, &pctx) < 0) {
+        if (pctx)
+            poptFreeContext(pctx);
+        return -1;
+    }
+    ctx.args = &args;
+    ctx.best = -1;
+    do {
+        ctx.files = calloc(args.num_files, sizeof(gr_an_file_t));
+        if (!ctx.files) {
+            GRLOG_OUTOFMEM(args.num_files * sizeof(gr_an_file_t));
+            rc = -1;
+            break;
+        }
+        for (size_t i = 0; i < args.num_files; ++i) {
+            ctx.files[i].path = args.files[i];
+        }
+        double t0 = gr_an_now();
+        gr_an_parallel(&ctx, args.num_files, args.threads, gr_an_load_task);
+        double t1 = gr_an_now();
+        /* the files that loaded are still analyzed, the exit status tells
+         * that some did not */
+        bool load_failed = false;
+        for (size_t i = 0; i < args.num_files && rc == 0; ++i) {
+            if (ctx.files[i].rc < 0) {
+                load_failed = true;
+                continue;
+            }
+            num_fixes += ctx.files[i].num_fixes;
+            rc = gr_an_split_laps(&ctx, i);
+        }
+        if (rc < 0)
+            break;
+        if (load_failed)
+            rc = -1;
+        double t2 = gr_an_now();
+        gr_an_parallel(&ctx, ctx.num_laps, args.threads, gr_an_lap_task);
+        gr_an_find_bests(&ctx);
+        if (ctx.best >= 0) {
+            gr_an_parallel(&ctx, ctx.num_laps, args.threads, gr_an_delta_task);
+        }
+        double t3 = gr_an_now();
+        GRLOG_INFO("Loaded %" PRIu64 " fixes in %0.3fs, split laps in %0.3fs, analyzed %zu laps in %0.3fs\n",
+                num_fixes, t1 - t0, t2 - t1, ctx.num_laps, t3 - t2);
+        GRLOG_INFO("Throughput: %0.0f fixes/s on %u threads\n",
+                (t3 > t0) ? (num_fixes / (t3 - t0)) : 0.0, args.threads);
+        if (ctx.best >= 0) {
+            const gr_an_lap_t *best = &(ctx.laps[ctx.best]);
+            GRLOG_INFO("Best lap %u of %s: %u.%03us\n", best->lap,
+                    ctx.files[best->file].path, best->lap_ms / 1000, best->lap_ms % 1000);
+        } else {
+            GRLOG_WARN("No complete laps found\n");
+        }
+        if (args.formats & GR_AN_FORMAT_CSV) {
+            if (gr_an_write_csv(&ctx) < 0)
+                rc = -1;
+        }
+        if (args.formats & GR_AN_FORMAT_JSON) {
+            if (gr_an_write_json(&ctx, num_fixes, t3 - t0) < 0)
+                rc = -1;
+        }
+    } while (0);
+    for (size_t i = 0; i < ctx.num_laps; ++i) {
+        GR_FREE(ctx.laps[i].bin_speed);
+        GR_FREE(ctx.laps[i].bin_time_ms);
+        GR_FREE(ctx.laps[i].bin_delta_ms);
+    }
+    GR_FREE(ctx.laps);
+    if (ctx.files) {
+        for (size_t i = 0; i < args.num_files; ++i) {
+            GR_FREE(ctx.files[i].fixes);
+        }
+        GR_FREE(ctx.files);
+    }
+    poptFreeContext(pctx);
+    return rc;
+}
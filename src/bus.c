@@ -0,0 +1,270 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef GOODRACER_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+#ifdef GOODRACER_HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_laptimer.h>
+#include <goodracer_bus.h>
+
+typedef struct {
+    /* sequence number of the record in the slot. 0 while it is being
+     * written, so a reader that sees the same non-zero value before and
+     * after copying knows the copy is not torn */
+    uint64_t seq;
+    gr_bus_record_t rec;
+} gr_bus_slot_t;
+
+typedef struct {
+    char name[32];
+    gr_bus_consumer_t cb;
+    void *arg;
+    bool threaded;
+    uint64_t next; /* next sequence number to consume */
+    gr_bus_stats_t stats;
+#ifdef GOODRACER_HAVE_PTHREAD
+    pthread_t thread;
+    int efd; /* producer kicks the thread through this */
+    volatile int stop;
+    struct gr_bus_t_ *bus;
+#endif
+} gr_bus_sub_t;
+
+struct gr_bus_t_ {
+    gr_bus_slot_t *slots;
+    size_t capacity;
+    size_t mask;
+    uint64_t cursor; /* last published sequence number, starts at 0 */
+    gr_bus_sub_t subs[GR_BUS_MAX_SUBSCRIBERS];
+    size_t num_subs;
+    gr_bus_thread_init_t thread_init;
+    void *thread_init_arg;
+};
+
+gr_bus_t *gr_bus_create(size_t capacity)
+{
+    size_t cap = 2;
+    while (cap < capacity)
+        cap <<= 1;
+    gr_bus_t *bus = GR_CALLOC(1, sizeof(*bus));
+    if (!bus) {
+        GRLOG_OUTOFMEM(sizeof(*bus));
+        return NULL;
+    }
+    bus->slots = GR_CALLOC(cap, sizeof(gr_bus_slot_t));
+    if (!bus->slots) {
+        GRLOG_OUTOFMEM(cap * sizeof(gr_bus_slot_t));
+        GR_FREE(bus);
+        return NULL;
+    }
+    bus->capacity = cap;
+    bus->mask = cap - 1;
+    bus->cursor = 0;
+    GRLOG_DEBUG("Created fix bus with %zu slots\n", cap);
+    return bus;
+}
+
+int gr_bus_set_thread_init(gr_bus_t *bus, gr_bus_thread_init_t cb, void *arg)
+{
+    if (!bus)
+        return -1;
+    bus->thread_init = cb;
+    bus->thread_init_arg = arg;
+    return 0;
+}
+
+/* consume everything available to this subscriber */
+static void gr_bus_drain(gr_bus_t *bus, gr_bus_sub_t *sub)
+{
+    gr_bus_record_t rec;
+    uint64_t avail = __atomic_load_n(&(bus->cursor), __ATOMIC_ACQUIRE);
+    while (sub->next <= avail) {
+        if ((avail - sub->next) >= bus->capacity) {
+            /* lapped by the producer, skip to the oldest record still there */
+            uint64_t oldest = avail - bus->capacity + 1;
+            __atomic_fetch_add(&(sub->stats.dropped), oldest - sub->next, __ATOMIC_RELAXED);
+            sub->next = oldest;
+        }
+        const gr_bus_slot_t *slot = &(bus->slots[sub->next & bus->mask]);
+        uint64_t s1 = __atomic_load_n(&(slot->seq), __ATOMIC_ACQUIRE);
+        if (s1 == sub->next) {
+            memcpy(&rec, (const void *)&(slot->rec), sizeof(rec));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            uint64_t s2 = __atomic_load_n(&(slot->seq), __ATOMIC_RELAXED);
+            if (s2 == s1) {
+                sub->cb(&rec, sub->arg);
+                __atomic_fetch_add(&(sub->stats.delivered), 1, __ATOMIC_RELAXED);
+                sub->next++;
+                continue;
+            }
+        }
+        /* overwritten while we were looking at it */
+        __atomic_fetch_add(&(sub->stats.dropped), 1, __ATOMIC_RELAXED);
+        sub->next++;
+        avail = __atomic_load_n(&(bus->cursor), __ATOMIC_ACQUIRE);
+    }
+}
+
+#ifdef GOODRACER_HAVE_PTHREAD
+static void *gr_bus_thread(void *arg)
+{
+    gr_bus_sub_t *sub = (gr_bus_sub_t *)arg;
+    GRLOG_DEBUG("Bus subscriber %s thread started\n", sub->name);
+    if (sub->bus->thread_init) {
+        sub->bus->thread_init(sub->name, sub->bus->thread_init_arg);
+    }
+    while (!__atomic_load_n(&(sub->stop), __ATOMIC_ACQUIRE)) {
+        gr_bus_drain(sub->bus, sub);
+        uint64_t val = 0;
+        /* blocks until the producer publishes again or we are stopped */
+        if (read(sub->efd, &val, sizeof(val)) < 0 && errno != EINTR) {
+            int err = errno;
+            GRLOG_ERROR("Bus subscriber %s failed to wait. Error: %s(%d)\n",
+                    sub->name, strerror(err), err);
+            break;
+        }
+    }
+    gr_bus_drain(sub->bus, sub);
+    GRLOG_DEBUG("Bus subscriber %s thread stopped\n", sub->name);
+    return NULL;
+}
+#endif
+
+int gr_bus_subscribe(gr_bus_t *bus, const char *name, gr_bus_consumer_t cb,
+                void *arg, bool threaded)
+{
+    if (!bus || !cb)
+        return -1;
+    if (bus->num_subs >= GR_BUS_MAX_SUBSCRIBERS) {
+        GRLOG_ERROR("Cannot add more than %d bus subscribers\n", GR_BUS_MAX_SUBSCRIBERS);
+        return -1;
+    }
+    int idx = (int)bus->num_subs;
+    gr_bus_sub_t *sub = &(bus->subs[idx]);
+    memset(sub, 0, sizeof(*sub));
+    snprintf(sub->name, sizeof(sub->name), "%s", name ? name : "unnamed");
+    sub->cb = cb;
+    sub->arg = arg;
+    sub->next = __atomic_load_n(&(bus->cursor), __ATOMIC_ACQUIRE) + 1;
+#ifdef GOODRACER_HAVE_PTHREAD
+    sub->efd = -1;
+    if (threaded) {
+        sub->bus = bus;
+        sub->efd = eventfd(0, EFD_CLOEXEC);
+        if (sub->efd < 0) {
+            int err = errno;
+            GRLOG_ERROR("Failed to create eventfd for subscriber %s. Error: %s(%d)\n",
+                    sub->name, strerror(err), err);
+            return -1;
+        }
+        if (pthread_create(&(sub->thread), NULL, gr_bus_thread, sub) != 0) {
+            GRLOG_ERROR("Failed to create thread for subscriber %s\n", sub->name);
+            close(sub->efd);
+            sub->efd = -1;
+            return -1;
+        }
+        sub->threaded = true;
+    }
+#else
+    if (threaded) {
+        GRLOG_WARN("No threading support, running subscriber %s inline\n", sub->name);
+    }
+#endif
+    bus->num_subs++;
+    GRLOG_DEBUG("Added %s bus subscriber %s\n", sub->threaded ? "threaded" : "inline",
+            sub->name);
+    return idx;
+}
+
+int gr_bus_publish(gr_bus_t *bus, const gr_bus_record_t *rec)
+{
+    if (!bus || !rec)
+        return -1;
+    uint64_t seq = bus->cursor + 1;
+    gr_bus_slot_t *slot = &(bus->slots[seq & bus->mask]);
+    __atomic_store_n(&(slot->seq), 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&(slot->rec), rec, sizeof(*rec));
+    __atomic_store_n(&(slot->seq), seq, __ATOMIC_RELEASE);
+    __atomic_store_n(&(bus->cursor), seq, __ATOMIC_RELEASE);
+    for (size_t i = 0; i < bus->num_subs; ++i) {
+        gr_bus_sub_t *sub = &(bus->subs[i]);
+        if (!sub->threaded) {
+            gr_bus_drain(bus, sub);
+        }
+#ifdef GOODRACER_HAVE_PTHREAD
+        else {
+            uint64_t one = 1;
+            /* an eventfd write only fails if the counter overflows */
+            if (write(sub->efd, &one, sizeof(one)) < 0) {
+                GRLOG_DEBUG("Failed to wake up subscriber %s\n", sub->name);
+            }
+        }
+#endif
+    }
+    return 0;
+}
+
+int gr_bus_get_stats(const gr_bus_t *bus, int subscriber, gr_bus_stats_t *stats)
+{
+    if (!bus || !stats || subscriber < 0 || (size_t)subscriber >= bus->num_subs)
+        return -1;
+    const gr_bus_sub_t *sub = &(bus->subs[subscriber]);
+    stats->delivered = __atomic_load_n(&(sub->stats.delivered), __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&(sub->stats.dropped), __ATOMIC_RELAXED);
+    return 0;
+}
+
+void gr_bus_free(gr_bus_t *bus)
+{
+    if (bus) {
+        for (size_t i = 0; i < bus->num_subs; ++i) {
+            gr_bus_sub_t *sub = &(bus->subs[i]);
+#ifdef GOODRACER_HAVE_PTHREAD
+            if (sub->threaded) {
+                uint64_t one = 1;
+                __atomic_store_n(&(sub->stop), 1, __ATOMIC_RELEASE);
+                if (write(sub->efd, &one, sizeof(one)) < 0) {
+                    GRLOG_WARN("Failed to stop subscriber %s\n", sub->name);
+                }
+                pthread_join(sub->thread, NULL);
+                close(sub->efd);
+                sub->efd = -1;
+            }
+#endif
+            GRLOG_DEBUG("Bus subscriber %s: delivered %" PRIu64 " dropped %" PRIu64 "\n",
+                    sub->name, sub->stats.delivered, sub->stats.dropped);
+        }
+        GR_FREE(bus->slots);
+        GR_FREE(bus);
+    }
+}
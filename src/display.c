@@ -0,0 +1,510 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef GOODRACER_HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef GOODRACER_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_LIMITS_H
+#include <limits.h>
+#endif
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_laptimer.h>
+#include <goodracer_trackmap.h>
+#include <goodracer_ui.h>
+#include <goodracer_i2cbus.h>
+#include <goodracer_display.h>
+
+gr_disp_t *gr_display_create(const gr_disp_backend_t *backend, void *data,
+                    uint8_t width, uint8_t height)
+{
+    int rc = 0;
+    gr_disp_t *disp = NULL;
+    do {
+        if (!backend || !backend->update || !backend->update_page) {
+            GRLOG_ERROR("Invalid display backend\n");
+            rc = -1;
+            break;
+        }
+        if (width == 0 || height == 0 || (height % 8) != 0) {
+            GRLOG_ERROR("Invalid display size %ux%u\n", width, height);
+            rc = -1;
+            break;
+        }
+        disp = GR_CALLOC(1, sizeof(*disp));
+        if (!disp) {
+            GRLOG_OUTOFMEM(sizeof(*disp));
+            rc = -1;
+            break;
+        }
+        disp->backend = backend;
+        disp->backend_data = data;
+        SSD1306_ATOMIC_ZERO(&(disp->_ref));
+        SSD1306_ATOMIC_INCREMENT(&(disp->_ref));
+        disp->fbp = ssd1306_framebuffer_create(width, height, NULL);
+        if (!disp->fbp) {
+            GRLOG_ERROR("Failed to create framebuffer object, cannot proceed");
+            rc = -1;
+            break;
+        }
+    } while (0);
+    if (rc < 0) {
+        if (disp) {
+            gr_display_cleanup(disp);
+        } else if (backend && backend->close && data) {
+            /* close only looks at the backend data */
+            gr_disp_t tmp = { .backend = backend, .backend_data = data };
+            backend->close(&tmp);
+        }
+        disp = NULL;
+    }
+    return disp;
+}
+
+void gr_display_inc_ref(gr_disp_t *disp)
+{
+    if (disp) {
+        SSD1306_ATOMIC_INCREMENT(&(disp->_ref));
+    }
+}
+
+void gr_display_cleanup(gr_disp_t *disp)
+{
+    if (disp) {
+        int zero = 0;
+        SSD1306_ATOMIC_DECREMENT(&(disp->_ref));
+        if (SSD1306_ATOMIC_IS_EQUAL(&(disp->_ref), &zero)) {
+            gr_ui_free(disp->ui);
+            disp->ui = NULL;
+            if (disp->fbp) {
+                ssd1306_framebuffer_destroy(disp->fbp);
+                disp->fbp = NULL;
+            }
+            if (disp->backend && disp->backend->close) {
+                disp->backend->close(disp);
+            }
+            disp->backend_data = NULL;
+            GR_FREE(disp);
+        }
+    }
+}
+
+int gr_display_update(gr_disp_t *disp)
+{
+    if (disp && disp->backend && disp->fbp) {
+        return disp->backend->update(disp);
+    }
+    return -1;
+}
+
+int gr_display_update_page(gr_disp_t *disp, uint8_t page)
+{
+    if (disp && disp->backend && disp->fbp) {
+        if (page >= disp->fbp->height / 8) {
+            GRLOG_ERROR("Page %u is outside the framebuffer\n", page);
+            return -1;
+        }
+        return disp->backend->update_page(disp, page);
+    }
+    return -1;
+}
+
+int gr_display_frame_done(gr_disp_t *disp)
+{
+    if (disp && disp->backend) {
+        return (disp->backend->frame_done) ? disp->backend->frame_done(disp) : 0;
+    }
+    return -1;
+}
+
+int gr_display_clear(gr_disp_t *disp)
+{
+    if (disp && disp->backend) {
+        if (disp->fbp) {
+            ssd1306_framebuffer_clear(disp->fbp);
+        }
+        return (disp->backend->clear) ? disp->backend->clear(disp) : 0;
+    }
+    return -1;
+}
+
+/* I2C backend */
+typedef struct {
+    uint8_t *buf; /* control bytes and a page */
+    gr_i2cbus_t *bus; /* pages are queued on the scheduler if set */
+} gr_display_i2c_t;
+
+/* every command byte gets its own control byte with the continuation bit
+ * so the addressing and the page data go out in a single transaction */
+#define GR_DISPLAY_I2C_PAGE_HEADER 13
+
+static int gr_display_i2c_queue_page(gr_disp_t *disp, gr_display_i2c_t *di, uint8_t page)
+{
+    const ssd1306_framebuffer_t *fbp = disp->fbp;
+    size_t len = (size_t)fbp->width;
+    uint8_t *buf = di->buf;
+    const uint8_t hdr[GR_DISPLAY_I2C_PAGE_HEADER] = {
+        0x80, 0x21, 0x80, 0x00, 0x80, (uint8_t)(disp->oled->width - 1),
+        0x80, 0x22, 0x80, page, 0x80, page,
+        0x40 /* data follows */
+    };
+    memcpy(buf, hdr, sizeof(hdr));
+    memcpy(&(buf[sizeof(hdr)]), &(fbp->buffer[(size_t)page * len]), len);
+    gr_i2cbus_txn_t txn = {
+        .addr = disp->oled->addr,
+        .priority = GR_I2CBUS_PRIO_DISPLAY,
+        .deadline_ns = 0,
+        .tag = (uint32_t)page + 1,
+        .wbuf = buf,
+        .wlen = sizeof(hdr) + len,
+        .rlen = 0,
+        .cb = NULL,
+        .arg = NULL
+    };
+    if (gr_i2cbus_submit(di->bus, &txn) < 0) {
+        GRLOG_ERROR("Failed to queue page %u of the display on the I2C bus\n", page);
+        return -1;
+    }
+    return 0;
+}
+
+static int gr_display_i2c_update(gr_disp_t *disp)
+{
+    gr_display_i2c_t *di = (gr_display_i2c_t *)disp->backend_data;
+    if (di->bus) {
+        for (uint8_t p = 0; p < disp->fbp->height / 8; ++p) {
+            if (gr_display_i2c_queue_page(disp, di, p) < 0)
+                return -1;
+        }
+        return 0;
+    }
+    return ssd1306_i2c_display_update(disp->oled, disp->fbp);
+}
+
+/* point the display RAM at one page and write it out. with horizontal
+ * addressing the column range wraps within the page range so this is the
+ * same transfer as a full update, only a page long */
+static int gr_display_i2c_update_page(gr_disp_t *disp, uint8_t page)
+{
+    gr_display_i2c_t *di = (gr_display_i2c_t *)disp->backend_data;
+    if (di->bus) {
+        return gr_display_i2c_queue_page(disp, di, page);
+    }
+    ssd1306_i2c_t *oled = disp->oled;
+    const ssd1306_framebuffer_t *fbp = disp->fbp;
+    uint8_t *buf = di->buf;
+    uint32_t cols[2] = { 0, (uint32_t)(oled->width - 1) };
+    uint32_t pages[2] = { page, page };
+    size_t len = (size_t)fbp->width;
+    if (ssd1306_i2c_run_cmd(oled, SSD1306_I2C_CMD_COLUMN_ADDR, cols, 2) < 0 ||
+        ssd1306_i2c_run_cmd(oled, SSD1306_I2C_CMD_PAGE_ADDR, pages, 2) < 0) {
+        GRLOG_ERROR("Failed to address page %u of the display\n", page);
+        return -1;
+    }
+    buf[0] = 0x40; /* data follows */
+    memcpy(&(buf[1]), &(fbp->buffer[(size_t)page * len]), len);
+    ssize_t nb = write(oled->fd, buf, len + 1);
+    if (nb < 0 || (size_t)nb != len + 1) {
+        GRLOG_ERROR("Failed to write page %u to the display. Error: %s\n",
+                page, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int gr_display_i2c_clear(gr_disp_t *disp)
+{
+    return ssd1306_i2c_display_clear(disp->oled);
+}
+
+static void gr_display_i2c_close(gr_disp_t *disp)
+{
+    gr_display_i2c_t *di = (gr_display_i2c_t *)disp->backend_data;
+    if (disp->oled) {
+        ssd1306_i2c_display_clear(disp->oled);
+        ssd1306_i2c_close(disp->oled);
+        disp->oled = NULL;
+    }
+    if (di) {
+        gr_i2cbus_cleanup(di->bus);
+        di->bus = NULL;
+        GR_FREE(di->buf);
+        GR_FREE(di);
+        disp->backend_data = NULL;
+    }
+}
+
+static const gr_disp_backend_t gr_display_i2c_backend = {
+    .name = "i2c",
+    .update = gr_display_i2c_update,
+    .update_page = gr_display_i2c_update_page,
+    .frame_done = NULL,
+    .clear = gr_display_i2c_clear,
+    .close = gr_display_i2c_close
+};
+
+gr_disp_t *gr_display_i2c_setup(const char *dev, uint8_t addr, uint8_t width, uint8_t height)
+{
+    int rc = 0;
+    gr_disp_t *disp = NULL;
+    ssd1306_i2c_t *oled = NULL;
+    do {
+        if (!dev) {
+            GRLOG_ERROR("I2C display device path cannot be NULL\n");
+            rc = -1;
+            break;
+        }
+        /* connect the I2C OLED */
+        oled = ssd1306_i2c_open(dev, addr, width, height, NULL);
+        if (!oled) {
+            GRLOG_ERROR("Failed to setup the I2C OLED device");
+            rc = -1;
+            break;
+        }
+        if (ssd1306_i2c_display_initialize(oled) < 0) {
+            GRLOG_ERROR("Failed to initialize the display. Check if it is connected\n");
+            rc = -1;
+            break;
+        }
+        /* clear the display */
+        ssd1306_i2c_display_clear(oled);
+        /* page writes rely on horizontal addressing */
+        if (ssd1306_i2c_run_cmd(oled, SSD1306_I2C_CMD_MEM_ADDR_HORIZ, 0, 0) < 0) {
+            GRLOG_ERROR("Failed to set the display to horizontal addressing\n");
+            rc = -1;
+            break;
+        }
+        gr_display_i2c_t *di = GR_CALLOC(1, sizeof(*di));
+        if (!di) {
+            GRLOG_OUTOFMEM(sizeof(*di));
+            rc = -1;
+            break;
+        }
+        di->buf = GR_CALLOC((size_t)oled->width + GR_DISPLAY_I2C_PAGE_HEADER, sizeof(uint8_t));
+        if (!di->buf) {
+            GRLOG_OUTOFMEM((size_t)oled->width + GR_DISPLAY_I2C_PAGE_HEADER);
+            GR_FREE(di);
+            rc = -1;
+            break;
+        }
+        /* the framebuffer is created here */
+        disp = gr_display_create(&gr_display_i2c_backend, di, oled->width, oled->height);
+        if (!disp) {
+            rc = -1;
+            break;
+        }
+        disp->oled = oled;
+        oled = NULL;
+    } while (0);
+    if (rc < 0) {
+        if (oled) {
+            ssd1306_i2c_close(oled);
+        }
+        gr_display_cleanup(disp);
+        disp = NULL;
+    }
+    return disp;
+}
+
+int gr_display_i2c_set_bus(gr_disp_t *disp, gr_i2cbus_t *bus)
+{
+    if (!disp || disp->backend != &gr_display_i2c_backend || !disp->backend_data) {
+        GRLOG_ERROR("Only an I2C display can use the I2C bus scheduler\n");
+        return -1;
+    }
+    gr_display_i2c_t *di = (gr_display_i2c_t *)disp->backend_data;
+    if ((size_t)disp->fbp->width + GR_DISPLAY_I2C_PAGE_HEADER > GR_I2CBUS_MAX_WRITE) {
+        GRLOG_ERROR("Display page of %u bytes is too long for the I2C bus scheduler\n",
+                disp->fbp->width);
+        return -1;
+    }
+    gr_i2cbus_cleanup(di->bus);
+    di->bus = bus;
+    gr_i2cbus_inc_ref(bus);
+    return 0;
+}
+
+/* virtual backend */
+typedef struct {
+    uint8_t *ram; /* same layout as the framebuffer */
+    size_t len;
+    char *dump_prefix;
+    uint64_t frames;
+} gr_display_virtual_t;
+
+/* P4 PBM, rows of pixels packed MSB first with 1 for black */
+static int gr_display_virtual_dump(const gr_disp_t *disp, const gr_display_virtual_t *vd)
+{
+    char path[PATH_MAX] = { 0 };
+    uint8_t width = disp->fbp->width;
+    uint8_t height = disp->fbp->height;
+    uint8_t row[32] = { 0 };
+    snprintf(path, sizeof(path) - 1, "%s%06" PRIu64 ".pbm", vd->dump_prefix, vd->frames);
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        int err = errno;
+        GRLOG_ERROR("Failed to open %s for the display frame. Error: %s(%d)\n",
+                path, strerror(err), err);
+        return -1;
+    }
+    int rc = 0;
+    size_t rowlen = ((size_t)width + 7) / 8;
+    fprintf(fp, "P4\n%u %u\n", width, height);
+    for (uint8_t y = 0; y < height && rc == 0; ++y) {
+        memset(row, 0, sizeof(row));
+        for (uint8_t x = 0; x < width; ++x) {
+            if ((vd->ram[(size_t)(y / 8) * width + x] >> (y % 8)) & 1) {
+                row[x / 8] |= (uint8_t)(0x80 >> (x % 8));
+            }
+        }
+        if (fwrite(row, 1, rowlen, fp) != rowlen) {
+            GRLOG_ERROR("Failed to write the display frame to %s\n", path);
+            rc = -1;
+        }
+    }
+    fclose(fp);
+    return rc;
+}
+
+static int gr_display_virtual_frame_done(gr_disp_t *disp)
+{
+    gr_display_virtual_t *vd = (gr_display_virtual_t *)disp->backend_data;
+    int rc = 0;
+    if (vd->dump_prefix) {
+        rc = gr_display_virtual_dump(disp, vd);
+    }
+    vd->frames++;
+    return rc;
+}
+
+static int gr_display_virtual_update(gr_disp_t *disp)
+{
+    gr_display_virtual_t *vd = (gr_display_virtual_t *)disp->backend_data;
+    memcpy(vd->ram, disp->fbp->buffer, vd->len);
+    return gr_display_virtual_frame_done(disp);
+}
+
+static int gr_display_virtual_update_page(gr_disp_t *disp, uint8_t page)
+{
+    gr_display_virtual_t *vd = (gr_display_virtual_t *)disp->backend_data;
+    size_t off = (size_t)page * disp->fbp->width;
+    memcpy(&(vd->ram[off]), &(disp->fbp->buffer[off]), disp->fbp->width);
+    return 0;
+}
+
+static int gr_display_virtual_clear(gr_disp_t *disp)
+{
+    gr_display_virtual_t *vd = (gr_display_virtual_t *)disp->backend_data;
+    memset(vd->ram, 0, vd->len);
+    return 0;
+}
+
+static void gr_display_virtual_close(gr_disp_t *disp)
+{
+    gr_display_virtual_t *vd = (gr_display_virtual_t *)disp->backend_data;
+    if (vd) {
+        GR_FREE(vd->ram);
+        GR_FREE(vd->dump_prefix);
+        GR_FREE(vd);
+        disp->backend_data = NULL;
+    }
+}
+
+static const gr_disp_backend_t gr_display_virtual_backend = {
+    .name = "virtual",
+    .update = gr_display_virtual_update,
+    .update_page = gr_display_virtual_update_page,
+    .frame_done = gr_display_virtual_frame_done,
+    .clear = gr_display_virtual_clear,
+    .close = gr_display_virtual_close
+};
+
+gr_disp_t *gr_display_virtual_setup(uint8_t width, uint8_t height,
+                    const char *dump_prefix)
+{
+    int rc = 0;
+    gr_display_virtual_t *vd = NULL;
+    gr_disp_t *disp = NULL;
+    do {
+        vd = GR_CALLOC(1, sizeof(*vd));
+        if (!vd) {
+            GRLOG_OUTOFMEM(sizeof(*vd));
+            rc = -1;
+            break;
+        }
+        vd->len = (size_t)width * (height / 8);
+        vd->ram = GR_CALLOC(vd->len ? vd->len : 1, sizeof(uint8_t));
+        if (!vd->ram) {
+            GRLOG_OUTOFMEM(vd->len);
+            rc = -1;
+            break;
+        }
+        if (dump_prefix) {
+            vd->dump_prefix = GR_STRDUP(dump_prefix);
+            if (!vd->dump_prefix) {
+                GRLOG_OUTOFMEM(strlen(dump_prefix));
+                rc = -1;
+                break;
+            }
+        }
+        /* closes vd on failure */
+        disp = gr_display_create(&gr_display_virtual_backend, vd, width, height);
+        vd = NULL;
+        if (!disp) {
+            rc = -1;
+            break;
+        }
+        GRLOG_INFO("Using a %ux%u virtual display%s%s\n", width, height,
+                dump_prefix ? " with frames dumped to " : "",
+                dump_prefix ? dump_prefix : "");
+    } while (0);
+    if (rc < 0 && vd) {
+        gr_disp_t tmp = { .backend = &gr_display_virtual_backend, .backend_data = vd };
+        gr_display_virtual_close(&tmp);
+    }
+    return (rc < 0) ? NULL : disp;
+}
+
+const uint8_t *gr_display_virtual_ram(const gr_disp_t *disp, size_t *len)
+{
+    if (disp && disp->backend == &gr_display_virtual_backend && disp->backend_data) {
+        const gr_display_virtual_t *vd = (const gr_display_virtual_t *)disp->backend_data;
+        if (len) {
+            *len = vd->len;
+        }
+        return vd->ram;
+    }
+    return NULL;
+}
+
+uint64_t gr_display_virtual_frames(const gr_disp_t *disp)
+{
+    if (disp && disp->backend == &gr_display_virtual_backend && disp->backend_data) {
+        return ((const gr_display_virtual_t *)disp->backend_data)->frames;
+    }
+    return 0;
+}
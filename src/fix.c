@@ -0,0 +1,123 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_MATH_H
+#include <math.h>
+#endif
+#include <time.h>
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+
+uint64_t gr_monotonic_ns()
+{
+    struct timespec ts = { 0 };
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+void gr_fix_init(gr_fix_t *fix)
+{
+    if (fix) {
+        memset(fix, 0, sizeof(*fix));
+        fix->speed_kmph = NAN;
+        fix->utc_ms = -1;
+    }
+}
+
+static int32_t gr_fix_latlon_e7(int degrees, float minutes,
+                    gpsdata_direction_t dir)
+{
+    double deg = (double)degrees + ((double)minutes / 60.0);
+    /* the direction string is "S"/"SOUTH" or "W"/"WEST" for negatives */
+    char c = gpsdata_direction_tostring(dir)[0];
+    if (c == 'S' || c == 's' || c == 'W' || c == 'w')
+        deg = -deg;
+    return GR_FIX_DEG_TO_E7(deg);
+}
+
+int gr_fix_update(gr_fix_t *fix, const gpsdata_data_t *item, uint64_t mono_ns)
+{
+    if (!fix || !item)
+        return -1;
+    if (item->latitude.direction != GPSDATA_DIRECTION_UNSET &&
+        item->longitude.direction != GPSDATA_DIRECTION_UNSET) {
+        int32_t lat_e7 = gr_fix_latlon_e7(item->latitude.degrees,
+                        item->latitude.minutes, item->latitude.direction);
+        int32_t lon_e7 = gr_fix_latlon_e7(item->longitude.degrees,
+                        item->longitude.minutes, item->longitude.direction);
+        int64_t utc_ms = (((int64_t)item->utc_time.hour * 60 + item->utc_time.minute) * 60 +
+                        item->utc_time.second) * 1000 + item->utc_time.millisecond;
+        bool have = GR_FIX_HAS_POSITION(fix) || (fix->state & GR_FIX_STATE_PENDING);
+        /* GGA and RMC of the same epoch both carry the position, only the
+         * first one of them starts an epoch */
+        if (!have || lat_e7 != fix->lat_e7 || lon_e7 != fix->lon_e7 ||
+            utc_ms != fix->utc_ms) {
+            /* the last epoch never got a speed, so none is coming */
+            if (fix->state & GR_FIX_STATE_PENDING)
+                fix->state |= GR_FIX_STATE_NO_SPEED;
+            fix->lat_e7 = lat_e7;
+            fix->lon_e7 = lon_e7;
+            fix->utc_ms = utc_ms;
+            fix->state |= GR_FIX_STATE_PENDING;
+        }
+    }
+    bool has_speed = !isnan(item->speed_kmph);
+    if (has_speed) {
+        fix->speed_kmph = item->speed_kmph;
+        fix->state &= (uint8_t)~GR_FIX_STATE_NO_SPEED;
+    }
+    if ((fix->state & GR_FIX_STATE_PENDING) &&
+        (has_speed || (fix->state & GR_FIX_STATE_NO_SPEED))) {
+        fix->state &= (uint8_t)~GR_FIX_STATE_PENDING;
+        fix->mono_ns = mono_ns;
+        fix->seq++;
+        return 1;
+    }
+    return 0;
+}
+
+int64_t gr_nmea_utc_ms(const char *s, size_t len)
+{
+    /* $ttGGA,hhmmss.sss,... or $ttRMC,hhmmss.sss,... */
+    if (!s || len < 14 || s[0] != '$' || s[6] != ',')
+        return -1;
+    if (strncmp(s + 3, "GGA", 3) != 0 && strncmp(s + 3, "RMC", 3) != 0)
+        return -1;
+    const char *p = s + 7;
+    const char *end = s + len;
+    int digits[6] = { 0 };
+    for (int i = 0; i < 6; ++i) {
+        if (p >= end || *p < '0' || *p > '9')
+            return -1;
+        digits[i] = *p++ - '0';
+    }
+    int64_t hh = digits[0] * 10 + digits[1];
+    int64_t mm = digits[2] * 10 + digits[3];
+    int64_t ss = digits[4] * 10 + digits[5];
+    if (hh > 23 || mm > 59 || ss > 60)
+        return -1;
+    int64_t ms = 0;
+    if (p < end && *p == '.') {
+        int64_t scale = 100;
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+            ms += (*p - '0') * scale;
+            scale /= 10;
+        }
+    }
+    return ((hh * 60 + mm) * 60 + ss) * 1000 + ms;
+}
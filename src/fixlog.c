@@ -0,0 +1,217 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef GOODRACER_HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_fixlog.h>
+
+/* at 10Hz this flushes every 10 seconds */
+#define GR_FIXLOG_FLUSH_EVERY 100
+
+struct gr_fixlog_t_ {
+    FILE *fp;
+    char *buf; /* stdio buffer */
+    uint64_t num_written;
+};
+
+gr_fixlog_t *gr_fixlog_open(const char *path)
+{
+    int rc = 0;
+    gr_fixlog_t *log = NULL;
+    do {
+        if (!path) {
+            GRLOG_ERROR("Fix log path cannot be NULL\n");
+            rc = -1;
+            break;
+        }
+        log = GR_CALLOC(1, sizeof(*log));
+        if (!log) {
+            GRLOG_OUTOFMEM(sizeof(*log));
+            rc = -1;
+            break;
+        }
+        log->fp = fopen(path, "wb");
+        if (!log->fp) {
+            int err = errno;
+            GRLOG_ERROR("Failed to open fix log %s. Error: %s(%d)\n",
+                    path, strerror(err), err);
+            rc = -1;
+            break;
+        }
+        size_t bufsz = GR_FIXLOG_FLUSH_EVERY * sizeof(gr_fixlog_record_t) * 2;
+        log->buf = GR_CALLOC(1, bufsz);
+        if (log->buf) {
+            setvbuf(log->fp, log->buf, _IOFBF, bufsz);
+        }
+        uint32_t hdr[2] = { GR_FIXLOG_VERSION, sizeof(gr_fixlog_record_t) };
+        if (fwrite(GR_FIXLOG_MAGIC, 8, 1, log->fp) != 1 ||
+            fwrite(hdr, sizeof(hdr), 1, log->fp) != 1) {
+            GRLOG_ERROR("Failed to write fix log header to %s\n", path);
+            rc = -1;
+            break;
+        }
+        GRLOG_INFO("Logging fixes to %s\n", path);
+    } while (0);
+    if (rc < 0) {
+        gr_fixlog_close(log);
+        log = NULL;
+    }
+    return log;
+}
+
+int gr_fixlog_write(gr_fixlog_t *log, const gr_fix_t *fix)
+{
+    if (!log || !log->fp || !fix)
+        return -1;
+    gr_fixlog_record_t rec = {
+        .mono_ns = fix->mono_ns,
+        .rx_ns = fix->rx_ns,
+        .utc_ms = fix->utc_ms,
+        .lat_e7 = fix->lat_e7,
+        .lon_e7 = fix->lon_e7,
+        .speed_kmph = fix->speed_kmph,
+        .seq = fix->seq
+    };
+    if (fwrite(&rec, sizeof(rec), 1, log->fp) != 1) {
+        GRLOG_ERROR("Failed to write to fix log\n");
+        return -1;
+    }
+    log->num_written++;
+    if ((log->num_written % GR_FIXLOG_FLUSH_EVERY) == 0) {
+        fflush(log->fp);
+    }
+    return 0;
+}
+
+void gr_fixlog_close(gr_fixlog_t *log)
+{
+    if (log) {
+        if (log->fp) {
+            fclose(log->fp);
+            log->fp = NULL;
+            GRLOG_DEBUG("Fix log closed after %" PRIu64 " fixes\n", log->num_written);
+        }
+        GR_FREE(log->buf);
+        GR_FREE(log);
+    }
+}
+
+static FILE *gr_fixlog_open_reader(const char *path, uint32_t *version)
+{
+    char magic[8] = { 0 };
+    uint32_t hdr[2] = { 0 };
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return NULL;
+    if (fread(magic, sizeof(magic), 1, fp) != 1 ||
+        memcmp(magic, GR_FIXLOG_MAGIC, sizeof(magic)) != 0 ||
+        fread(hdr, sizeof(hdr), 1, fp) != 1 ||
+        !((hdr[0] == GR_FIXLOG_VERSION && hdr[1] == sizeof(gr_fixlog_record_t)) ||
+          (hdr[0] == 1 && hdr[1] == sizeof(gr_fixlog_record_v1_t)))) {
+        fclose(fp);
+        return NULL;
+    }
+    if (version)
+        *version = hdr[0];
+    return fp;
+}
+
+/* reads the next record of either version into rec */
+static bool gr_fixlog_read_record(FILE *fp, uint32_t version,
+                gr_fixlog_record_t *rec)
+{
+    if (version == GR_FIXLOG_VERSION)
+        return fread(rec, sizeof(*rec), 1, fp) == 1;
+    gr_fixlog_record_v1_t v1;
+    if (fread(&v1, sizeof(v1), 1, fp) != 1)
+        return false;
+    rec->mono_ns = v1.mono_ns;
+    rec->rx_ns = 0;
+    rec->utc_ms = -1;
+    rec->lat_e7 = v1.lat_e7;
+    rec->lon_e7 = v1.lon_e7;
+    rec->speed_kmph = v1.speed_kmph;
+    rec->seq = v1.seq;
+    return true;
+}
+
+bool gr_fixlog_is_fixlog(const char *path)
+{
+    FILE *fp = path ? gr_fixlog_open_reader(path, NULL) : NULL;
+    if (fp) {
+        fclose(fp);
+        return true;
+    }
+    return false;
+}
+
+int gr_fixlog_read_all(const char *path, gr_fix_t **fixes, size_t *num)
+{
+    if (!path || !fixes || !num)
+        return -1;
+    uint32_t version = 0;
+    FILE *fp = gr_fixlog_open_reader(path, &version);
+    if (!fp) {
+        GRLOG_ERROR("%s is not a version 1 to %d fix log\n", path, GR_FIXLOG_VERSION);
+        return -1;
+    }
+    size_t cap = 4096, count = 0;
+    gr_fix_t *arr = calloc(cap, sizeof(gr_fix_t));
+    if (!arr) {
+        GRLOG_OUTOFMEM(cap * sizeof(gr_fix_t));
+        fclose(fp);
+        return -1;
+    }
+    gr_fixlog_record_t rec;
+    while (gr_fixlog_read_record(fp, version, &rec)) {
+        if (count == cap) {
+            gr_fix_t *tmp = realloc(arr, 2 * cap * sizeof(gr_fix_t));
+            if (!tmp) {
+                GRLOG_OUTOFMEM(2 * cap * sizeof(gr_fix_t));
+                GR_FREE(arr);
+                fclose(fp);
+                return -1;
+            }
+            arr = tmp;
+            cap *= 2;
+        }
+        /* the merge state is not logged */
+        gr_fix_init(&arr[count]);
+        arr[count].mono_ns = rec.mono_ns;
+        arr[count].rx_ns = rec.rx_ns;
+        arr[count].utc_ms = rec.utc_ms;
+        arr[count].lat_e7 = rec.lat_e7;
+        arr[count].lon_e7 = rec.lon_e7;
+        arr[count].speed_kmph = rec.speed_kmph;
+        arr[count].seq = rec.seq;
+        count++;
+    }
+    fclose(fp);
+    *fixes = arr;
+    *num = count;
+    return 0;
+}
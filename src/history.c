@@ -0,0 +1,399 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef GOODRACER_HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_laptimer.h>
+#include <goodracer_history.h>
+
+/* fewer summary slots than this and the laps in the tiers could not all
+ * have one */
+#define GR_HISTORY_MIN_LAP_SLOTS 16
+
+typedef struct {
+    gr_history_lap_t pub;
+    uint64_t first; /* position of the first point in its tier */
+    uint64_t fixes; /* fed while in progress */
+} gr_history_slot_t;
+
+/* ring of points. the laps in a tier are contiguous and in the order they
+ * were driven, and so are their summary slots */
+typedef struct {
+    gr_history_point_t *points;
+    size_t cap;
+    uint64_t head; /* next position to write */
+    uint64_t tail; /* oldest position in use */
+    uint64_t first_seq; /* summary of its oldest lap */
+    size_t num_laps;
+} gr_history_tier_t;
+
+struct gr_history_t_ {
+    size_t max_bytes;
+    size_t used_bytes;
+    gr_history_slot_t *laps;
+    size_t lap_slots;
+    uint64_t oldest_seq;
+    uint64_t next_seq;
+    bool in_lap; /* the newest summary is the lap in progress */
+    gr_history_tier_t tiers[GR_HISTORY_TIERS];
+    /* best lap */
+    gr_history_lap_t best;
+    gr_history_point_t *best_points;
+    size_t best_cap;
+    uint32_t best_sector_ms[GR_LAPTIMER_MAX_GATES];
+    uint32_t best_sector_lap[GR_LAPTIMER_MAX_GATES];
+    gr_history_stats_t stats;
+};
+
+gr_history_t *gr_history_create(size_t max_bytes)
+{
+    int rc = 0;
+    gr_history_t *h = NULL;
+    do {
+        if (max_bytes < GR_HISTORY_MIN_BYTES) {
+            GRLOG_ERROR("History needs at least %d bytes, %zu given\n",
+                    GR_HISTORY_MIN_BYTES, max_bytes);
+            rc = -1;
+            break;
+        }
+        h = GR_CALLOC(1, sizeof(*h));
+        if (!h) {
+            GRLOG_OUTOFMEM(sizeof(*h));
+            rc = -1;
+            break;
+        }
+        h->max_bytes = max_bytes;
+        h->used_bytes = sizeof(*h);
+        /* an eighth each for the summaries and the best lap, the rest is
+         * split 2:1:1 between the tiers */
+        size_t avail = max_bytes - sizeof(*h);
+        h->lap_slots = (avail / 8) / sizeof(gr_history_slot_t);
+        if (h->lap_slots < GR_HISTORY_MIN_LAP_SLOTS) {
+            GRLOG_ERROR("History of %zu bytes is too small\n", max_bytes);
+            rc = -1;
+            break;
+        }
+        h->laps = GR_CALLOC(h->lap_slots, sizeof(gr_history_slot_t));
+        if (!h->laps) {
+            GRLOG_OUTOFMEM(h->lap_slots * sizeof(gr_history_slot_t));
+            rc = -1;
+            break;
+        }
+        h->used_bytes += h->lap_slots * sizeof(gr_history_slot_t);
+        h->best_cap = (avail / 8) / sizeof(gr_history_point_t);
+        h->best_points = GR_CALLOC(h->best_cap, sizeof(gr_history_point_t));
+        if (!h->best_points) {
+            GRLOG_OUTOFMEM(h->best_cap * sizeof(gr_history_point_t));
+            rc = -1;
+            break;
+        }
+        h->used_bytes += h->best_cap * sizeof(gr_history_point_t);
+        size_t tier_bytes = (avail / 4) * 3;
+        for (size_t k = 0; k < GR_HISTORY_TIERS; ++k) {
+            gr_history_tier_t *t = &(h->tiers[k]);
+            size_t share = (k == 0) ? (tier_bytes / 2) :
+                                (tier_bytes / 2 / (GR_HISTORY_TIERS - 1));
+            t->cap = share / sizeof(gr_history_point_t);
+            t->points = GR_CALLOC(t->cap, sizeof(gr_history_point_t));
+            if (!t->points) {
+                GRLOG_OUTOFMEM(t->cap * sizeof(gr_history_point_t));
+                rc = -1;
+                break;
+            }
+            h->used_bytes += t->cap * sizeof(gr_history_point_t);
+        }
+        if (rc < 0)
+            break;
+        GRLOG_DEBUG("History uses %zu of %zu bytes, %zu lap summaries, %zu points at full resolution\n",
+                h->used_bytes, max_bytes, h->lap_slots, h->tiers[0].cap);
+    } while (0);
+    if (rc < 0) {
+        gr_history_free(h);
+        h = NULL;
+    }
+    return h;
+}
+
+void gr_history_free(gr_history_t *h)
+{
+    if (h) {
+        for (size_t k = 0; k < GR_HISTORY_TIERS; ++k) {
+            GR_FREE(h->tiers[k].points);
+        }
+        GR_FREE(h->best_points);
+        GR_FREE(h->laps);
+        GR_FREE(h);
+    }
+}
+
+static inline gr_history_slot_t *gr_history_slot(const gr_history_t *h, uint64_t seq)
+{
+    return &(h->laps[seq % h->lap_slots]);
+}
+
+static inline gr_history_point_t *gr_history_tier_point(const gr_history_tier_t *t,
+                                    uint64_t pos)
+{
+    return &(t->points[pos % t->cap]);
+}
+
+/* move the oldest lap of tier k into the next one with fewer points, making
+ * room there first. the last tier just lets go of the points */
+static void gr_history_demote(gr_history_t *h, size_t k)
+{
+    gr_history_tier_t *src = &(h->tiers[k]);
+    uint64_t seq = src->first_seq;
+    gr_history_slot_t *slot = gr_history_slot(h, seq);
+    size_t n = slot->pub.num_points;
+    uint64_t first = slot->first;
+    if (k + 1 < GR_HISTORY_TIERS) {
+        gr_history_tier_t *dst = &(h->tiers[k + 1]);
+        size_t step = GR_HISTORY_DECIMATION;
+        while ((n + step - 1) / step > dst->cap) {
+            step *= 2;
+        }
+        size_t m = (n + step - 1) / step;
+        while ((dst->cap - (size_t)(dst->head - dst->tail)) < m) {
+            gr_history_demote(h, k + 1);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            *gr_history_tier_point(dst, dst->head + i) =
+                            *gr_history_tier_point(src, first + (uint64_t)i * step);
+        }
+        if (dst->num_laps == 0)
+            dst->first_seq = seq;
+        dst->num_laps++;
+        slot->first = dst->head;
+        dst->head += m;
+        slot->pub.tier = (uint8_t)(k + 1);
+        slot->pub.num_points = m;
+        slot->pub.stride *= (uint32_t)step;
+    } else {
+        slot->pub.tier = GR_HISTORY_TIERS;
+        slot->pub.num_points = 0;
+        slot->first = 0;
+    }
+    src->tail = first + n;
+    src->first_seq = seq + 1;
+    src->num_laps--;
+    h->stats.demoted[k]++;
+}
+
+/* the summary slots are full, drop the oldest summary and its points */
+static void gr_history_forget_oldest(gr_history_t *h)
+{
+    gr_history_slot_t *slot = gr_history_slot(h, h->oldest_seq);
+    if (slot->pub.tier < GR_HISTORY_TIERS) {
+        gr_history_tier_t *t = &(h->tiers[slot->pub.tier]);
+        t->tail = slot->first + slot->pub.num_points;
+        t->first_seq = h->oldest_seq + 1;
+        t->num_laps--;
+    }
+    h->oldest_seq++;
+    h->stats.forgotten++;
+}
+
+/* keep every other point of the lap in progress when it has the first tier
+ * to itself and filled it up, e.g. a long stop in the pits */
+static void gr_history_decimate_current(gr_history_t *h, gr_history_slot_t *cur)
+{
+    gr_history_tier_t *t = &(h->tiers[0]);
+    size_t m = (cur->pub.num_points + 1) / 2;
+    for (size_t i = 0; i < m; ++i) {
+        *gr_history_tier_point(t, cur->first + i) =
+                        *gr_history_tier_point(t, cur->first + (uint64_t)i * 2);
+    }
+    t->head = cur->first + m;
+    cur->pub.num_points = m;
+    cur->pub.stride *= 2;
+    h->stats.decimated++;
+}
+
+static void gr_history_open_lap(gr_history_t *h, const gr_lap_state_t *lap)
+{
+    gr_history_tier_t *t = &(h->tiers[0]);
+    if ((h->next_seq - h->oldest_seq) >= h->lap_slots) {
+        gr_history_forget_oldest(h);
+    }
+    gr_history_slot_t *slot = gr_history_slot(h, h->next_seq);
+    memset(slot, 0, sizeof(*slot));
+    slot->pub.lap = lap->lap + 1;
+    slot->pub.num_sectors = lap->num_sectors;
+    slot->pub.stride = 1;
+    slot->first = t->head;
+    if (t->num_laps == 0)
+        t->first_seq = h->next_seq;
+    t->num_laps++;
+    h->next_seq++;
+    h->in_lap = true;
+}
+
+static void gr_history_close_lap(gr_history_t *h, const gr_lap_state_t *lap)
+{
+    gr_history_slot_t *cur = gr_history_slot(h, h->next_seq - 1);
+    h->in_lap = false;
+    cur->pub.lap_ms = lap->last_lap_ms;
+    memcpy(cur->pub.sector_ms, lap->sector_ms, sizeof(cur->pub.sector_ms));
+    h->stats.laps++;
+    if (h->best.lap_ms != 0 && cur->pub.lap_ms >= h->best.lap_ms)
+        return;
+    /* the lap just driven is still in the first tier */
+    size_t n = cur->pub.num_points;
+    size_t step = (n + h->best_cap - 1) / h->best_cap;
+    if (step == 0)
+        step = 1;
+    size_t m = (n + step - 1) / step;
+    for (size_t i = 0; i < m; ++i) {
+        h->best_points[i] = *gr_history_tier_point(&(h->tiers[0]),
+                                    cur->first + (uint64_t)i * step);
+    }
+    memcpy(&(h->best), &(cur->pub), sizeof(h->best));
+    h->best.num_points = m;
+    h->best.stride *= (uint32_t)step;
+}
+
+/* the lap timer has the best splits but not the laps they came from */
+static void gr_history_update_sectors(gr_history_t *h, const gr_lap_state_t *lap,
+                    int events)
+{
+    uint32_t num = (events & GR_LAPTIMER_EVENT_LAP) ? lap->lap : (lap->lap + 1);
+    for (size_t s = 0; s < lap->num_sectors && s < GR_LAPTIMER_MAX_GATES; ++s) {
+        if (lap->best_sector_ms[s] != 0 &&
+            (h->best_sector_ms[s] == 0 || lap->best_sector_ms[s] < h->best_sector_ms[s])) {
+            h->best_sector_ms[s] = lap->best_sector_ms[s];
+            h->best_sector_lap[s] = num;
+        }
+    }
+}
+
+int gr_history_update(gr_history_t *h, const gr_fix_t *fix,
+                const gr_lap_state_t *lap, int events)
+{
+    if (!h || !fix || !lap || events < 0)
+        return -1;
+    if (!lap->started || !GR_FIX_HAS_POSITION(fix))
+        return 0;
+    if ((events & GR_LAPTIMER_EVENT_START) && h->in_lap) {
+        /* the lap timer was reset, that lap never finished */
+        h->in_lap = false;
+    }
+    if (events & GR_LAPTIMER_EVENT_SECTOR) {
+        gr_history_update_sectors(h, lap, events);
+    }
+    if ((events & GR_LAPTIMER_EVENT_LAP) && h->in_lap) {
+        gr_history_close_lap(h, lap);
+    }
+    if (!h->in_lap) {
+        gr_history_open_lap(h, lap);
+    }
+    h->stats.fixes++;
+    gr_history_slot_t *cur = gr_history_slot(h, h->next_seq - 1);
+    if ((cur->fixes++ % cur->pub.stride) != 0)
+        return 0;
+    gr_history_tier_t *t = &(h->tiers[0]);
+    while ((size_t)(t->head - t->tail) >= t->cap) {
+        if (t->num_laps > 1) {
+            gr_history_demote(h, 0);
+        } else {
+            gr_history_decimate_current(h, cur);
+        }
+    }
+    gr_history_point_t *pt = gr_history_tier_point(t, t->head);
+    pt->t_ms = (fix->mono_ns > lap->lap_start_ns) ?
+                (uint32_t)((fix->mono_ns - lap->lap_start_ns) / 1000000ULL) : 0;
+    pt->lat_e7 = fix->lat_e7;
+    pt->lon_e7 = fix->lon_e7;
+    pt->speed_kmph = fix->speed_kmph;
+    t->head++;
+    cur->pub.num_points++;
+    return 1;
+}
+
+size_t gr_history_num_laps(const gr_history_t *h)
+{
+    return h ? (size_t)(h->next_seq - h->oldest_seq) : 0;
+}
+
+const gr_history_lap_t *gr_history_lap(const gr_history_t *h, size_t idx)
+{
+    if (!h || idx >= gr_history_num_laps(h))
+        return NULL;
+    return &(gr_history_slot(h, h->next_seq - 1 - idx)->pub);
+}
+
+size_t gr_history_lap_points(const gr_history_t *h, size_t idx,
+                gr_history_point_t *points, size_t max)
+{
+    if (!h || !points || idx >= gr_history_num_laps(h))
+        return 0;
+    const gr_history_slot_t *slot = gr_history_slot(h, h->next_seq - 1 - idx);
+    if (slot->pub.tier >= GR_HISTORY_TIERS)
+        return 0;
+    const gr_history_tier_t *t = &(h->tiers[slot->pub.tier]);
+    size_t n = (slot->pub.num_points < max) ? slot->pub.num_points : max;
+    for (size_t i = 0; i < n; ++i) {
+        points[i] = *gr_history_tier_point(t, slot->first + i);
+    }
+    return n;
+}
+
+const gr_history_lap_t *gr_history_best_lap(const gr_history_t *h)
+{
+    return (h && h->best.lap_ms > 0) ? &(h->best) : NULL;
+}
+
+const gr_history_point_t *gr_history_best_points(const gr_history_t *h, size_t *num)
+{
+    if (!h || h->best.lap_ms == 0) {
+        if (num)
+            *num = 0;
+        return NULL;
+    }
+    if (num)
+        *num = h->best.num_points;
+    return h->best_points;
+}
+
+uint32_t gr_history_best_sector(const gr_history_t *h, uint8_t sector, uint32_t *lap)
+{
+    if (!h || sector >= GR_LAPTIMER_MAX_GATES)
+        return 0;
+    if (lap)
+        *lap = h->best_sector_lap[sector];
+    return h->best_sector_ms[sector];
+}
+
+int gr_history_get_stats(const gr_history_t *h, gr_history_stats_t *st)
+{
+    if (!h || !st)
+        return -1;
+    memcpy(st, &(h->stats), sizeof(*st));
+    st->max_bytes = h->max_bytes;
+    st->used_bytes = h->used_bytes;
+    st->lap_slots = h->lap_slots;
+    st->best_points = h->best_cap;
+    for (size_t k = 0; k < GR_HISTORY_TIERS; ++k) {
+        st->tier_points[k] = h->tiers[k].cap;
+        st->tier_used[k] = (size_t)(h->tiers[k].head - h->tiers[k].tail);
+        st->tier_laps[k] = h->tiers[k].num_laps;
+    }
+    return 0;
+}
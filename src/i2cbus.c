@@ -0,0 +1,424 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef GOODRACER_HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef GOODRACER_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#include <time.h>
+#ifdef GOODRACER_HAVE_SYS_IOCTL_H
+#include <sys/ioctl.h>
+#endif
+#ifdef GOODRACER_HAVE_LINUX_I2C_H
+#include <linux/i2c.h>
+#endif
+#ifdef GOODRACER_HAVE_LINUX_I2C_DEV_H
+#include <linux/i2c-dev.h>
+#endif
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_i2cbus.h>
+
+#define GR_I2CBUS_MOCK_REGS 256
+
+typedef struct {
+    bool used;
+    gr_i2cbus_txn_t txn;
+    uint8_t wdata[GR_I2CBUS_MAX_WRITE];
+    uint64_t submit_ns;
+    uint64_t seq;
+    int device; /* index into the device statistics */
+} gr_i2cbus_slot_t;
+
+typedef struct {
+    bool used;
+    uint8_t addr;
+    gr_i2cbus_stats_t stats;
+} gr_i2cbus_device_t;
+
+struct gr_i2cbus_t_ {
+    int fd; /* -1 for the mock bus */
+    char *dev;
+    /* mock bus */
+    uint32_t clock_hz;
+    uint8_t *mock_regs[128];
+    uint8_t mock_ptr[128];
+    /* the queue is small and scanned on every pick, which is cheaper than
+     * keeping a heap ordered when entries get replaced by tag */
+    gr_i2cbus_slot_t queue[GR_I2CBUS_QUEUE_SIZE];
+    size_t num_queued;
+    uint64_t seq;
+    gr_i2cbus_device_t devices[GR_I2CBUS_MAX_DEVICES];
+    volatile int _ref; //reference counted
+};
+
+static gr_i2cbus_t *gr_i2cbus_create()
+{
+    gr_i2cbus_t *bus = GR_CALLOC(1, sizeof(*bus));
+    if (!bus) {
+        GRLOG_OUTOFMEM(sizeof(*bus));
+        return NULL;
+    }
+    bus->fd = -1;
+    SSD1306_ATOMIC_ZERO(&(bus->_ref));
+    SSD1306_ATOMIC_INCREMENT(&(bus->_ref));
+    return bus;
+}
+
+gr_i2cbus_t *gr_i2cbus_setup(const char *dev)
+{
+    int rc = 0;
+    gr_i2cbus_t *bus = NULL;
+    do {
+        if (!dev) {
+            GRLOG_ERROR("I2C bus device path cannot be NULL\n");
+            rc = -1;
+            break;
+        }
+#if defined(GOODRACER_HAVE_LINUX_I2C_DEV_H) && defined(GOODRACER_HAVE_SYS_IOCTL_H)
+        bus = gr_i2cbus_create();
+        if (!bus) {
+            rc = -1;
+            break;
+        }
+        bus->dev = GR_STRDUP(dev);
+        if (!bus->dev) {
+            GRLOG_OUTOFMEM(strlen(dev));
+            rc = -1;
+            break;
+        }
+        bus->fd = open(dev, O_RDWR | O_CLOEXEC);
+        if (bus->fd < 0) {
+            int err = errno;
+            GRLOG_ERROR("Failed to open I2C bus %s. Error: %s(%d)\n", dev, strerror(err), err);
+            rc = -1;
+            break;
+        }
+        unsigned long funcs = 0;
+        if (ioctl(bus->fd, I2C_FUNCS, &funcs) < 0 || !(funcs & I2C_FUNC_I2C)) {
+            GRLOG_ERROR("I2C bus %s does not support plain I2C transfers\n", dev);
+            rc = -1;
+            break;
+        }
+        GRLOG_DEBUG("Opened I2C bus %s with fd %d\n", dev, bus->fd);
+#else
+        GRLOG_ERROR("I2C bus %s cannot be used, no Linux I2C support\n", dev);
+        rc = -1;
+#endif
+    } while (0);
+    if (rc < 0) {
+        gr_i2cbus_cleanup(bus);
+        bus = NULL;
+    }
+    return bus;
+}
+
+gr_i2cbus_t *gr_i2cbus_mock_setup(uint32_t clock_hz)
+{
+    if (clock_hz == 0) {
+        GRLOG_ERROR("Mock I2C bus needs a clock\n");
+        return NULL;
+    }
+    gr_i2cbus_t *bus = gr_i2cbus_create();
+    if (bus) {
+        bus->clock_hz = clock_hz;
+        GRLOG_DEBUG("Created mock I2C bus at %u Hz\n", clock_hz);
+    }
+    return bus;
+}
+
+int gr_i2cbus_mock_add_device(gr_i2cbus_t *bus, uint8_t addr)
+{
+    if (!bus || bus->clock_hz == 0 || addr > 0x7F) {
+        GRLOG_ERROR("Invalid mock I2C bus or device address\n");
+        return -1;
+    }
+    if (!bus->mock_regs[addr]) {
+        bus->mock_regs[addr] = GR_CALLOC(GR_I2CBUS_MOCK_REGS, sizeof(uint8_t));
+        if (!bus->mock_regs[addr]) {
+            GRLOG_OUTOFMEM(GR_I2CBUS_MOCK_REGS);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+const uint8_t *gr_i2cbus_mock_registers(const gr_i2cbus_t *bus, uint8_t addr)
+{
+    return (bus && addr <= 0x7F) ? bus->mock_regs[addr] : NULL;
+}
+
+void gr_i2cbus_inc_ref(gr_i2cbus_t *bus)
+{
+    if (bus) {
+        SSD1306_ATOMIC_INCREMENT(&(bus->_ref));
+    }
+}
+
+void gr_i2cbus_cleanup(gr_i2cbus_t *bus)
+{
+    if (bus) {
+        int zero = 0;
+        SSD1306_ATOMIC_DECREMENT(&(bus->_ref));
+        if (SSD1306_ATOMIC_IS_EQUAL(&(bus->_ref), &zero)) {
+            for (size_t i = 0; i < GR_I2CBUS_MAX_DEVICES; ++i) {
+                const gr_i2cbus_device_t *d = &(bus->devices[i]);
+                if (d->used && d->stats.transactions > 0) {
+                    GRLOG_INFO("I2C 0x%02x: %" PRIu64 " transactions, %" PRIu64 " bytes, %" PRIu64 " us on the bus, worst wait %" PRIu64 " us, %" PRIu64 " deadline misses\n",
+                            d->addr, d->stats.transactions, d->stats.bytes,
+                            d->stats.bus_ns / 1000, d->stats.max_wait_ns / 1000,
+                            d->stats.deadline_misses);
+                }
+            }
+            if (bus->num_queued > 0) {
+                GRLOG_WARN("Dropping %zu queued I2C transactions\n", bus->num_queued);
+            }
+            for (size_t i = 0; i < 128; ++i) {
+                GR_FREE(bus->mock_regs[i]);
+            }
+            if (bus->fd >= 0) {
+                close(bus->fd);
+                bus->fd = -1;
+            }
+            GR_FREE(bus->dev);
+            GR_FREE(bus);
+        }
+    }
+}
+
+static int gr_i2cbus_device(gr_i2cbus_t *bus, uint8_t addr)
+{
+    int avail = -1;
+    for (int i = 0; i < GR_I2CBUS_MAX_DEVICES; ++i) {
+        if (bus->devices[i].used && bus->devices[i].addr == addr)
+            return i;
+        if (!bus->devices[i].used && avail < 0)
+            avail = i;
+    }
+    if (avail >= 0) {
+        bus->devices[avail].used = true;
+        bus->devices[avail].addr = addr;
+    }
+    return avail;
+}
+
+int gr_i2cbus_submit(gr_i2cbus_t *bus, const gr_i2cbus_txn_t *txn)
+{
+    if (!bus || !txn || (txn->wlen == 0 && txn->rlen == 0) ||
+        (txn->wlen > 0 && !txn->wbuf) || txn->addr > 0x7F ||
+        txn->wlen > GR_I2CBUS_MAX_WRITE || txn->rlen > GR_I2CBUS_MAX_READ) {
+        GRLOG_ERROR("Invalid I2C transaction\n");
+        return -1;
+    }
+    int dev = gr_i2cbus_device(bus, txn->addr);
+    if (dev < 0) {
+        GRLOG_ERROR("Too many devices on the I2C bus, max is %d\n", GR_I2CBUS_MAX_DEVICES);
+        return -1;
+    }
+    gr_i2cbus_slot_t *slot = NULL;
+    gr_i2cbus_slot_t *avail = NULL;
+    for (size_t i = 0; i < GR_I2CBUS_QUEUE_SIZE; ++i) {
+        gr_i2cbus_slot_t *s = &(bus->queue[i]);
+        if (!s->used) {
+            if (!avail)
+                avail = s;
+        } else if (txn->tag != 0 && s->txn.tag == txn->tag && s->txn.addr == txn->addr) {
+            slot = s;
+            break;
+        }
+    }
+    if (slot) {
+        /* keeps its place in line, only the content is newer */
+        bus->devices[dev].stats.superseded++;
+    } else if (avail) {
+        slot = avail;
+        slot->used = true;
+        slot->submit_ns = gr_monotonic_ns();
+        slot->seq = bus->seq++;
+        bus->num_queued++;
+    } else {
+        bus->devices[dev].stats.errors++;
+        return -1;
+    }
+    memcpy(&(slot->txn), txn, sizeof(*txn));
+    if (txn->wlen > 0) {
+        memcpy(slot->wdata, txn->wbuf, txn->wlen);
+    }
+    slot->txn.wbuf = slot->wdata;
+    slot->device = dev;
+    return 0;
+}
+
+size_t gr_i2cbus_pending(const gr_i2cbus_t *bus)
+{
+    return bus ? bus->num_queued : 0;
+}
+
+static bool gr_i2cbus_before(const gr_i2cbus_slot_t *a, const gr_i2cbus_slot_t *b)
+{
+    if (a->txn.priority != b->txn.priority)
+        return a->txn.priority < b->txn.priority;
+    if (a->txn.deadline_ns != b->txn.deadline_ns) {
+        /* no deadline goes last */
+        if (a->txn.deadline_ns == 0)
+            return false;
+        if (b->txn.deadline_ns == 0)
+            return true;
+        return a->txn.deadline_ns < b->txn.deadline_ns;
+    }
+    return a->seq < b->seq;
+}
+
+static int gr_i2cbus_mock_transfer(gr_i2cbus_t *bus, const gr_i2cbus_txn_t *txn,
+                uint8_t *rbuf)
+{
+    /* 9 clocks per byte with the ACK, the address byte for every start and
+     * a couple for the start and stop */
+    uint64_t clocks = 2 + 9 * (1 + txn->wlen);
+    if (txn->rlen > 0) {
+        clocks += 9 * (1 + txn->rlen);
+    }
+    uint64_t ns = (clocks * 1000000000ULL) / bus->clock_hz;
+    struct timespec ts = { .tv_sec = ns / 1000000000ULL, .tv_nsec = ns % 1000000000ULL };
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR);
+    uint8_t *regs = bus->mock_regs[txn->addr];
+    if (!regs) {
+        return -1;
+    }
+    if (txn->wlen > 0) {
+        uint8_t reg = txn->wbuf[0];
+        for (size_t i = 1; i < txn->wlen; ++i) {
+            regs[(uint8_t)(reg + i - 1)] = txn->wbuf[i];
+        }
+        bus->mock_ptr[txn->addr] = reg;
+    }
+    for (size_t i = 0; i < txn->rlen; ++i) {
+        rbuf[i] = regs[bus->mock_ptr[txn->addr]++];
+    }
+    return 0;
+}
+
+static int gr_i2cbus_transfer(gr_i2cbus_t *bus, const gr_i2cbus_txn_t *txn,
+                uint8_t *rbuf)
+{
+    if (bus->clock_hz > 0) {
+        return gr_i2cbus_mock_transfer(bus, txn, rbuf);
+    }
+#if defined(GOODRACER_HAVE_LINUX_I2C_DEV_H) && defined(GOODRACER_HAVE_SYS_IOCTL_H)
+    struct i2c_msg msgs[2];
+    struct i2c_rdwr_ioctl_data data = { .msgs = msgs, .nmsgs = 0 };
+    if (txn->wlen > 0) {
+        msgs[data.nmsgs].addr = txn->addr;
+        msgs[data.nmsgs].flags = 0;
+        msgs[data.nmsgs].len = (uint16_t)txn->wlen;
+        msgs[data.nmsgs].buf = (uint8_t *)txn->wbuf;
+        data.nmsgs++;
+    }
+    if (txn->rlen > 0) {
+        msgs[data.nmsgs].addr = txn->addr;
+        msgs[data.nmsgs].flags = I2C_M_RD;
+        msgs[data.nmsgs].len = (uint16_t)txn->rlen;
+        msgs[data.nmsgs].buf = rbuf;
+        data.nmsgs++;
+    }
+    if (ioctl(bus->fd, I2C_RDWR, &data) < 0) {
+        int err = errno;
+        GRLOG_ERROR("I2C transfer to 0x%02x on %s failed. Error: %s(%d)\n",
+                txn->addr, bus->dev, strerror(err), err);
+        return -1;
+    }
+    return 0;
+#else
+    (void)rbuf;
+    return -1;
+#endif
+}
+
+int gr_i2cbus_run(gr_i2cbus_t *bus, uint64_t budget_ns)
+{
+    if (!bus)
+        return -1;
+    int count = 0;
+    uint64_t start_ns = gr_monotonic_ns();
+    uint64_t now_ns = start_ns;
+    while (bus->num_queued > 0) {
+        if (count > 0 && (now_ns - start_ns) >= budget_ns)
+            break;
+        gr_i2cbus_slot_t *next = NULL;
+        for (size_t i = 0; i < GR_I2CBUS_QUEUE_SIZE; ++i) {
+            gr_i2cbus_slot_t *s = &(bus->queue[i]);
+            if (s->used && (!next || gr_i2cbus_before(s, next))) {
+                next = s;
+            }
+        }
+        /* the slot is free before the callback so it can queue more */
+        gr_i2cbus_slot_t cur;
+        memcpy(&cur, next, sizeof(cur));
+        cur.txn.wbuf = cur.wdata;
+        next->used = false;
+        bus->num_queued--;
+        uint8_t rbuf[GR_I2CBUS_MAX_READ] = { 0 };
+        gr_i2cbus_stats_t *st = &(bus->devices[cur.device].stats);
+        uint64_t wait_ns = now_ns - cur.submit_ns;
+        if (cur.txn.deadline_ns > 0 && now_ns > cur.txn.deadline_ns) {
+            st->deadline_misses++;
+        }
+        int rc = gr_i2cbus_transfer(bus, &(cur.txn), rbuf);
+        uint64_t end_ns = gr_monotonic_ns();
+        uint64_t txn_ns = end_ns - now_ns;
+        st->transactions++;
+        st->bytes += cur.txn.wlen + cur.txn.rlen;
+        st->bus_ns += txn_ns;
+        if (txn_ns > st->max_txn_ns)
+            st->max_txn_ns = txn_ns;
+        if (wait_ns > st->max_wait_ns)
+            st->max_wait_ns = wait_ns;
+        if (rc < 0)
+            st->errors++;
+        if (cur.txn.cb) {
+            cur.txn.cb(rc, rbuf, (rc < 0) ? 0 : cur.txn.rlen, cur.txn.arg);
+        }
+        count++;
+        now_ns = gr_monotonic_ns();
+    }
+    return count;
+}
+
+int gr_i2cbus_get_stats(const gr_i2cbus_t *bus, uint8_t addr, gr_i2cbus_stats_t *stats)
+{
+    if (!bus || !stats)
+        return -1;
+    for (size_t i = 0; i < GR_I2CBUS_MAX_DEVICES; ++i) {
+        if (bus->devices[i].used && bus->devices[i].addr == addr) {
+            memcpy(stats, &(bus->devices[i].stats), sizeof(*stats));
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef GOODRACER_HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_MATH_H
+#include <math.h>
+#endif
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_laptimer.h>
+
+/* ignore a crossing of the same gate this soon after the previous one. with
+ * only a start/finish line GPS jitter right on top of it can otherwise count
+ * a lap twice.
+ */
+#define GR_LAPTIMER_DEBOUNCE_NS 2000000000ULL
+
+struct gr_laptimer_t_ {
+    gr_gate_t gates[GR_LAPTIMER_MAX_GATES];
+    size_t num_gates;
+    gr_fix_t prev; /* previous fix, to form the segment travelled */
+    bool has_prev;
+    uint64_t last_crossing_ns;
+    gr_lap_state_t state;
+};
+
+gr_laptimer_t *gr_laptimer_create()
+{
+    gr_laptimer_t *lt = GR_CALLOC(1, sizeof(*lt));
+    if (!lt) {
+        GRLOG_OUTOFMEM(sizeof(*lt));
+        return NULL;
+    }
+    gr_laptimer_reset(lt);
+    return lt;
+}
+
+void gr_laptimer_free(gr_laptimer_t *lt)
+{
+    GR_FREE(lt);
+}
+
+int gr_laptimer_add_gate(gr_laptimer_t *lt, const gr_gate_t *gate)
+{
+    if (!lt || !gate)
+        return -1;
+    if (lt->num_gates >= GR_LAPTIMER_MAX_GATES) {
+        GRLOG_ERROR("Cannot add more than %d timing gates\n", GR_LAPTIMER_MAX_GATES);
+        return -1;
+    }
+    memcpy(&(lt->gates[lt->num_gates]), gate, sizeof(*gate));
+    lt->num_gates++;
+    lt->state.num_sectors = (uint8_t)lt->num_gates;
+    return 0;
+}
+
+size_t gr_laptimer_num_gates(const gr_laptimer_t *lt)
+{
+    return lt ? lt->num_gates : 0;
+}
+
+void gr_laptimer_reset(gr_laptimer_t *lt)
+{
+    if (lt) {
+        memset(&(lt->state), 0, sizeof(lt->state));
+        lt->state.num_sectors = (uint8_t)lt->num_gates;
+        gr_fix_init(&(lt->prev));
+        lt->has_prev = false;
+        lt->last_crossing_ns = 0;
+    }
+}
+
+const gr_lap_state_t *gr_laptimer_state(const gr_laptimer_t *lt)
+{
+    return lt ? &(lt->state) : NULL;
+}
+
+uint32_t gr_lap_state_elapsed_ms(const gr_lap_state_t *st, uint64_t now_ns)
+{
+    if (!st || !st->started || now_ns < st->lap_start_ns)
+        return 0;
+    return (uint32_t)((now_ns - st->lap_start_ns) / 1000000ULL);
+}
+
+/* checks if the segment travelled between the two fixes crosses the gate
+ * using a local flat-earth projection, which is plenty accurate over the
+ * few meters between two fixes. on a crossing the fraction of the travelled
+ * segment at which it happened is returned in frac.
+ */
+static bool gr_laptimer_crosses(const gr_gate_t *g, const gr_fix_t *p,
+                        const gr_fix_t *q, double *frac)
+{
+    double coslat = cos(GR_FIX_E7_TO_DEG(p->lat_e7) * M_PI / 180.0);
+    /* everything relative to the previous fix to keep the numbers small */
+    double ax = (double)(g->lon1_e7 - p->lon_e7) * coslat;
+    double ay = (double)(g->lat1_e7 - p->lat_e7);
+    double bx = (double)(g->lon2_e7 - p->lon_e7) * coslat;
+    double by = (double)(g->lat2_e7 - p->lat_e7);
+    double qx = (double)(q->lon_e7 - p->lon_e7) * coslat;
+    double qy = (double)(q->lat_e7 - p->lat_e7);
+    double gx = bx - ax;
+    double gy = by - ay;
+    double d = qx * gy - qy * gx;
+    if (fabs(d) < 1e-12)
+        return false; /* parallel or not moving */
+    double t = (ax * gy - ay * gx) / d; /* along the travelled segment */
+    double u = (ax * qy - ay * qx) / d; /* along the gate */
+    if (t < 0.0 || t > 1.0 || u < 0.0 || u > 1.0)
+        return false;
+    if (frac)
+        *frac = t;
+    return true;
+}
+
+int gr_laptimer_update(gr_laptimer_t *lt, const gr_fix_t *fix)
+{
+    int events = GR_LAPTIMER_EVENT_NONE;
+    if (!lt || !fix)
+        return -1;
+    if (lt->num_gates == 0 || !GR_FIX_HAS_POSITION(fix))
+        return GR_LAPTIMER_EVENT_NONE;
+    if (lt->has_prev && fix->mono_ns > lt->prev.mono_ns) {
+        gr_lap_state_t *st = &(lt->state);
+        size_t next = st->started ? ((st->sector + 1) % lt->num_gates) : 0;
+        double frac = 0.0;
+        if (gr_laptimer_crosses(&(lt->gates[next]), &(lt->prev), fix, &frac)) {
+            uint64_t xing_ns = lt->prev.mono_ns +
+                (uint64_t)(frac * (double)(fix->mono_ns - lt->prev.mono_ns));
+            if (lt->num_gates > 1 || lt->last_crossing_ns == 0 ||
+                (xing_ns - lt->last_crossing_ns) >= GR_LAPTIMER_DEBOUNCE_NS) {
+                lt->last_crossing_ns = xing_ns;
+                if (!st->started) {
+                    st->started = true;
+                    st->sector = 0;
+                    st->lap_start_ns = xing_ns;
+                    st->sector_start_ns = xing_ns;
+                    events |= GR_LAPTIMER_EVENT_START;
+                    GRLOG_DEBUG("Lap timing started\n");
+                } else {
+                    uint32_t split = (uint32_t)((xing_ns - st->sector_start_ns) / 1000000ULL);
+                    st->sector_ms[st->sector] = split;
+                    if (st->best_sector_ms[st->sector] == 0 ||
+                        split < st->best_sector_ms[st->sector]) {
+                        st->best_sector_ms[st->sector] = split;
+                    }
+                    st->sector_start_ns = xing_ns;
+                    events |= GR_LAPTIMER_EVENT_SECTOR;
+                    if (next == 0) {
+                        uint32_t lap_ms = (uint32_t)((xing_ns - st->lap_start_ns) / 1000000ULL);
+                        st->lap++;
+                        st->last_lap_ms = lap_ms;
+                        if (st->best_lap_ms == 0 || lap_ms < st->best_lap_ms) {
+                            st->best_lap_ms = lap_ms;
+                            st->best_lap = st->lap;
+                        }
+                        st->lap_start_ns = xing_ns;
+                        events |= GR_LAPTIMER_EVENT_LAP;
+                        GRLOG_DEBUG("Lap %u completed in %u ms\n", st->lap, lap_ms);
+                    }
+                    st->sector = (uint8_t)next;
+                }
+            }
+        }
+    }
+    memcpy(&(lt->prev), fix, sizeof(*fix));
+    lt->has_prev = true;
+    return events;
+}
+
+int gr_gate_parse(const char *str, gr_gate_t *gate)
+{
+    double lat1 = 0, lon1 = 0, lat2 = 0, lon2 = 0;
+    if (!str || !gate)
+        return -1;
+    if (sscanf(str, "%lf,%lf,%lf,%lf", &lat1, &lon1, &lat2, &lon2) != 4) {
+        GRLOG_ERROR("Gate '%s' is not of the form lat1,lon1,lat2,lon2\n", str);
+        return -1;
+    }
+    if (fabs(lat1) > 90.0 || fabs(lat2) > 90.0 ||
+        fabs(lon1) > 180.0 || fabs(lon2) > 180.0) {
+        GRLOG_ERROR("Gate '%s' has out of range coordinates\n", str);
+        return -1;
+    }
+    gate->lat1_e7 = GR_FIX_DEG_TO_E7(lat1);
+    gate->lon1_e7 = GR_FIX_DEG_TO_E7(lon1);
+    gate->lat2_e7 = GR_FIX_DEG_TO_E7(lat2);
+    gate->lon2_e7 = GR_FIX_DEG_TO_E7(lon2);
+    return 0;
+}
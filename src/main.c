@@ -8,8 +8,22 @@
 #include <popt.h>
 #endif
 #include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_laptimer.h>
+#include <goodracer_telemetry.h>
+#include <goodracer_shm.h>
+#include <goodracer_bus.h>
+#include <goodracer_fixlog.h>
+#include <goodracer_trackmap.h>
+#include <goodracer_history.h>
+#include <goodracer_ui.h>
+#include <goodracer_i2cbus.h>
+#include <goodracer_display.h>
+#include <goodracer_rt.h>
 #include <goodracer_system.h>
 
+#define GOODRACER_FONT_FILE "/usr/share/fonts/truetype/msttcorefonts/Courier_New.ttf"
+
 typedef struct {
     uint32_t gps_baud_rate;
     char gps_device[PATH_MAX];
@@ -18,6 +32,24 @@ typedef struct {
     uint8_t i2c_width;
     uint8_t i2c_height;
     bool verbose;
+    gr_gate_t gates[GR_LAPTIMER_MAX_GATES];
+    size_t num_gates;
+    char telemetry_dest[256];
+    uint32_t telemetry_pps;
+    uint8_t telemetry_batch;
+    char shm_name[NAME_MAX];
+    char log_file[PATH_MAX];
+    uint32_t arena_kb;
+    uint8_t screen;
+    char track_map[PATH_MAX];
+    uint8_t display_pages;
+    uint32_t i2c_budget_us;
+    int rt_priority;
+    int rt_cpu;
+    uint16_t power_idle_fix_ms;
+    uint32_t history_kb;
+    bool virtual_display;
+    char dump_frames[PATH_MAX];
 } gr_args_t;
 
 static struct poptOption gr_args_table[] = {
@@ -75,6 +107,159 @@ static struct poptOption gr_args_table[] = {
         .descrip = "Set the I2C OLED device height in pixels. Default is 32.",
         .argDescrip = "32 | 64"
     },
+    {
+        .longName = "gate",
+        .shortName = 'g',
+        .argInfo = POPT_ARG_STRING,
+        .arg = NULL,
+        .val = 'g',
+        .descrip = "Add a timing gate as a line across the track. The first gate is the start/finish line and the rest are sector splits in track order. Can be repeated.",
+        .argDescrip = "lat1,lon1,lat2,lon2"
+    },
+    {
+        .longName = "telemetry",
+        .shortName = 'T',
+        .argInfo = POPT_ARG_STRING,
+        .arg = NULL,
+        .val = 'T',
+        .descrip = "Stream telemetry over UDP to the unicast or multicast destination. Default is disabled.",
+        .argDescrip = "239.0.0.1:5005 | 192.168.1.10:5005"
+    },
+    {
+        .longName = "telemetry-rate",
+        .shortName = 'R',
+        .argInfo = POPT_ARG_INT,
+        .arg = NULL,
+        .val = 'R',
+        .descrip = "Maximum telemetry packets per second. Default is 5.",
+        .argDescrip = "1 - 100"
+    },
+    {
+        .longName = "telemetry-batch",
+        .shortName = 'b',
+        .argInfo = POPT_ARG_INT,
+        .arg = NULL,
+        .val = 'b',
+        .descrip = "Maximum number of fixes per telemetry packet. Default is 10.",
+        .argDescrip = "1 - 32"
+    },
+    {
+        .longName = "shm",
+        .shortName = 'S',
+        .argInfo = POPT_ARG_STRING,
+        .arg = NULL,
+        .val = 'S',
+        .descrip = "Publish the latest state to local processes in the named POSIX shared memory segment. Default is disabled.",
+        .argDescrip = GR_SHM_DEFAULT_NAME
+    },
+    {
+        .longName = "log-file",
+        .shortName = 'l',
+        .argInfo = POPT_ARG_STRING,
+        .arg = NULL,
+        .val = 'l',
+        .descrip = "Record every fix to a binary fix log. Default is disabled.",
+        .argDescrip = "/path/to/session.grlog"
+    },
+    {
+        .longName = "screen",
+        .shortName = 's',
+        .argInfo = POPT_ARG_INT,
+        .arg = NULL,
+        .val = 's',
+        .descrip = "Screen to show at startup: 0 position, 1 lap, 2 lap times, 3 track map. SIGUSR1 switches to the next one. Default is 0.",
+        .argDescrip = "0 | 1 | 2 | 3"
+    },
+    {
+        .longName = "i2c-budget",
+        .shortName = 'Q',
+        .argInfo = POPT_ARG_INT,
+        .arg = NULL,
+        .val = 'Q',
+        .descrip = "Queue the display writes on the I2C bus scheduler, which gives sensor reads priority, and run it for at most this many microseconds per event loop iteration. Default is 0 which writes to the display directly. Ignored with --virtual-display.",
+        .argDescrip = "100 - 100000"
+    },
+    {
+        .longName = "virtual-display",
+        .shortName = 'x',
+        .argInfo = POPT_ARG_NONE,
+        .arg = NULL,
+        .val = 'x',
+        .descrip = "Render into an in-memory display of the I2C width and height instead of the OLED.",
+        .argDescrip = NULL
+    },
+    {
+        .longName = "dump-frames",
+        .shortName = 'D',
+        .argInfo = POPT_ARG_STRING,
+        .arg = NULL,
+        .val = 'D',
+        .descrip = "Write every frame of the virtual display to PREFIXNNNNNN.pbm. Implies --virtual-display.",
+        .argDescrip = "/path/to/PREFIX"
+    },
+    {
+        .longName = "display-chunk",
+        .shortName = 'C',
+        .argInfo = POPT_ARG_INT,
+        .arg = NULL,
+        .val = 'C',
+        .descrip = "Send only the changed display pages, at most this many per event loop iteration, between GPS reads. Default is 0 which sends whole frames.",
+        .argDescrip = "1 - 8"
+    },
+    {
+        .longName = "track-map",
+        .shortName = 'm',
+        .argInfo = POPT_ARG_STRING,
+        .arg = NULL,
+        .val = 'm',
+        .descrip = "Draw the map screen from the positions in this fix log. Default is to learn it from the first lap.",
+        .argDescrip = "/path/to/track.grlog"
+    },
+    {
+        .longName = "rt-priority",
+        .shortName = 'P',
+        .argInfo = POPT_ARG_INT,
+        .arg = NULL,
+        .val = 'P',
+        .descrip = "Real-time mode: lock all memory and run the event loop under SCHED_FIFO with this priority. Default is 0 which is off.",
+        .argDescrip = "1 - 99"
+    },
+    {
+        .longName = "rt-cpu",
+        .shortName = 'A',
+        .argInfo = POPT_ARG_INT,
+        .arg = NULL,
+        .val = 'A',
+        .descrip = "Real-time mode: pin the event loop and its helper threads to this CPU. Default is to not pin them.",
+        .argDescrip = "0 - N"
+    },
+    {
+        .longName = "power-save",
+        .shortName = 'p',
+        .argInfo = POPT_ARG_INT,
+        .arg = NULL,
+        .val = 'p',
+        .descrip = "Save power while the car is stationary by having the GPS fix this often, and by refreshing the display and waking up less. Default is 0 which is off.",
+        .argDescrip = "1000 - 10000"
+    },
+    {
+        .longName = "history-size",
+        .shortName = 'L',
+        .argInfo = POPT_ARG_INT,
+        .arg = NULL,
+        .val = 'L',
+        .descrip = "Keep the laps of the session in memory, using at most this many kilobytes. Default is 0 which is off.",
+        .argDescrip = "16 - 65536"
+    },
+    {
+        .longName = "arena-size",
+        .shortName = 'M',
+        .argInfo = POPT_ARG_INT,
+        .arg = NULL,
+        .val = 'M',
+        .descrip = "Allocate all objects from a fixed memory arena of this many kilobytes at startup and never again. Default is disabled.",
+        .argDescrip = "64 - 65536"
+    },
     {
         .longName = "version",
         .shortName = 'V',
@@ -114,9 +299,13 @@ void gr_args_init(gr_args_t *args)
         snprintf(args->gps_device, sizeof(args->gps_device), "/dev/serial0");
         snprintf(args->i2c_device, sizeof(args->i2c_device), "/dev/i2c-1");
         args->i2c_addr = 0x3c;
+        args->rt_cpu = -1;
         args->i2c_width = 128;
         args->i2c_height = 32;
         args->verbose = false;
+        args->num_gates = 0;
+        args->telemetry_pps = 5;
+        args->telemetry_batch = 10;
     }
 }
 
@@ -279,6 +468,216 @@ int gr_args_parse(int argc, const char **argv, gr_args_t *args)
                 }
             }
             break;
+        case 'g':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                if (args->num_gates >= GR_LAPTIMER_MAX_GATES) {
+                    GRLOG_ERROR("Only %d timing gates are supported\n", GR_LAPTIMER_MAX_GATES);
+                    rc = -1;
+                } else if (gr_gate_parse(argbuf, &(args->gates[args->num_gates])) < 0) {
+                    rc = -1;
+                } else {
+                    GRLOG_INFO("Using %s as timing gate %zu\n", argbuf, args->num_gates);
+                    args->num_gates++;
+                }
+            }
+            break;
+        case 'T':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                if (strlen(argbuf) < sizeof(args->telemetry_dest)) {
+                    memset(args->telemetry_dest, 0, sizeof(args->telemetry_dest));
+                    strncpy(args->telemetry_dest, argbuf, strlen(argbuf));
+                    GRLOG_INFO("Using telemetry destination: %s\n", args->telemetry_dest);
+                } else {
+                    GRLOG_ERROR("Telemetry destination %s is too long and max size is %zu\n",
+                            argbuf, sizeof(args->telemetry_dest));
+                    rc = -1;
+                }
+            }
+            break;
+        case 'R':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                if (gr_args_parse_uint32(argbuf, &args->telemetry_pps) < 0 ||
+                    args->telemetry_pps == 0 || args->telemetry_pps > 100) {
+                    GRLOG_WARN("Invalid value for telemetry rate: %s. Using default\n", argbuf);
+                    args->telemetry_pps = 5;
+                } else {
+                    GRLOG_INFO("Using telemetry rate %u packets/s\n", args->telemetry_pps);
+                }
+            }
+            break;
+        case 'b':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                if (gr_args_parse_uint8(argbuf, &args->telemetry_batch) < 0 ||
+                    args->telemetry_batch == 0 ||
+                    args->telemetry_batch > GR_TELEMETRY_BATCH_MAX) {
+                    GRLOG_WARN("Invalid value for telemetry batch: %s. Using default\n", argbuf);
+                    args->telemetry_batch = 10;
+                } else {
+                    GRLOG_INFO("Using telemetry batch of %u fixes\n", args->telemetry_batch);
+                }
+            }
+            break;
+        case 'S':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                if (argbuf[0] != '/' || strlen(argbuf) >= sizeof(args->shm_name)) {
+                    GRLOG_ERROR("Shared memory name %s has to start with a '/' and max size is %zu\n",
+                            argbuf, sizeof(args->shm_name));
+                    rc = -1;
+                } else {
+                    memset(args->shm_name, 0, sizeof(args->shm_name));
+                    strncpy(args->shm_name, argbuf, strlen(argbuf));
+                    GRLOG_INFO("Using shared memory name: %s\n", args->shm_name);
+                }
+            }
+            break;
+        case 'l':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                if (strlen(argbuf) < sizeof(args->log_file)) {
+                    memset(args->log_file, 0, sizeof(args->log_file));
+                    strncpy(args->log_file, argbuf, strlen(argbuf));
+                    GRLOG_INFO("Using fix log file: %s\n", args->log_file);
+                } else {
+                    GRLOG_ERROR("Fix log path %s is too long and max size is %zu\n",
+                            argbuf, sizeof(args->log_file));
+                    rc = -1;
+                }
+            }
+            break;
+        case 'm':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                if (strlen(argbuf) < sizeof(args->track_map)) {
+                    memset(args->track_map, 0, sizeof(args->track_map));
+                    strncpy(args->track_map, argbuf, strlen(argbuf));
+                    GRLOG_INFO("Using track map from: %s\n", args->track_map);
+                } else {
+                    GRLOG_ERROR("Track map path %s is too long and max size is %zu\n",
+                            argbuf, sizeof(args->track_map));
+                    rc = -1;
+                }
+            }
+            break;
+        case 's':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                if (gr_args_parse_uint8(argbuf, &args->screen) < 0) {
+                    GRLOG_WARN("Invalid value for screen: %s. Using 0\n", argbuf);
+                    args->screen = 0;
+                }
+            }
+            break;
+        case 'Q':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                uint32_t us = 0;
+                if (gr_args_parse_uint32(argbuf, &us) < 0 || us > 100000) {
+                    GRLOG_ERROR("Invalid value for I2C budget: %s\n", argbuf);
+                    rc = -1;
+                } else {
+                    args->i2c_budget_us = us;
+                    GRLOG_INFO("Using I2C bus scheduler with %u us per loop iteration\n", us);
+                }
+            }
+            break;
+        case 'x':
+            args->virtual_display = true;
+            break;
+        case 'D':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                if (strlen(argbuf) < sizeof(args->dump_frames) - 16) {
+                    memset(args->dump_frames, 0, sizeof(args->dump_frames));
+                    strncpy(args->dump_frames, argbuf, strlen(argbuf));
+                    args->virtual_display = true;
+                    GRLOG_INFO("Dumping display frames to: %s\n", args->dump_frames);
+                } else {
+                    GRLOG_ERROR("Frame dump prefix %s is too long and max size is %zu\n",
+                            argbuf, sizeof(args->dump_frames) - 16);
+                    rc = -1;
+                }
+            }
+            break;
+        case 'C':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                if (gr_args_parse_uint8(argbuf, &args->display_pages) < 0) {
+                    GRLOG_WARN("Invalid value for display chunk: %s. Using 0\n", argbuf);
+                    args->display_pages = 0;
+                }
+            }
+            break;
+        case 'p':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                uint16_t ms = 0;
+                if (gr_args_parse_uint16(argbuf, &ms) < 0 || ms < GR_POWER_ACTIVE_FIX_MS || ms > 10000) {
+                    GRLOG_ERROR("Invalid value for the stationary GPS fix interval: %s\n", argbuf);
+                    rc = -1;
+                } else {
+                    args->power_idle_fix_ms = ms;
+                    GRLOG_INFO("Using a GPS fix every %u ms when stationary\n", args->power_idle_fix_ms);
+                }
+            }
+            break;
+        case 'P':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                uint8_t prio = 0;
+                if (gr_args_parse_uint8(argbuf, &prio) < 0 || prio < 1 || prio > 99) {
+                    GRLOG_ERROR("Invalid value for real-time priority: %s\n", argbuf);
+                    rc = -1;
+                } else {
+                    args->rt_priority = prio;
+                    GRLOG_INFO("Using real-time priority %d\n", args->rt_priority);
+                }
+            }
+            break;
+        case 'A':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                uint8_t cpu = 0;
+                if (gr_args_parse_uint8(argbuf, &cpu) < 0) {
+                    GRLOG_ERROR("Invalid value for real-time CPU: %s\n", argbuf);
+                    rc = -1;
+                } else {
+                    args->rt_cpu = cpu;
+                    GRLOG_INFO("Using real-time CPU %d\n", args->rt_cpu);
+                }
+            }
+            break;
+        case 'L':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                uint32_t kb = 0;
+                if (gr_args_parse_uint32(argbuf, &kb) < 0 ||
+                    kb < (GR_HISTORY_MIN_BYTES / 1024) || kb > 65536) {
+                    GRLOG_ERROR("Invalid value for history size: %s\n", argbuf);
+                    rc = -1;
+                } else {
+                    args->history_kb = kb;
+                    GRLOG_INFO("Using history size: %u KB\n", args->history_kb);
+                }
+            }
+            break;
+        case 'M':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                uint32_t kb = 0;
+                if (gr_args_parse_uint32(argbuf, &kb) < 0 || kb < 64 || kb > 65536) {
+                    GRLOG_ERROR("Invalid value for memory arena size: %s\n", argbuf);
+                    rc = -1;
+                } else {
+                    args->arena_kb = kb;
+                    GRLOG_INFO("Using memory arena size: %u KB\n", args->arena_kb);
+                }
+            }
+            break;
         case 'B':
             argbuf = poptGetOptArg(ctx);
             if (argbuf) {
@@ -316,6 +715,11 @@ int gr_args_parse(int argc, const char **argv, gr_args_t *args)
         rc = -1;
         show_usage = true;
     }
+    if (args->i2c_budget_us > 0 && args->virtual_display) {
+        /* the virtual display has no bus to schedule */
+        GRLOG_WARN("Ignoring the I2C budget with the virtual display\n");
+        args->i2c_budget_us = 0;
+    }
     if (show_version) {
         printf("%s\n", GOODRACER_VERSION);
         rc = -1;
@@ -343,76 +747,115 @@ static void goodracer_gps_read_cb(gr_sys_t *sys, gr_gps_t *gps,
     if (gr_system_is_verbose(sys)) {
         gpsdata_dump(item, GRLOG_PTR);
     }
-    //FIXME: this is such a hack
-    if (disp && disp->fbp && disp->oled) {
-        char buf[64] = { 0 };
-        ssd1306_framebuffer_clear(disp->fbp);
-        ssd1306_framebuffer_box_t bbox = { 0 };
-        ssd1306_graphics_options_t opts = {
-            .type = SSD1306_OPT_FONT_FILE,
-            .value.font_file = "/usr/share/fonts/truetype/msttcorefonts/Courier_New.ttf"
-        };
-        const int fontsize = 3;
-        if (item->latitude.direction != GPSDATA_DIRECTION_UNSET) {
-            // print the latitude
-            snprintf(buf, sizeof(buf) - 1, "%d\xb0%0.04f'%c",
-                   item->latitude.degrees, item->latitude.minutes,
-                  gpsdata_direction_tostring(item->latitude.direction)[0]);
-            ssd1306_framebuffer_draw_text_extra(disp->fbp, buf, 0, 2,
-                    bbox.bottom, SSD1306_FONT_CUSTOM, fontsize, &opts, 1, &bbox);
-            GRLOG_DEBUG("BBox: top: %d left: %d right: %d bottom: %d\n",
-                    bbox.top, bbox.left, bbox.right, bbox.bottom);
-        }
-        if (item->longitude.direction != GPSDATA_DIRECTION_UNSET) {
-            // print the longitude
-            snprintf(buf, sizeof(buf) - 1, "%d\xb0%0.04f'%c",
-                   item->longitude.degrees, item->longitude.minutes,
-                  gpsdata_direction_tostring(item->longitude.direction)[0]);
-            ssd1306_framebuffer_draw_text_extra(disp->fbp, buf, 0, 2,
-                    bbox.bottom + fontsize, SSD1306_FONT_CUSTOM, fontsize, &opts, 1, &bbox);
-            GRLOG_DEBUG("BBox: top: %d left: %d right: %d bottom: %d\n",
-                    bbox.top, bbox.left, bbox.right, bbox.bottom);
-        }
-        snprintf(buf, sizeof(buf) - 1, "%0.04f kmph", isnan(item->speed_kmph) ? 0.0 : item->speed_kmph);
-        ssd1306_framebuffer_draw_text_extra(disp->fbp, buf, 0, 2,
-                    bbox.bottom + fontsize, SSD1306_FONT_CUSTOM, fontsize, &opts, 1, &bbox);
-        GRLOG_DEBUG("BBox: top: %d left: %d right: %d bottom: %d\n",
-                    bbox.top, bbox.left, bbox.right, bbox.bottom);
-        if (gr_system_is_verbose(sys)) {
-            ssd1306_framebuffer_bitdump(disp->fbp);
-        }
-        if (ssd1306_i2c_display_update(disp->oled, disp->fbp) < 0) {
-            GRLOG_ERROR("Failed to update I2C display\n");
+    uint64_t now_ns = gr_monotonic_ns();
+    /* drawn less often while the car is stationary */
+    if (disp && disp->ui && disp->fbp && gr_system_display_due(sys, now_ns)) {
+        /* only what changed since the last fix is drawn */
+        int drawn = gr_ui_render(disp->ui, gr_system_get_fix(sys),
+                        gr_system_get_lap_state(sys), now_ns);
+        if (drawn > 0) {
+            if (gr_system_is_verbose(sys)) {
+                ssd1306_framebuffer_bitdump(disp->fbp);
+            }
+            gr_system_update_display(sys);
         }
     }
 }
 
+static void goodracer_fixlog_cb(const gr_bus_record_t *rec, void *arg)
+{
+    gr_fixlog_t *log = (gr_fixlog_t *)arg;
+    if (rec && log) {
+        gr_fixlog_write(log, &(rec->fix));
+    }
+}
+
+/* collect the outline while the first lap is driven and build the map when
+ * it is done */
+static void goodracer_trackmap_cb(const gr_bus_record_t *rec, void *arg)
+{
+    gr_trackmap_t *map = (gr_trackmap_t *)arg;
+    if (!rec || !map || gr_trackmap_is_built(map) || !rec->lap.started)
+        return;
+    gr_trackmap_add_point(map, rec->fix.lat_e7, rec->fix.lon_e7);
+    if (rec->lap_events > 0 && (rec->lap_events & GR_LAPTIMER_EVENT_LAP)) {
+        gr_trackmap_build(map);
+    }
+}
+
 int main (int argc, const char **argv)
 {
     int rc = 0;
     gr_args_t args;
     gr_disp_t *disp = NULL;
     gr_gps_t *gps = NULL;
+    gr_telemetry_t *tele = NULL;
+    gr_shm_t *shm = NULL;
+    gr_fixlog_t *fixlog = NULL;
+    gr_trackmap_t *trackmap = NULL;
+    gr_i2cbus_t *i2cbus = NULL;
 
     gr_args_init(&args);
     if ((rc = gr_args_parse(argc, (const char **)argv, &args)) < 0) {
         return rc;
     }
-    gr_sys_t *sys = gr_system_setup();
+    /* before any object is created so that all of them come from it */
+    if (args.arena_kb > 0 && gr_mem_arena_setup((size_t)args.arena_kb * 1024) < 0) {
+        GRLOG_ERROR("Failed to setup the memory arena\n");
+        return -1;
+    }
+    gr_rt_config_t rt = {
+        .lock_memory = true,
+        .priority = args.rt_priority,
+        .cpu = args.rt_cpu
+    };
+    gr_sys_t *sys = gr_system_setup((args.rt_priority > 0 || args.rt_cpu >= 0) ? &rt : NULL);
     if (!sys) {
         GRLOG_ERROR("Failed to setup system\n");
+        gr_mem_arena_cleanup();
         return -1;
     }
     do {
         gr_system_set_verbose(sys, args.verbose);
-        /* connect the OLED */
-        disp = gr_display_i2c_setup(args.i2c_device, args.i2c_addr,
-                args.i2c_width, args.i2c_height);
-        if (!disp) {
-            GRLOG_ERROR("failed to perform I2C OLED screen setup on device path %s", args.i2c_device);
+        if (args.virtual_display) {
+            /* same rendering as the OLED, without the hardware */
+            disp = gr_display_virtual_setup(args.i2c_width, args.i2c_height,
+                    (args.dump_frames[0] != '\0') ? args.dump_frames : NULL);
+            if (!disp) {
+                GRLOG_ERROR("failed to setup the virtual display");
+                rc = -1;
+                break;
+            }
+        } else {
+            /* connect the OLED */
+            disp = gr_display_i2c_setup(args.i2c_device, args.i2c_addr,
+                    args.i2c_width, args.i2c_height);
+            if (!disp) {
+                GRLOG_ERROR("failed to perform I2C OLED screen setup on device path %s", args.i2c_device);
+                rc = -1;
+                break;
+            }
+        }
+        disp->ui = gr_ui_create(disp->fbp, GOODRACER_FONT_FILE);
+        if (!disp->ui || gr_ui_add_default_screens(disp->ui) < 0) {
+            GRLOG_ERROR("failed to setup the display screens");
+            rc = -1;
+            break;
+        }
+        if (gr_ui_set_screen(disp->ui, args.screen) < 0) {
+            GRLOG_WARN("Screen %u does not exist, using 0\n", args.screen);
+        }
+        trackmap = gr_trackmap_create(GR_TRACKMAP_DEFAULT_POINTS);
+        if (!trackmap) {
+            GRLOG_ERROR("failed to create the track map");
             rc = -1;
             break;
         }
+        if (args.track_map[0] != '\0' && gr_trackmap_load(trackmap, args.track_map) < 0) {
+            GRLOG_WARN("Failed to load the track map from %s, learning it from the first lap\n",
+                    args.track_map);
+        }
+        gr_ui_set_trackmap(disp->ui, trackmap);
         /* connect the GPS */
         gps = gr_gps_setup(args.gps_device, args.gps_baud_rate);
         if (!gps) {
@@ -425,17 +868,125 @@ int main (int argc, const char **argv)
             GRLOG_ERROR("Failed to set the display for the system");
             break;
         }
+        if (args.i2c_budget_us > 0) {
+            i2cbus = gr_i2cbus_setup(args.i2c_device);
+            if (!i2cbus) {
+                GRLOG_ERROR("failed to setup the I2C bus scheduler on %s", args.i2c_device);
+                rc = -1;
+                break;
+            }
+            if (gr_display_i2c_set_bus(disp, i2cbus) < 0 ||
+                gr_system_set_i2cbus(sys, i2cbus, args.i2c_budget_us) < 0) {
+                GRLOG_ERROR("Failed to set the I2C bus scheduler");
+                rc = -1;
+                break;
+            }
+            /* the scheduler paces the writes, so hand it all the changed
+             * pages at once */
+            if (args.display_pages == 0) {
+                args.display_pages = disp->fbp->height / 8;
+            }
+        }
+        if (args.display_pages > 0) {
+            rc = gr_system_set_display_chunked(sys, args.display_pages);
+            if (rc < 0) {
+                GRLOG_ERROR("Failed to set chunked display transfers");
+                break;
+            }
+        }
+        for (size_t i = 0; i < args.num_gates; ++i) {
+            rc = gr_system_add_gate(sys, &(args.gates[i]));
+            if (rc < 0) {
+                GRLOG_ERROR("Failed to add timing gate %zu to the system", i);
+                break;
+            }
+        }
+        if (rc < 0)
+            break;
+        if (args.telemetry_dest[0] != '\0') {
+            tele = gr_telemetry_setup(args.telemetry_dest, args.telemetry_pps,
+                    args.telemetry_batch);
+            if (!tele) {
+                GRLOG_ERROR("failed to setup telemetry to %s", args.telemetry_dest);
+                rc = -1;
+                break;
+            }
+            rc = gr_system_set_telemetry(sys, tele);
+            if (rc < 0) {
+                GRLOG_ERROR("Failed to set the telemetry for the system");
+                break;
+            }
+        }
+        if (args.shm_name[0] != '\0') {
+            shm = gr_shm_setup(args.shm_name);
+            if (!shm) {
+                GRLOG_ERROR("failed to setup shared memory %s", args.shm_name);
+                rc = -1;
+                break;
+            }
+            rc = gr_system_set_shm(sys, shm);
+            if (rc < 0) {
+                GRLOG_ERROR("Failed to set the shared memory for the system");
+                break;
+            }
+        }
+        if (args.log_file[0] != '\0') {
+            fixlog = gr_fixlog_open(args.log_file);
+            if (!fixlog) {
+                GRLOG_ERROR("failed to open fix log %s", args.log_file);
+                rc = -1;
+                break;
+            }
+            /* disk writes can stall, so the logger gets its own thread */
+            rc = gr_system_subscribe(sys, "fixlog", goodracer_fixlog_cb, fixlog, true);
+            if (rc < 0) {
+                GRLOG_ERROR("Failed to subscribe the fix log to the system");
+                break;
+            }
+        }
+        if (args.history_kb > 0) {
+            rc = gr_system_set_history(sys, (size_t)args.history_kb * 1024);
+            if (rc < 0) {
+                GRLOG_ERROR("Failed to set the session history for the system");
+                break;
+            }
+        }
+        if (!gr_trackmap_is_built(trackmap) && args.num_gates > 0) {
+            rc = gr_system_subscribe(sys, "trackmap", goodracer_trackmap_cb, trackmap, false);
+            if (rc < 0) {
+                GRLOG_ERROR("Failed to subscribe the track map to the system");
+                break;
+            }
+        }
         rc = gr_system_watch_gps(sys, gps, goodracer_gps_read_cb, goodracer_gps_error_cb);
         if (rc < 0) {
             GRLOG_ERROR("Failed to set the I/O watcher for the GPS in the system");
             break;
         }
+        if (args.power_idle_fix_ms > 0) {
+            gr_power_config_t power;
+            gr_power_config_init(&power);
+            power.idle_fix_ms = args.power_idle_fix_ms;
+            rc = gr_system_set_power(sys, &power);
+            if (rc < 0) {
+                GRLOG_ERROR("Failed to set power saving for the system");
+                break;
+            }
+        }
         /* do other setup stuff here */
         rc = gr_system_run(sys);
     } while (0);
     gr_gps_cleanup(gps);
     gr_display_cleanup(disp);
+    gr_i2cbus_cleanup(i2cbus);
+    gr_telemetry_cleanup(tele);
+    gr_shm_cleanup(shm);
     gr_system_cleanup(sys);
+    /* after the system since the logger thread is stopped there */
+    gr_fixlog_close(fixlog);
+    /* the display UI and the bus no longer refer to it */
+    gr_trackmap_free(trackmap);
     gr_args_cleanup(&args);
+    gr_mem_arena_cleanup();
     return rc;
 }
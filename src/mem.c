@@ -0,0 +1,226 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_MALLOC_H
+#include <malloc.h>
+#endif
+#include <goodracer_utils.h>
+
+/* every arena block is prefixed with its size so that realloc() works, which
+ * libev needs, and the header keeps the blocks 16 byte aligned */
+#define GR_MEM_ALIGN 16
+#define GR_MEM_ALIGN_UP(N) (((N) + (GR_MEM_ALIGN - 1)) & ~((size_t)GR_MEM_ALIGN - 1))
+
+typedef struct {
+    size_t size;
+    size_t _pad;
+} gr_mem_hdr_t;
+
+static struct {
+    uint8_t *base;
+    size_t budget;
+    size_t used;
+    bool running;
+    uint64_t arena_allocs;
+    uint64_t heap_allocs;
+    uint64_t failed;
+    uint64_t running_allocs;
+    int64_t heap_at_run; /* process heap in use when the loop started */
+    int64_t heap_growth;
+} gr_mem = { 0 };
+
+static int64_t gr_mem_heap_inuse()
+{
+#if defined(GOODRACER_HAVE_MALLINFO2)
+    struct mallinfo2 mi = mallinfo2();
+    return (int64_t)mi.uordblks;
+#else
+    return INT64_MIN;
+#endif
+}
+
+static inline bool gr_mem_in_arena(const void *ptr)
+{
+    return (gr_mem.base && (const uint8_t *)ptr >= gr_mem.base &&
+            (const uint8_t *)ptr < (gr_mem.base + gr_mem.budget));
+}
+
+/* only the allocations made through here are seen, not the ones libraries
+ * make with malloc() themselves */
+static void gr_mem_check_running(size_t size, bool heap)
+{
+    if (!__atomic_load_n(&(gr_mem.running), __ATOMIC_RELAXED))
+        return;
+    if (__atomic_fetch_add(&(gr_mem.running_allocs), 1, __ATOMIC_RELAXED) == 0) {
+        GRLOG_WARN("Allocation of %zu bytes from the %s after the event loop started\n",
+                size, heap ? "heap" : "arena");
+    }
+}
+
+static void *gr_mem_arena_alloc(size_t size)
+{
+    size_t need = sizeof(gr_mem_hdr_t) + GR_MEM_ALIGN_UP(size);
+    size_t off = __atomic_load_n(&(gr_mem.used), __ATOMIC_RELAXED);
+    do {
+        if (need < size || off + need > gr_mem.budget) {
+            __atomic_fetch_add(&(gr_mem.failed), 1, __ATOMIC_RELAXED);
+            GRLOG_ERROR("Memory arena budget of %zu bytes exceeded by a request of %zu bytes with %zu in use\n",
+                    gr_mem.budget, size, off);
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&(gr_mem.used), &off, off + need,
+                true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    __atomic_fetch_add(&(gr_mem.arena_allocs), 1, __ATOMIC_RELAXED);
+    gr_mem_hdr_t *hdr = (gr_mem_hdr_t *)(gr_mem.base + off);
+    hdr->size = size;
+    /* the arena is zeroed at setup and never reused */
+    return (void *)(hdr + 1);
+}
+
+void *gr_mem_calloc(size_t num, size_t size)
+{
+    if (num > 0 && size > (SIZE_MAX / num))
+        return NULL;
+    gr_mem_check_running(num * size, !gr_mem.base);
+    if (gr_mem.base) {
+        return gr_mem_arena_alloc(num * size);
+    }
+    __atomic_fetch_add(&(gr_mem.heap_allocs), 1, __ATOMIC_RELAXED);
+    return calloc(num, size);
+}
+
+void *gr_mem_realloc(void *ptr, size_t size)
+{
+    if (!ptr)
+        return gr_mem_calloc(1, size);
+    if (gr_mem_in_arena(ptr)) {
+        if (size == 0)
+            return NULL;
+        const gr_mem_hdr_t *hdr = ((const gr_mem_hdr_t *)ptr) - 1;
+        if (size <= hdr->size)
+            return ptr;
+        gr_mem_check_running(size, false);
+        void *nptr = gr_mem_arena_alloc(size);
+        if (nptr) {
+            memcpy(nptr, ptr, hdr->size);
+        }
+        return nptr;
+    }
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    gr_mem_check_running(size, true);
+    __atomic_fetch_add(&(gr_mem.heap_allocs), 1, __ATOMIC_RELAXED);
+    return realloc(ptr, size);
+}
+
+char *gr_mem_strdup(const char *s)
+{
+    if (!s)
+        return NULL;
+    size_t len = strlen(s);
+    char *d = gr_mem_calloc(1, len + 1);
+    if (d) {
+        memcpy(d, s, len);
+    }
+    return d;
+}
+
+void gr_mem_free(void *ptr)
+{
+    if (ptr && !gr_mem_in_arena(ptr)) {
+        free(ptr);
+    }
+}
+
+int gr_mem_arena_setup(size_t budget)
+{
+    if (gr_mem.base) {
+        GRLOG_ERROR("Memory arena is already setup\n");
+        return -1;
+    }
+    if (budget < GR_MEM_ALIGN) {
+        GRLOG_ERROR("Memory arena budget of %zu bytes is too small\n", budget);
+        return -1;
+    }
+    budget = GR_MEM_ALIGN_UP(budget);
+    uint8_t *base = calloc(1, budget);
+    if (!base) {
+        GRLOG_OUTOFMEM(budget);
+        return -1;
+    }
+    gr_mem.budget = budget;
+    gr_mem.used = 0;
+    gr_mem.base = base;
+    GRLOG_INFO("Using a memory arena of %zu bytes\n", budget);
+    return 0;
+}
+
+void gr_mem_arena_cleanup()
+{
+    if (gr_mem.base) {
+        GRLOG_DEBUG("Memory arena used %zu of %zu bytes in %" PRIu64 " allocations\n",
+                gr_mem.used, gr_mem.budget, gr_mem.arena_allocs);
+        free(gr_mem.base);
+        gr_mem.base = NULL;
+        gr_mem.budget = 0;
+        gr_mem.used = 0;
+    }
+}
+
+bool gr_mem_arena_enabled()
+{
+    return (gr_mem.base != NULL);
+}
+
+void gr_mem_set_running(bool flag)
+{
+    if (flag) {
+        gr_mem.heap_at_run = gr_mem_heap_inuse();
+        gr_mem.heap_growth = 0;
+    } else if (gr_mem.running) {
+        int64_t now = gr_mem_heap_inuse();
+        gr_mem.heap_growth = (now == INT64_MIN || gr_mem.heap_at_run == INT64_MIN) ? INT64_MIN :
+                                (now - gr_mem.heap_at_run);
+    }
+    __atomic_store_n(&(gr_mem.running), flag, __ATOMIC_RELEASE);
+}
+
+void gr_mem_get_stats(gr_mem_stats_t *st)
+{
+    if (!st)
+        return;
+    memset(st, 0, sizeof(*st));
+    st->budget = gr_mem.budget;
+    st->used = __atomic_load_n(&(gr_mem.used), __ATOMIC_RELAXED);
+    st->arena_allocs = __atomic_load_n(&(gr_mem.arena_allocs), __ATOMIC_RELAXED);
+    st->heap_allocs = __atomic_load_n(&(gr_mem.heap_allocs), __ATOMIC_RELAXED);
+    st->failed = __atomic_load_n(&(gr_mem.failed), __ATOMIC_RELAXED);
+    st->running_allocs = __atomic_load_n(&(gr_mem.running_allocs), __ATOMIC_RELAXED);
+    if (gr_mem.running) {
+        int64_t now = gr_mem_heap_inuse();
+        st->running_heap_growth = (now == INT64_MIN || gr_mem.heap_at_run == INT64_MIN) ? INT64_MIN :
+                                    (now - gr_mem.heap_at_run);
+    } else {
+        st->running_heap_growth = gr_mem.heap_growth;
+    }
+}
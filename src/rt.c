@@ -0,0 +1,249 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for the CPU affinity */
+#endif
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef GOODRACER_HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef GOODRACER_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_SCHED_H
+#include <sched.h>
+#endif
+#ifdef GOODRACER_HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef GOODRACER_HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+#ifdef GOODRACER_HAVE_MALLOC_H
+#include <malloc.h>
+#endif
+#include <goodracer_utils.h>
+#include <goodracer_rt.h>
+
+/* touch every page of a stack frame this big, so the pages the event loop
+ * will use later are already mapped and locked */
+static void gr_rt_prefault_stack()
+{
+    volatile uint8_t buf[GR_RT_STACK_PREFAULT];
+    long pagesz = sysconf(_SC_PAGESIZE);
+    if (pagesz <= 0)
+        pagesz = 4096;
+    for (size_t i = 0; i < sizeof(buf); i += (size_t)pagesz) {
+        buf[i] = 0;
+    }
+}
+
+static int gr_rt_lock_memory()
+{
+#if defined(GOODRACER_HAVE_SYS_MMAN_H) && defined(GOODRACER_HAVE_MLOCKALL)
+#ifdef GOODRACER_HAVE_MALLOPT
+    /* keep freed memory and never use mmap for allocations, both of which
+     * would give back pages that are locked now */
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+#endif
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        int err = errno;
+        GRLOG_ERROR("Failed to lock memory. Error: %s(%d)\n", strerror(err), err);
+        return -1;
+    }
+    gr_rt_prefault_stack();
+    return 0;
+#else
+    GRLOG_ERROR("Locking memory is not supported\n");
+    return -1;
+#endif
+}
+
+/* on Linux the scheduling and the affinity of pid 0 are the calling
+ * thread's, not the process's */
+static int gr_rt_set_thread(int priority, int cpu, const char *name)
+{
+    int rc = 0;
+#ifdef GOODRACER_HAVE_SCHED_H
+#ifdef GOODRACER_HAVE_SCHED_SETAFFINITY
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+            int err = errno;
+            GRLOG_ERROR("Failed to pin the %s thread to CPU %d. Error: %s(%d)\n",
+                    name, cpu, strerror(err), err);
+            rc = -1;
+        }
+    }
+#else
+    if (cpu >= 0) {
+        GRLOG_ERROR("CPU affinity is not supported for the %s thread\n", name);
+        rc = -1;
+    }
+#endif
+    if (priority > 0) {
+        struct sched_param sp;
+        memset(&sp, 0, sizeof(sp));
+        sp.sched_priority = priority;
+        if (sched_setscheduler(0, SCHED_FIFO, &sp) < 0) {
+            int err = errno;
+            GRLOG_ERROR("Failed to set SCHED_FIFO priority %d for the %s thread. Error: %s(%d)\n",
+                    priority, name, strerror(err), err);
+            rc = -1;
+        }
+    }
+#else
+    if (cpu >= 0 || priority > 0) {
+        GRLOG_ERROR("Real-time scheduling is not supported for the %s thread\n", name);
+        rc = -1;
+    }
+#endif
+    return rc;
+}
+
+int gr_rt_setup(const gr_rt_config_t *cfg)
+{
+    if (!cfg)
+        return -1;
+    int rc = 0;
+    if (cfg->priority < 0 || cfg->priority > 99) {
+        GRLOG_ERROR("Invalid SCHED_FIFO priority %d\n", cfg->priority);
+        return -1;
+    }
+    if (cfg->lock_memory && gr_rt_lock_memory() < 0) {
+        rc = -1;
+    }
+    if (gr_rt_set_thread(cfg->priority, cfg->cpu, "event loop") < 0) {
+        rc = -1;
+    }
+    return rc;
+}
+
+int gr_rt_setup_helper(const gr_rt_config_t *cfg, const char *name)
+{
+    if (!cfg)
+        return -1;
+    /* never compete with the event loop */
+    int priority = (cfg->priority > 1) ? (cfg->priority - 1) : cfg->priority;
+    return gr_rt_set_thread(priority, cfg->cpu, name ? name : "helper");
+}
+
+static size_t gr_rt_locked_kb()
+{
+    size_t kb = 0;
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (fp) {
+        char line[128];
+        while (fgets(line, sizeof(line), fp)) {
+            if (strncmp(line, "VmLck:", 6) == 0) {
+                kb = (size_t)strtoul(&line[6], NULL, 10);
+                break;
+            }
+        }
+        fclose(fp);
+    }
+    return kb;
+}
+
+int gr_rt_check(const gr_rt_config_t *cfg, gr_rt_report_t *rep)
+{
+    if (!cfg || !rep)
+        return -1;
+    int rc = 0;
+    memset(rep, 0, sizeof(*rep));
+    rep->minor_faults = -1;
+    rep->major_faults = -1;
+    rep->locked_kb = gr_rt_locked_kb();
+    rep->memory_locked = (rep->locked_kb > 0);
+    if (cfg->lock_memory && !rep->memory_locked)
+        rc = -1;
+#ifdef GOODRACER_HAVE_SCHED_H
+    struct sched_param sp;
+    memset(&sp, 0, sizeof(sp));
+    rep->fifo = (sched_getscheduler(0) == SCHED_FIFO);
+    if (sched_getparam(0, &sp) == 0) {
+        rep->priority = sp.sched_priority;
+    }
+    if (cfg->priority > 0 && (!rep->fifo || rep->priority != cfg->priority))
+        rc = -1;
+    if (cfg->cpu >= 0) {
+#ifdef GOODRACER_HAVE_SCHED_SETAFFINITY
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            rep->pinned = (CPU_COUNT(&set) == 1 && CPU_ISSET(cfg->cpu, &set));
+        }
+#endif
+        if (!rep->pinned)
+            rc = -1;
+    }
+#else
+    if (cfg->priority > 0 || cfg->cpu >= 0)
+        rc = -1;
+#endif
+#ifdef GOODRACER_HAVE_SYS_RESOURCE_H
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        rep->minor_faults = ru.ru_minflt;
+        rep->major_faults = ru.ru_majflt;
+    }
+#endif
+    return rc;
+}
+
+void gr_rt_log_report(const gr_rt_config_t *cfg, const gr_rt_report_t *rep)
+{
+    if (!cfg || !rep)
+        return;
+    if (cfg->lock_memory) {
+        if (rep->memory_locked) {
+            GRLOG_INFO("Real-time: memory locked, %zu KB\n", rep->locked_kb);
+        } else {
+            GRLOG_WARN("Real-time: memory is NOT locked\n");
+        }
+    }
+    if (cfg->priority > 0) {
+        if (rep->fifo && rep->priority == cfg->priority) {
+            GRLOG_INFO("Real-time: SCHED_FIFO priority %d\n", rep->priority);
+        } else {
+            GRLOG_WARN("Real-time: SCHED_FIFO priority %d NOT in effect, %s priority %d\n",
+                    cfg->priority, rep->fifo ? "SCHED_FIFO" : "normal scheduling",
+                    rep->priority);
+        }
+    }
+    if (cfg->cpu >= 0) {
+        if (rep->pinned) {
+            GRLOG_INFO("Real-time: pinned to CPU %d\n", cfg->cpu);
+        } else {
+            GRLOG_WARN("Real-time: NOT pinned to CPU %d\n", cfg->cpu);
+        }
+    }
+    if (rep->minor_faults >= 0) {
+        GRLOG_INFO("Real-time: %ld minor and %ld major page faults so far\n",
+                rep->minor_faults, rep->major_faults);
+    }
+}
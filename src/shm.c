@@ -0,0 +1,243 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#include <stddef.h>
+#ifdef GOODRACER_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_MATH_H
+#include <math.h>
+#endif
+#ifdef GOODRACER_HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef GOODRACER_HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef GOODRACER_HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_laptimer.h>
+#include <goodracer_shm.h>
+
+_Static_assert(GR_SHM_MAX_SECTORS == GR_LAPTIMER_MAX_GATES,
+        "shared memory sector count must match the lap timer gates");
+
+struct gr_shm_t_ {
+    char *name;
+    int fd;
+    gr_shm_layout_t *lay;
+    uint64_t num_publish;
+    volatile int _ref; //reference counted
+};
+
+gr_shm_t *gr_shm_setup(const char *name)
+{
+    int rc = 0;
+    gr_shm_t *shm = NULL;
+    do {
+        if (!name || name[0] != '/') {
+            GRLOG_ERROR("Shared memory name has to start with a '/'\n");
+            rc = -1;
+            break;
+        }
+        shm = GR_CALLOC(1, sizeof(*shm));
+        if (!shm) {
+            GRLOG_OUTOFMEM(sizeof(*shm));
+            rc = -1;
+            break;
+        }
+        shm->fd = -1;
+        shm->name = GR_STRDUP(name);
+        if (!shm->name) {
+            GRLOG_OUTOFMEM(strlen(name));
+            rc = -1;
+            break;
+        }
+        shm->fd = shm_open(name, O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+        if (shm->fd < 0) {
+            int err = errno;
+            GRLOG_ERROR("Failed to open shared memory %s. Error: %s(%d)\n",
+                    name, strerror(err), err);
+            rc = -1;
+            break;
+        }
+        if (ftruncate(shm->fd, sizeof(gr_shm_layout_t)) < 0) {
+            int err = errno;
+            GRLOG_ERROR("Failed to size shared memory %s. Error: %s(%d)\n",
+                    name, strerror(err), err);
+            rc = -1;
+            break;
+        }
+        void *addr = mmap(NULL, sizeof(gr_shm_layout_t), PROT_READ | PROT_WRITE,
+                        MAP_SHARED, shm->fd, 0);
+        if (addr == MAP_FAILED) {
+            int err = errno;
+            GRLOG_ERROR("Failed to map shared memory %s. Error: %s(%d)\n",
+                    name, strerror(err), err);
+            rc = -1;
+            break;
+        }
+        shm->lay = (gr_shm_layout_t *)addr;
+        /* invalidate the magic first so that readers of a previous layout
+         * stop trusting the segment while it is rewritten */
+        __atomic_store_n(&(shm->lay->magic), 0, __ATOMIC_RELEASE);
+        memset(&(shm->lay->state), 0, sizeof(shm->lay->state));
+        shm->lay->state.speed_kmph = NAN;
+        shm->lay->version = GR_SHM_VERSION;
+        shm->lay->header_size = (uint16_t)offsetof(gr_shm_layout_t, state);
+        shm->lay->state_size = sizeof(gr_shm_state_t);
+        shm->lay->writer_pid = (int32_t)getpid();
+        __atomic_store_n(&(shm->lay->seq), 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&(shm->lay->magic), GR_SHM_MAGIC, __ATOMIC_RELEASE);
+        SSD1306_ATOMIC_ZERO(&(shm->_ref));
+        SSD1306_ATOMIC_INCREMENT(&(shm->_ref));
+        GRLOG_INFO("Publishing state in shared memory %s (%zu bytes)\n",
+                name, sizeof(gr_shm_layout_t));
+    } while (0);
+    if (rc < 0) {
+        if (shm) {
+            if (shm->fd >= 0)
+                close(shm->fd);
+            GR_FREE(shm->name);
+        }
+        GR_FREE(shm);
+        shm = NULL;
+    }
+    return shm;
+}
+
+void gr_shm_inc_ref(gr_shm_t *shm)
+{
+    if (shm) {
+        SSD1306_ATOMIC_INCREMENT(&(shm->_ref));
+    }
+}
+
+void gr_shm_cleanup(gr_shm_t *shm)
+{
+    if (shm) {
+        int zero = 0;
+        SSD1306_ATOMIC_DECREMENT(&(shm->_ref));
+        if (SSD1306_ATOMIC_IS_EQUAL(&(shm->_ref), &zero)) {
+            GRLOG_DEBUG("Shared memory %s published %" PRIu64 " times\n",
+                    shm->name, shm->num_publish);
+            if (shm->lay) {
+                /* readers that stay mapped can see that the writer is gone */
+                shm->lay->writer_pid = 0;
+                munmap(shm->lay, sizeof(gr_shm_layout_t));
+                shm->lay = NULL;
+            }
+            if (shm->fd >= 0) {
+                close(shm->fd);
+                shm->fd = -1;
+            }
+            if (shm->name) {
+                shm_unlink(shm->name);
+            }
+            GR_FREE(shm->name);
+            GR_FREE(shm);
+        }
+    }
+}
+
+int gr_shm_publish(gr_shm_t *shm, const gr_fix_t *fix,
+                const gr_lap_state_t *lap, uint64_t now_ns)
+{
+    if (!shm || !shm->lay || !fix)
+        return -1;
+    gr_shm_layout_t *lay = shm->lay;
+    gr_shm_state_t *st = &(lay->state);
+    uint32_t seq = __atomic_load_n(&(lay->seq), __ATOMIC_RELAXED);
+    /* odd sequence tells readers a write is in progress */
+    __atomic_store_n(&(lay->seq), seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    st->publish_ns = now_ns;
+    st->fix_ns = fix->mono_ns;
+    st->fix_rx_ns = fix->rx_ns;
+    st->fix_utc_ms = fix->utc_ms;
+    st->fix_seq = fix->seq;
+    st->lat_e7 = fix->lat_e7;
+    st->lon_e7 = fix->lon_e7;
+    st->speed_kmph = fix->speed_kmph;
+    if (lap) {
+        st->lap = lap->lap;
+        st->started = lap->started ? 1 : 0;
+        st->sector = lap->sector;
+        st->num_sectors = lap->num_sectors;
+        st->lap_start_ns = lap->lap_start_ns;
+        st->last_lap_ms = lap->last_lap_ms;
+        st->best_lap_ms = lap->best_lap_ms;
+        memcpy(st->sector_ms, lap->sector_ms, sizeof(st->sector_ms));
+        memcpy(st->best_sector_ms, lap->best_sector_ms, sizeof(st->best_sector_ms));
+    }
+    __atomic_store_n(&(lay->seq), seq + 2, __ATOMIC_RELEASE);
+    shm->num_publish++;
+    return 0;
+}
+
+gr_shm_layout_t *gr_shm_reader_open(const char *name)
+{
+    if (!name)
+        return NULL;
+    int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        int err = errno;
+        GRLOG_ERROR("Failed to open shared memory %s. Error: %s(%d)\n",
+                name, strerror(err), err);
+        return NULL;
+    }
+    struct stat sb = { 0 };
+    if (fstat(fd, &sb) < 0 || (size_t)sb.st_size < sizeof(gr_shm_layout_t)) {
+        GRLOG_ERROR("Shared memory %s is too small for this layout\n", name);
+        close(fd);
+        return NULL;
+    }
+    void *addr = mmap(NULL, sizeof(gr_shm_layout_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); /* the mapping stays valid */
+    if (addr == MAP_FAILED) {
+        int err = errno;
+        GRLOG_ERROR("Failed to map shared memory %s. Error: %s(%d)\n",
+                name, strerror(err), err);
+        return NULL;
+    }
+    gr_shm_layout_t *lay = (gr_shm_layout_t *)addr;
+    if (lay->magic != GR_SHM_MAGIC || lay->version != GR_SHM_VERSION ||
+        lay->state_size != sizeof(gr_shm_state_t)) {
+        GRLOG_ERROR("Shared memory %s has layout version %u, expected %u\n",
+                name, lay->version, GR_SHM_VERSION);
+        munmap(addr, sizeof(gr_shm_layout_t));
+        return NULL;
+    }
+    return lay;
+}
+
+void gr_shm_reader_close(gr_shm_layout_t *lay)
+{
+    if (lay) {
+        munmap(lay, sizeof(gr_shm_layout_t));
+    }
+}
@@ -31,6 +31,9 @@
 #ifdef GOODRACER_HAVE_STRING_H
 #include <string.h>
 #endif
+#ifdef GOODRACER_HAVE_MATH_H
+#include <math.h>
+#endif
 #ifdef GOODRACER_HAVE_EV_H
 #include <ev.h>
 #endif
@@ -56,15 +59,55 @@
 #include <ucontext.h>
 #endif
 #include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_laptimer.h>
+#include <goodracer_telemetry.h>
+#include <goodracer_shm.h>
+#include <goodracer_bus.h>
+#include <goodracer_trackmap.h>
+#include <goodracer_history.h>
+#include <goodracer_ui.h>
+#include <goodracer_i2cbus.h>
+#include <goodracer_display.h>
+#include <goodracer_rt.h>
 #include <goodracer_system.h>
 
 struct gr_gps_t_ {
     int fd;
     uint32_t baud_rate;
+    uint32_t req_baud_rate; /* what was asked for, re-applied on reconnect */
+    uint16_t fix_interval_ms; /* 0 for the GPS default, re-applied on reconnect */
+    char *dev;
     gpsdata_parser_t *parser;
     volatile int _ref; //reference counted
 };
 
+/* reconnect backoff doubles from the minimum up to the maximum. the first
+ * attempt is made right after the failure. a GPS that goes silent for the
+ * stall timeout is treated as disconnected, at 1Hz with 9600 baud the gap
+ * between bursts is about 800ms.
+ */
+#define GR_GPS_RECONNECT_MIN_MS 50
+#define GR_GPS_RECONNECT_MAX_MS 2000
+#define GR_GPS_STALL_TIMEOUT_MS 1500
+/* readable but empty reads in a row, which is how a gone USB tty looks */
+#define GR_GPS_MAX_EMPTY_READS 8
+
+/* a read can hold the start of the next epoch along with the end of the
+ * current one, so the fixes look up the arrival of their own epoch */
+#define GR_GPS_EPOCH_RING 4
+
+typedef struct {
+    int64_t utc_ms; /* -1 if unused */
+    uint64_t rx_ns;
+} gr_gps_epoch_t;
+
+typedef enum {
+    GR_GPS_STATE_CONNECTED = 0,
+    GR_GPS_STATE_DISCONNECTED, /* waiting on the backoff timer to reopen */
+    GR_GPS_STATE_RECOVERING /* reopened, waiting for the first parsed data */
+} gr_gps_state_t;
+
 static void gr_gps_inc_ref(gr_gps_t *gps)
 {
     if (gps) {
@@ -77,12 +120,81 @@ struct gr_sys_t_ {
     size_t num_signals;
     ev_signal *signals;
     bool verbose;
+    /* real-time mode */
+    bool rt_enabled;
+    gr_rt_config_t rt;
     gr_disp_t *disp;
+    /* display transfers */
+    ev_prepare disp_prepare; /* closes the display I/O account of an iteration */
+    ev_idle disp_idle; /* sends queued pages between GPS reads */
+    uint8_t disp_pages_per_iter; /* 0 for whole frames */
+    uint8_t disp_next_page;
+    uint32_t disp_pending; /* bitmask of the pages still to be sent */
+    bool disp_resend; /* pages were dropped, send all of them next time */
+    uint64_t disp_iter_ns; /* display I/O in the current iteration */
+    gr_display_stats_t disp_stats;
+    uint64_t disp_last_ns; /* last display update */
+    /* I2C transaction scheduler */
+    gr_i2cbus_t *i2cbus;
+    ev_prepare i2c_prepare; /* starts the idle watcher when there is work */
+    ev_idle i2c_idle;
+    uint64_t i2c_budget_ns;
     /* GPS watcher */
     gr_gps_t *gps;
     ev_io gps_watcher;
     gr_gps_on_read_t gps_io_read_cb;
     gr_gps_on_error_t gps_io_error_cb;
+    /* GPS reconnect state machine */
+    gr_gps_state_t gps_state;
+    ev_timer gps_reconnect_timer;
+    ev_timer gps_watchdog;
+    uint32_t gps_backoff_ms;
+    uint32_t gps_empty_reads;
+    uint64_t gps_last_rx_ns;
+    uint64_t gps_fail_ns;
+    uint64_t gps_gap_ns; /* last data before the outage */
+    uint32_t gps_attempts; /* for the current outage */
+    uint32_t gps_stall_ms; /* silence that counts as a disconnect */
+    gr_gps_stats_t gps_stats;
+    /* GPS receive timing */
+    char nmea_head[24]; /* start of the sentence being received */
+    size_t nmea_len;
+    int nmea_commas;
+    bool nmea_collect;
+    uint64_t nmea_rx_ns; /* arrival of its first byte */
+    int64_t epoch_utc_ms; /* of the current epoch, -1 before the first */
+    int64_t epoch_days; /* UTC day rollovers since the first epoch */
+    gr_gps_epoch_t epochs[GR_GPS_EPOCH_RING]; /* recent epochs by arrival */
+    size_t epoch_next;
+    int64_t epoch_diff[GR_GPS_TIMING_WINDOW]; /* arrival minus UTC */
+    uint64_t delay_sum_ns;
+    uint64_t delay_count;
+    gr_gps_timing_t gps_timing;
+    /* power saving */
+    bool power_enabled;
+    gr_power_config_t power;
+    gr_power_mode_t power_mode;
+    uint64_t power_mode_ns; /* when the current mode was entered */
+    uint64_t power_still_ns; /* first fix of the current stop, 0 if moving */
+    uint64_t power_wake_ns; /* when the loop last woke up, 0 if asleep */
+    ev_check power_check;
+    ev_prepare power_prepare;
+    gr_power_stats_t power_stats;
+    /* consolidated state */
+    gr_fix_t fix;
+    gr_laptimer_t *laptimer;
+    /* fan-out of the consolidated state to all the consumers */
+    gr_bus_t *bus;
+    /* telemetry publisher */
+    gr_telemetry_t *telemetry;
+    ev_timer telemetry_timer;
+    int telemetry_sub;
+    /* shared memory state for local consumers */
+    gr_shm_t *shm;
+    int shm_sub;
+    /* session history */
+    gr_history_t *history;
+    int history_sub;
 };
 
 /* if we ever need more complex backtraces, we can use libbacktrace */
@@ -113,6 +225,14 @@ static void gr_system_print_backtrace()
 static void gr_system_signal_cb(EV_P_ struct ev_signal *ev, int revents)
 {
     int sig = ev ? ev->signum : 0;
+    if ((revents & EV_SIGNAL) && sig == SIGUSR1) {
+        /* the screen button */
+        gr_sys_t *sys = (gr_sys_t *)(ev->data);
+        if (sys && sys->disp) {
+            gr_ui_next_screen(sys->disp->ui);
+        }
+        return;
+    }
     if (revents & EV_SIGNAL) {
         if (sig == SIGINT || sig == SIGQUIT) {
             GRLOG_WARN("Signal %d (%s) was thrown\n", sig, strsignal(sig));
@@ -137,10 +257,10 @@ static int gr_system_watch_signals(gr_sys_t *sys)
     if (sys && sys->loop) {
         int sigs[] = {
             SIGSEGV, SIGINT, SIGABRT, SIGHUP, SIGILL,
-            SIGTERM, SIGQUIT, SIGPWR, SIGFPE
+            SIGTERM, SIGQUIT, SIGPWR, SIGFPE, SIGUSR1
         };
         sys->num_signals = sizeof(sigs) / sizeof(int);
-        sys->signals = calloc(sys->num_signals, sizeof(ev_signal));
+        sys->signals = GR_CALLOC(sys->num_signals, sizeof(ev_signal));
         if (!sys->signals) {
             GRLOG_OUTOFMEM(sys->num_signals * sizeof(ev_signal));
             return -1;
@@ -157,10 +277,45 @@ static int gr_system_watch_signals(gr_sys_t *sys)
     return -1;
 }
 
-gr_sys_t *gr_system_setup()
+static void gr_system_stop_display(gr_sys_t *sys)
+{
+    if (sys && sys->loop && sys->disp) {
+        ev_idle_stop(sys->loop, &(sys->disp_idle));
+        ev_ref(sys->loop);
+        ev_prepare_stop(sys->loop, &(sys->disp_prepare));
+        sys->disp_pending = 0;
+    }
+}
+
+/* libev reallocs its watcher arrays, in arena mode they come from the arena */
+static void *gr_system_ev_alloc(void *ptr, long size)
+{
+    if (size <= 0) {
+        gr_mem_free(ptr);
+        return NULL;
+    }
+    return gr_mem_realloc(ptr, (size_t)size);
+}
+
+static void gr_system_bus_thread_init(const char *name, void *arg)
+{
+    gr_sys_t *sys = (gr_sys_t *)arg;
+    if (sys && sys->rt_enabled) {
+        if (gr_rt_setup_helper(&(sys->rt), name) < 0) {
+            GRLOG_WARN("Real-time: the %s thread runs with normal scheduling\n", name);
+        } else {
+            GRLOG_DEBUG("Real-time: set up the %s thread\n", name);
+        }
+    }
+}
+
+gr_sys_t *gr_system_setup(const gr_rt_config_t *rt)
 {
     int rc = 0;
-    gr_sys_t *sys = calloc(1, sizeof(gr_sys_t));
+    if (gr_mem_arena_enabled()) {
+        ev_set_allocator(gr_system_ev_alloc);
+    }
+    gr_sys_t *sys = GR_CALLOC(1, sizeof(gr_sys_t));
     if (!sys) {
         GRLOG_OUTOFMEM(sizeof(gr_sys_t));
         return NULL;
@@ -173,6 +328,38 @@ gr_sys_t *gr_system_setup()
             break;
         }
         sys->verbose = false;
+        if (rt) {
+            gr_rt_report_t rep;
+            memcpy(&(sys->rt), rt, sizeof(sys->rt));
+            sys->rt_enabled = true;
+            /* keep going without it, the self-check says what is missing */
+            gr_rt_setup(rt);
+            if (gr_rt_check(rt, &rep) < 0) {
+                GRLOG_WARN("Real-time mode is only partly in effect\n");
+            }
+            gr_rt_log_report(rt, &rep);
+        }
+        gr_fix_init(&(sys->fix));
+        sys->laptimer = gr_laptimer_create();
+        if (!sys->laptimer) {
+            GRLOG_ERROR("Failed to create the lap timer\n");
+            rc = -1;
+            break;
+        }
+        sys->telemetry_sub = -1;
+        sys->shm_sub = -1;
+        sys->history_sub = -1;
+        sys->epoch_utc_ms = -1;
+        for (size_t i = 0; i < GR_GPS_EPOCH_RING; ++i) {
+            sys->epochs[i].utc_ms = -1;
+        }
+        sys->bus = gr_bus_create(GR_BUS_DEFAULT_CAPACITY);
+        if (!sys->bus) {
+            GRLOG_ERROR("Failed to create the fix bus\n");
+            rc = -1;
+            break;
+        }
+        gr_bus_set_thread_init(sys->bus, gr_system_bus_thread_init, sys);
     } while (0);
     if (rc < 0) {
         gr_system_cleanup(sys);
@@ -181,21 +368,82 @@ gr_sys_t *gr_system_setup()
     return sys;
 }
 
+static void gr_system_power_log(const gr_sys_t *sys);
+
 void gr_system_cleanup(gr_sys_t *sys)
 {
     if (sys) {
         if (sys->gps) {
             ev_io_stop(sys->loop, &(sys->gps_watcher));
             memset(&(sys->gps_watcher), 0, sizeof(sys->gps_watcher));
+            ev_timer_stop(sys->loop, &(sys->gps_reconnect_timer));
+            ev_ref(sys->loop);
+            ev_timer_stop(sys->loop, &(sys->gps_watchdog));
+            if (sys->gps_timing.valid) {
+                GRLOG_INFO("GPS timing: %" PRIu64 " epochs, delay avg %" PRIu64 " us max %" PRIu64 " us, arrival jitter max %" PRIu64 " us\n",
+                        sys->gps_timing.epochs, sys->gps_timing.avg_delay_ns / 1000,
+                        sys->gps_timing.max_delay_ns / 1000, sys->gps_timing.max_jitter_ns / 1000);
+            }
+            if (sys->gps_stats.disconnects > 0) {
+                GRLOG_INFO("GPS disconnected %u times, recovered %u times, worst gap in data %u ms, worst recovery %u ms\n",
+                        sys->gps_stats.disconnects, sys->gps_stats.reconnects,
+                        sys->gps_stats.max_gap_ms, sys->gps_stats.max_recovery_ms);
+            }
             sys->gps_io_read_cb = NULL;
             sys->gps_io_error_cb = NULL;
             gr_gps_cleanup(sys->gps);
             sys->gps = NULL;
         }
         if (sys->disp) {
+            gr_system_stop_display(sys);
+            if (sys->disp_stats.frames > 0) {
+                GRLOG_INFO("Display: %" PRIu64 " frames, %" PRIu64 " superseded, %" PRIu64 " pages sent, worst I/O in a loop iteration %" PRIu64 " us\n",
+                        sys->disp_stats.frames, sys->disp_stats.superseded,
+                        sys->disp_stats.pages_sent, sys->disp_stats.max_iter_ns / 1000);
+            }
             gr_display_cleanup(sys->disp);
             sys->disp = NULL;
         }
+        if (sys->i2cbus) {
+            ev_idle_stop(sys->loop, &(sys->i2c_idle));
+            ev_ref(sys->loop);
+            ev_prepare_stop(sys->loop, &(sys->i2c_prepare));
+            gr_i2cbus_cleanup(sys->i2cbus);
+            sys->i2cbus = NULL;
+        }
+        if (sys->power_enabled) {
+            gr_system_power_log(sys);
+            ev_ref(sys->loop);
+            ev_check_stop(sys->loop, &(sys->power_check));
+            ev_ref(sys->loop);
+            ev_prepare_stop(sys->loop, &(sys->power_prepare));
+            sys->power_enabled = false;
+        }
+        /* stops the threaded subscribers before what they use goes away */
+        gr_bus_free(sys->bus);
+        sys->bus = NULL;
+        if (sys->telemetry) {
+            ev_ref(sys->loop);
+            ev_timer_stop(sys->loop, &(sys->telemetry_timer));
+            gr_telemetry_flush(sys->telemetry, gr_monotonic_ns());
+            gr_telemetry_cleanup(sys->telemetry);
+            sys->telemetry = NULL;
+        }
+        if (sys->shm) {
+            gr_shm_cleanup(sys->shm);
+            sys->shm = NULL;
+        }
+        if (sys->history) {
+            gr_history_stats_t hst;
+            gr_history_get_stats(sys->history, &hst);
+            GRLOG_INFO("History: %u laps, %zu kept, %zu of %zu bytes, %u summaries forgotten\n",
+                    hst.laps, gr_history_num_laps(sys->history), hst.used_bytes,
+                    hst.max_bytes, hst.forgotten);
+            gr_history_free(sys->history);
+            sys->history = NULL;
+        }
+        gr_laptimer_free(sys->laptimer);
+        sys->laptimer = NULL;
         if (sys->loop) {
             if (sys->signals) {
                 for (size_t i = 0; i < sys->num_signals; ++i) {
@@ -235,11 +483,37 @@ int gr_system_run(gr_sys_t *sys)
 {
     int rc = 0;
     if (sys && sys->loop) {
+        gr_mem_stats_t mst;
+        gr_rt_report_t rt_start, rt_end;
+        if (sys->rt_enabled) {
+            gr_rt_check(&(sys->rt), &rt_start);
+        }
         GRLOG_DEBUG("Event loop run started\n");
+        gr_mem_set_running(true);
         rc = ev_run(sys->loop, 0);
+        gr_mem_set_running(false);
+        if (sys->rt_enabled) {
+            gr_rt_check(&(sys->rt), &rt_end);
+            if (rt_start.minor_faults >= 0 && rt_end.minor_faults >= 0) {
+                GRLOG_INFO("Real-time: %ld minor and %ld major page faults while running\n",
+                        rt_end.minor_faults - rt_start.minor_faults,
+                        rt_end.major_faults - rt_start.major_faults);
+            }
+        }
         if (rc < 0) {
             GRLOG_ERROR("Event loop returned %d\n", rc);
         }
+        gr_mem_get_stats(&mst);
+        if (mst.budget > 0) {
+            GRLOG_INFO("Memory arena: %zu of %zu bytes used in %" PRIu64 " allocations, %" PRIu64 " over budget\n",
+                    mst.used, mst.budget, mst.arena_allocs, mst.failed);
+        }
+        if (mst.running_heap_growth != INT64_MIN) {
+            GRLOG_INFO("Memory: %" PRIu64 " allocations while running, process heap changed by %" PRId64 " bytes\n",
+                    mst.running_allocs, mst.running_heap_growth);
+        } else {
+            GRLOG_INFO("Memory: %" PRIu64 " allocations while running\n", mst.running_allocs);
+        }
     } else {
         GRLOG_ERROR("Invalid system object, cannot run loop\n");
         rc = -1;
@@ -247,78 +521,91 @@ int gr_system_run(gr_sys_t *sys)
     return rc;
 }
 
-gr_disp_t *gr_display_i2c_setup(const char *dev, uint8_t addr, uint8_t width, uint8_t height)
+/* the checksum of an NMEA sentence is the XOR of everything between the $
+ * and the * */
+static int gr_gps_send_pmtk(gr_gps_t *gps, const char *body)
+{
+    char buf[64];
+    uint8_t cs = 0;
+    for (const char *p = body; *p != '\0'; ++p) {
+        cs ^= (uint8_t)(*p);
+    }
+    int len = snprintf(buf, sizeof(buf), "$%s*%02X\r\n", body, cs);
+    if (len < 0 || (size_t)len >= sizeof(buf))
+        return -1;
+    ssize_t nb = write(gps->fd, buf, (size_t)len);
+    if (nb != (ssize_t)len) {
+        int err = errno;
+        GRLOG_ERROR("Failed to write %s to the GPS. Error: %s(%d)\n", body,
+                strerror(err), err);
+        return -1;
+    }
+    return 0;
+}
+
+/* set both how often the GPS fixes and how often it reports. if the device is
+ * closed it is applied when it is reopened */
+static int gr_gps_set_fix_interval(gr_gps_t *gps, uint16_t ms)
 {
+    char body[32];
     int rc = 0;
-    gr_disp_t *disp = NULL;
-    do {
-        if (!dev) {
-            GRLOG_ERROR("I2C display device path cannot be NULL\n");
-            rc = -1;
-            break;
-        }
-        disp = calloc(1, sizeof(*disp));
-        if (!disp) {
-            GRLOG_OUTOFMEM(sizeof(*disp));
-            rc = -1;
-            break;
-        }
-        /* connect the I2C OLED */
-        disp->oled = ssd1306_i2c_open(dev, addr, width, height, NULL);
-        if (!disp->oled) {
-            GRLOG_ERROR("Failed to setup the I2C OLED device");
-            rc = -1;
-            break;
-        }
-        if (ssd1306_i2c_display_initialize(disp->oled) < 0) {
-            GRLOG_ERROR("Failed to initialize the display. Check if it is connected\n");
-            rc = -1;
-            break;
-        }
-        /* clear the display */
-        ssd1306_i2c_display_clear(disp->oled);
-        /* create the framebuffer */
-        disp->fbp = ssd1306_framebuffer_create(disp->oled->width, disp->oled->height, disp->oled->err);
-        if (!disp->fbp) {
-            GRLOG_ERROR("Failed to create framebuffer object, cannot proceed");
-            rc = -1;
-            break;
+    gps->fix_interval_ms = ms;
+    if (gps->fd < 0)
+        return 0;
+    snprintf(body, sizeof(body), "PMTK300,%u,0,0,0,0", ms);
+    if (gr_gps_send_pmtk(gps, body) < 0)
+        rc = -1;
+    snprintf(body, sizeof(body), "PMTK220,%u", ms);
+    if (gr_gps_send_pmtk(gps, body) < 0)
+        rc = -1;
+    return rc;
+}
+
+/* open the device and apply the configuration. used at setup and every time
+ * the GPS is reconnected, so the GPS always ends up in the same state */
+static int gr_gps_open_device(gr_gps_t *gps)
+{
+    gps->fd = gpsdevice_open(gps->dev, true);
+    if (gps->fd < 0) {
+        GRLOG_ERROR("Failed to open GPS device on path %s\n", gps->dev);
+        return -1;
+    }
+    gps->baud_rate = 9600;
+    /* set baudrate if not 9600 */
+    if (gps->req_baud_rate != 9600) {
+        if (gpsdevice_set_baudrate(gps->fd, gps->req_baud_rate) < 0) {
+            GRLOG_WARN("Unable to set baud rate of %d on the GPS, continuing to use the default\n", gps->req_baud_rate);
+
+        } else {
+            GRLOG_INFO("Explicitly setting GPS Baud rate to %d\n", gps->req_baud_rate);
+            gps->baud_rate = gps->req_baud_rate;
         }
-        SSD1306_ATOMIC_ZERO(&(disp->_ref));
-        SSD1306_ATOMIC_INCREMENT(&(disp->_ref));
-    } while (0);
-    if (rc < 0) {
-        gr_display_cleanup(disp);
-        disp = NULL;
     }
-    return disp;
+    if (gps->fix_interval_ms > 0) {
+        gr_gps_set_fix_interval(gps, gps->fix_interval_ms);
+    }
+    gpsdevice_request_antenna_status(gps->fd, true, false);
+    gpsdevice_request_firmware_info(gps->fd);
+    return 0;
 }
 
-void gr_display_inc_ref(gr_disp_t *disp)
+static void gr_gps_close_device(gr_gps_t *gps)
 {
-    if (disp) {
-        SSD1306_ATOMIC_INCREMENT(&(disp->_ref));
+    if (gps->fd >= 0) {
+        gpsdevice_close(gps->fd);
+        gps->fd = -1;
     }
 }
 
-void gr_display_cleanup(gr_disp_t *disp)
+/* close and reopen the device. the parser may hold half a sentence from
+ * before the outage so it is resynced too */
+static int gr_gps_reopen(gr_gps_t *gps)
 {
-    if (disp) {
-        int zero = 0;
-        SSD1306_ATOMIC_DECREMENT(&(disp->_ref));
-        if (SSD1306_ATOMIC_IS_EQUAL(&(disp->_ref), &zero)) {
-            if (disp->fbp) {
-                ssd1306_framebuffer_destroy(disp->fbp);
-                disp->fbp = NULL;
-            }
-            if (disp->oled) {
-                ssd1306_i2c_display_clear(disp->oled);
-                ssd1306_i2c_close(disp->oled);
-                disp->oled = NULL;
-            }
-            GR_FREE(disp);
-        }
-    }
+    gr_gps_close_device(gps);
+    if (gr_gps_open_device(gps) < 0)
+        return -1;
+    gpsdata_parser_reset(gps->parser);
+    return 0;
 }
 
 gr_gps_t *gr_gps_setup(const char *dev, uint32_t baud_rate)
@@ -331,37 +618,30 @@ gr_gps_t *gr_gps_setup(const char *dev, uint32_t baud_rate)
             rc = -1;
             break;
         }
-        gps = calloc(1, sizeof(*gps));
+        gps = GR_CALLOC(1, sizeof(*gps));
         if (!gps) {
             GRLOG_OUTOFMEM(sizeof(*gps));
             rc = -1;
             break;
         }
+        gps->fd = -1;
+        gps->dev = GR_STRDUP(dev);
+        if (!gps->dev) {
+            GRLOG_OUTOFMEM(strlen(dev) + 1);
+            rc = -1;
+            break;
+        }
         gps->parser = gpsdata_parser_create();
         if (!gps->parser) {
             GRLOG_ERROR("Failed to create GPS data parser object\n");
             rc = -1;
             break;
         }
-        gps->fd = gpsdevice_open(dev, true);
-        if (gps->fd < 0) {
-            GRLOG_ERROR("Failed to open GPS device on path %s\n", dev);
+        gps->req_baud_rate = baud_rate;
+        if (gr_gps_open_device(gps) < 0) {
             rc = -1;
             break;
         }
-        gps->baud_rate = 9600;
-        /* set baudrate if not 9600 */
-        if (baud_rate != 9600) {
-            if (gpsdevice_set_baudrate(gps->fd, baud_rate) < 0) {
-                GRLOG_WARN("Unable to set baud rate of %d on the GPS, continuing to use the default\n", baud_rate);
-
-            } else {
-                GRLOG_INFO("Explicitly setting GPS Baud rate to %d\n", baud_rate);
-                gps->baud_rate = baud_rate;
-            }
-        }
-        gpsdevice_request_antenna_status(gps->fd, true, false);
-        gpsdevice_request_firmware_info(gps->fd);
         SSD1306_ATOMIC_ZERO(&(gps->_ref));
         SSD1306_ATOMIC_INCREMENT(&(gps->_ref));
     } while (0);
@@ -380,30 +660,97 @@ void gr_gps_cleanup(gr_gps_t *gps)
         if (SSD1306_ATOMIC_IS_EQUAL(&(gps->_ref), &zero)) {
             gpsdata_parser_free(gps->parser);
             gps->parser = NULL;
-            gpsdevice_close(gps->fd);
-            gps->fd = -1;
+            gr_gps_close_device(gps);
+            GR_FREE(gps->dev);
             GR_FREE(gps);
         }
     }
 }
 
+/* the prepare watcher runs right before the loop blocks or polls, which is
+ * the end of an iteration, so whatever display I/O happened since the last
+ * one was all done in a single iteration */
+static void gr_system_display_prepare_cb(EV_P_ ev_prepare *w, int revents)
+{
+    if (w && (revents & EV_PREPARE)) {
+        gr_sys_t *sys = (gr_sys_t *)(w->data);
+        if (sys) {
+            if (sys->disp_iter_ns > sys->disp_stats.max_iter_ns) {
+                sys->disp_stats.max_iter_ns = sys->disp_iter_ns;
+            }
+            sys->disp_iter_ns = 0;
+        }
+    }
+}
+
+static void gr_system_display_idle_cb(EV_P_ ev_idle *w, int revents)
+{
+    if (!w || !(revents & EV_IDLE))
+        return;
+    gr_sys_t *sys = (gr_sys_t *)(w->data);
+    if (!sys || !sys->disp || !sys->disp->fbp) {
+        ev_idle_stop(EV_A_ w);
+        return;
+    }
+    uint8_t num_pages = sys->disp->fbp->height / 8;
+    uint64_t start_ns = gr_monotonic_ns();
+    /* round robin from where the last iteration stopped so a page that is
+     * redrawn on every fix cannot starve the ones after it */
+    for (uint8_t n = 0; n < sys->disp_pages_per_iter && sys->disp_pending; ) {
+        uint8_t page = sys->disp_next_page;
+        sys->disp_next_page = (uint8_t)((page + 1) % num_pages);
+        if (!(sys->disp_pending & (1U << page)))
+            continue;
+        sys->disp_pending &= ~(1U << page);
+        n++;
+        if (gr_display_update_page(sys->disp, page) < 0) {
+            /* the display may be gone. do not spin on it, the next update
+             * sends everything again */
+            sys->disp_stats.errors++;
+            sys->disp_pending = 0;
+            sys->disp_resend = true;
+            break;
+        }
+        sys->disp_stats.pages_sent++;
+    }
+    uint64_t io_ns = gr_monotonic_ns() - start_ns;
+    sys->disp_iter_ns += io_ns;
+    sys->disp_stats.io_ns += io_ns;
+    if (!sys->disp_pending) {
+        ev_idle_stop(EV_A_ w);
+        if (gr_display_frame_done(sys->disp) < 0) {
+            sys->disp_stats.errors++;
+        }
+    }
+}
+
 int gr_system_set_display(gr_sys_t *sys, gr_disp_t *disp, bool welcome)
 {
     if (sys && disp) {
         if (sys->disp) {
+            gr_system_stop_display(sys);
             gr_display_cleanup(sys->disp);
             sys->disp = NULL;
         }
         sys->disp = disp;
         gr_display_inc_ref(disp);
+        sys->disp_pending = 0;
+        sys->disp_resend = false;
+        sys->disp_next_page = 0;
+        ev_idle_init(&(sys->disp_idle), gr_system_display_idle_cb);
+        sys->disp_idle.data = (void *)sys;
+        ev_prepare_init(&(sys->disp_prepare), gr_system_display_prepare_cb);
+        sys->disp_prepare.data = (void *)sys;
+        ev_prepare_start(sys->loop, &(sys->disp_prepare));
+        ev_unref(sys->loop);// long running watcher
         GRLOG_DEBUG("Successfully set the display pointer for the system");
-        if (welcome && disp->oled && disp->fbp) {
+        if (welcome && disp->fbp) {
             char buf[64] = { 0 };
             ssd1306_framebuffer_box_t bbox = { 0 };
             snprintf(buf, sizeof(buf) - 1, "GOODRACER");
             ssd1306_framebuffer_clear(disp->fbp);
             ssd1306_framebuffer_draw_text(disp->fbp, buf, 0, 16, 12, SSD1306_FONT_DEFAULT, 4, &bbox);
-            if (ssd1306_i2c_display_update(disp->oled, disp->fbp) < 0) {
+            if (gr_display_update(disp) < 0) {
                 GRLOG_ERROR("Failed to update display with welcome screen\n");
                 return -1;
             }
@@ -413,34 +760,718 @@ int gr_system_set_display(gr_sys_t *sys, gr_disp_t *disp, bool welcome)
     return -1;
 }
 
+int gr_system_set_display_chunked(gr_sys_t *sys, uint8_t pages_per_iter)
+{
+    if (!sys || !sys->disp || !sys->disp->fbp) {
+        GRLOG_ERROR("Invalid system or no display set\n");
+        return -1;
+    }
+    if (sys->disp->fbp->height / 8 > 32) {
+        GRLOG_ERROR("Display with %u pages is too tall for chunked transfers\n",
+                sys->disp->fbp->height / 8);
+        return -1;
+    }
+    if (pages_per_iter == 0) {
+        ev_idle_stop(sys->loop, &(sys->disp_idle));
+        sys->disp_pending = 0;
+    }
+    sys->disp_pages_per_iter = pages_per_iter;
+    GRLOG_DEBUG("Display transfers set to %u pages per loop iteration\n", pages_per_iter);
+    return 0;
+}
+
+int gr_system_update_display(gr_sys_t *sys)
+{
+    if (!sys || !sys->disp || !sys->disp->fbp)
+        return -1;
+    gr_disp_t *disp = sys->disp;
+    uint8_t num_pages = disp->fbp->height / 8;
+    uint32_t all = (num_pages >= 32) ? 0xFFFFFFFFU : ((1U << num_pages) - 1);
+    uint32_t dirty = disp->ui ? gr_ui_take_dirty_pages(disp->ui) : all;
+    uint64_t start_ns = gr_monotonic_ns();
+    sys->disp_stats.frames++;
+    sys->disp_last_ns = start_ns;
+    sys->power_stats.modes[sys->power_mode].display_frames++;
+    if (sys->disp_pages_per_iter == 0) {
+        int rc = gr_display_update(disp);
+        uint64_t io_ns = gr_monotonic_ns() - start_ns;
+        sys->disp_iter_ns += io_ns;
+        sys->disp_stats.io_ns += io_ns;
+        if (rc < 0) {
+            sys->disp_stats.errors++;
+            GRLOG_ERROR("Failed to update the %s display\n", disp->backend->name);
+            return -1;
+        }
+        sys->disp_stats.pages_sent += num_pages;
+        return 0;
+    }
+    if (sys->disp_pending) {
+        sys->disp_stats.superseded++;
+    }
+    if (sys->disp_resend) {
+        /* pages were dropped after an error */
+        dirty = all;
+        sys->disp_resend = false;
+    }
+    sys->disp_pending |= (dirty & all);
+    if (sys->disp_pending) {
+        ev_idle_start(sys->loop, &(sys->disp_idle));
+    }
+    return 0;
+}
+
+int gr_system_get_display_stats(const gr_sys_t *sys, gr_display_stats_t *st)
+{
+    if (!sys || !st)
+        return -1;
+    memcpy(st, &(sys->disp_stats), sizeof(*st));
+    return 0;
+}
+
+static void gr_system_i2c_prepare_cb(EV_P_ ev_prepare *w, int revents)
+{
+    if (w && (revents & EV_PREPARE)) {
+        gr_sys_t *sys = (gr_sys_t *)(w->data);
+        if (sys && gr_i2cbus_pending(sys->i2cbus) > 0) {
+            ev_idle_start(EV_A_ &(sys->i2c_idle));
+        }
+    }
+}
+
+/* runs after the GPS and timer callbacks of the iteration, which is where
+ * sensor reads get queued, so they go ahead of any display pages */
+static void gr_system_i2c_idle_cb(EV_P_ ev_idle *w, int revents)
+{
+    if (w && (revents & EV_IDLE)) {
+        gr_sys_t *sys = (gr_sys_t *)(w->data);
+        if (sys && sys->i2cbus) {
+            gr_i2cbus_run(sys->i2cbus, sys->i2c_budget_ns);
+        }
+        if (!sys || gr_i2cbus_pending(sys->i2cbus) == 0) {
+            ev_idle_stop(EV_A_ w);
+        }
+    }
+}
+
+int gr_system_set_i2cbus(gr_sys_t *sys, gr_i2cbus_t *bus, uint32_t budget_us)
+{
+    if (!sys || !sys->loop || !bus) {
+        GRLOG_ERROR("Invalid system or I2C bus objects used as parameters\n");
+        return -1;
+    }
+    if (sys->i2cbus) {
+        ev_idle_stop(sys->loop, &(sys->i2c_idle));
+        ev_ref(sys->loop);
+        ev_prepare_stop(sys->loop, &(sys->i2c_prepare));
+        gr_i2cbus_cleanup(sys->i2cbus);
+        sys->i2cbus = NULL;
+    }
+    sys->i2cbus = bus;
+    gr_i2cbus_inc_ref(bus);
+    sys->i2c_budget_ns = (uint64_t)budget_us * 1000;
+    ev_idle_init(&(sys->i2c_idle), gr_system_i2c_idle_cb);
+    sys->i2c_idle.data = (void *)sys;
+    ev_prepare_init(&(sys->i2c_prepare), gr_system_i2c_prepare_cb);
+    sys->i2c_prepare.data = (void *)sys;
+    ev_prepare_start(sys->loop, &(sys->i2c_prepare));
+    ev_unref(sys->loop);// long running watcher
+    GRLOG_DEBUG("I2C bus scheduler runs for up to %u us per loop iteration\n", budget_us);
+    return 0;
+}
+
+gr_i2cbus_t *gr_system_get_i2cbus(const gr_sys_t *sys)
+{
+    return sys ? sys->i2cbus : NULL;
+}
+
+int gr_system_add_gate(gr_sys_t *sys, const gr_gate_t *gate)
+{
+    if (sys && sys->laptimer && gate) {
+        return gr_laptimer_add_gate(sys->laptimer, gate);
+    }
+    return -1;
+}
+
+const gr_fix_t *gr_system_get_fix(const gr_sys_t *sys)
+{
+    return sys ? &(sys->fix) : NULL;
+}
+
+const gr_lap_state_t *gr_system_get_lap_state(const gr_sys_t *sys)
+{
+    return sys ? gr_laptimer_state(sys->laptimer) : NULL;
+}
+
+int gr_system_subscribe(gr_sys_t *sys, const char *name,
+                gr_bus_consumer_t cb, void *arg, bool threaded)
+{
+    if (!sys || !sys->bus || !cb) {
+        GRLOG_ERROR("Invalid system or callback used as parameters\n");
+        return -1;
+    }
+    return gr_bus_subscribe(sys->bus, name, cb, arg, threaded);
+}
+
+static void gr_system_telemetry_consumer(const gr_bus_record_t *rec, void *arg)
+{
+    gr_sys_t *sys = (gr_sys_t *)arg;
+    if (sys && sys->telemetry) {
+        gr_telemetry_push(sys->telemetry, &(rec->fix), &(rec->lap));
+    }
+}
+
+static void gr_system_shm_consumer(const gr_bus_record_t *rec, void *arg)
+{
+    gr_sys_t *sys = (gr_sys_t *)arg;
+    if (sys && sys->shm) {
+        gr_shm_publish(sys->shm, &(rec->fix), &(rec->lap), rec->fix.mono_ns);
+    }
+}
+
+static void gr_system_telemetry_cb(EV_P_ ev_timer *w, int revents)
+{
+    if (w && (revents & EV_TIMER)) {
+        gr_sys_t *sys = (gr_sys_t *)(w->data);
+        if (sys && sys->telemetry) {
+            gr_telemetry_flush(sys->telemetry, gr_monotonic_ns());
+        }
+    }
+}
+
+int gr_system_set_telemetry(gr_sys_t *sys, gr_telemetry_t *tele)
+{
+    if (!sys || !sys->loop || !tele) {
+        GRLOG_ERROR("Invalid system or telemetry objects used as parameters\n");
+        return -1;
+    }
+    if (sys->telemetry) {
+        ev_ref(sys->loop);
+        ev_timer_stop(sys->loop, &(sys->telemetry_timer));
+        gr_telemetry_cleanup(sys->telemetry);
+        sys->telemetry = NULL;
+    }
+    if (sys->telemetry_sub < 0) {
+        /* inline since the telemetry is flushed from the event loop */
+        sys->telemetry_sub = gr_bus_subscribe(sys->bus, "telemetry",
+                                gr_system_telemetry_consumer, sys, false);
+        if (sys->telemetry_sub < 0) {
+            GRLOG_ERROR("Failed to subscribe telemetry to the fix bus\n");
+            return -1;
+        }
+    }
+    sys->telemetry = tele;
+    gr_telemetry_inc_ref(tele);
+    double interval = gr_telemetry_interval(tele);
+    ev_timer_init(&(sys->telemetry_timer), gr_system_telemetry_cb, interval, interval);
+    sys->telemetry_timer.data = (void *)sys;
+    ev_timer_start(sys->loop, &(sys->telemetry_timer));
+    ev_unref(sys->loop);// long running watcher
+    GRLOG_DEBUG("Telemetry flush timer started with interval %0.3fs\n", interval);
+    return 0;
+}
+
+int gr_system_set_shm(gr_sys_t *sys, gr_shm_t *shm)
+{
+    if (!sys || !shm) {
+        GRLOG_ERROR("Invalid system or shared memory objects used as parameters\n");
+        return -1;
+    }
+    if (sys->shm) {
+        gr_shm_cleanup(sys->shm);
+        sys->shm = NULL;
+    }
+    if (sys->shm_sub < 0) {
+        sys->shm_sub = gr_bus_subscribe(sys->bus, "shm",
+                            gr_system_shm_consumer, sys, false);
+        if (sys->shm_sub < 0) {
+            GRLOG_ERROR("Failed to subscribe shared memory to the fix bus\n");
+            return -1;
+        }
+    }
+    sys->shm = shm;
+    gr_shm_inc_ref(shm);
+    return 0;
+}
+
+static void gr_system_history_consumer(const gr_bus_record_t *rec, void *arg)
+{
+    gr_sys_t *sys = (gr_sys_t *)arg;
+    if (sys && sys->history) {
+        gr_history_update(sys->history, &(rec->fix), &(rec->lap), rec->lap_events);
+    }
+}
+
+int gr_system_set_history(gr_sys_t *sys, size_t max_bytes)
+{
+    if (!sys) {
+        GRLOG_ERROR("Invalid system object used as parameter\n");
+        return -1;
+    }
+    if (sys->history) {
+        GRLOG_ERROR("History is already set\n");
+        return -1;
+    }
+    sys->history = gr_history_create(max_bytes);
+    if (!sys->history) {
+        GRLOG_ERROR("Failed to create the session history\n");
+        return -1;
+    }
+    /* inline so it only changes on the event loop, where
+     * gr_system_get_history() callers read it without locking */
+    sys->history_sub = gr_bus_subscribe(sys->bus, "history",
+                            gr_system_history_consumer, sys, false);
+    if (sys->history_sub < 0) {
+        GRLOG_ERROR("Failed to subscribe the history to the fix bus\n");
+        gr_history_free(sys->history);
+        sys->history = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+const gr_history_t *gr_system_get_history(const gr_sys_t *sys)
+{
+    return sys ? sys->history : NULL;
+}
+
+/* a GGA or RMC sentence with a UTC time different from the last one starts a
+ * new epoch. the difference of its arrival from the UTC time goes into the
+ * window and the smallest one in there is the offset. in the idle power mode
+ * the loop collects the reads for up to idle_collect_ms, so the arrival is
+ * late by that much and the epoch is left out of the window */
+static void gr_system_gps_epoch(gr_sys_t *sys, int64_t utc_ms, uint64_t rx_ns)
+{
+    if (utc_ms == sys->epoch_utc_ms)
+        return;
+    if (sys->epoch_utc_ms >= 0 && utc_ms < sys->epoch_utc_ms - GR_FIX_MS_PER_DAY / 2) {
+        sys->epoch_days++;
+    }
+    sys->epoch_utc_ms = utc_ms;
+    sys->epochs[sys->epoch_next].utc_ms = utc_ms;
+    sys->epochs[sys->epoch_next].rx_ns = rx_ns;
+    sys->epoch_next = (sys->epoch_next + 1) % GR_GPS_EPOCH_RING;
+    if (sys->power_enabled && sys->power_mode == GR_POWER_MODE_IDLE)
+        return;
+    int64_t utc_ns = (sys->epoch_days * GR_FIX_MS_PER_DAY + utc_ms) * 1000000LL;
+    int64_t diff = (int64_t)rx_ns - utc_ns;
+    gr_gps_timing_t *tm = &(sys->gps_timing);
+    sys->epoch_diff[tm->epochs % GR_GPS_TIMING_WINDOW] = diff;
+    tm->epochs++;
+    size_t num = (tm->epochs < GR_GPS_TIMING_WINDOW) ? tm->epochs : GR_GPS_TIMING_WINDOW;
+    int64_t offset = sys->epoch_diff[0];
+    for (size_t i = 1; i < num; ++i) {
+        if (sys->epoch_diff[i] < offset)
+            offset = sys->epoch_diff[i];
+    }
+    tm->offset_ns = offset;
+    tm->valid = true;
+    tm->last_jitter_ns = (uint64_t)(diff - offset);
+    if (tm->last_jitter_ns > tm->max_jitter_ns)
+        tm->max_jitter_ns = tm->last_jitter_ns;
+}
+
+/* pick out the start of every sentence in what was read. rx_ns is when the
+ * read returned, so a byte that came k bytes before the last one arrived
+ * about k byte times earlier */
+static void gr_system_gps_stamp(gr_sys_t *sys, const char *buf, size_t len,
+                uint64_t rx_ns)
+{
+    uint32_t baud = (sys->gps && sys->gps->baud_rate > 0) ? sys->gps->baud_rate : 9600;
+    uint64_t byte_ns = 10000000000ULL / baud; /* 8N1 */
+    for (size_t i = 0; i < len; ++i) {
+        char c = buf[i];
+        if (c == '$') {
+            uint64_t back_ns = (uint64_t)(len - 1 - i) * byte_ns;
+            sys->nmea_rx_ns = (rx_ns > back_ns) ? (rx_ns - back_ns) : rx_ns;
+            sys->nmea_len = 0;
+            sys->nmea_commas = 0;
+            sys->nmea_collect = true;
+        }
+        if (!sys->nmea_collect)
+            continue;
+        bool done = (c == '\r' || c == '\n');
+        if (!done) {
+            sys->nmea_head[sys->nmea_len++] = c;
+            if (c == ',')
+                sys->nmea_commas++;
+            /* the time is the first field */
+            done = (sys->nmea_commas >= 2 || sys->nmea_len >= sizeof(sys->nmea_head));
+        }
+        if (done) {
+            int64_t utc_ms = gr_nmea_utc_ms(sys->nmea_head, sys->nmea_len);
+            if (utc_ms >= 0) {
+                gr_system_gps_epoch(sys, utc_ms, sys->nmea_rx_ns);
+            }
+            sys->nmea_collect = false;
+        }
+    }
+}
+
+int gr_system_get_gps_timing(const gr_sys_t *sys, gr_gps_timing_t *tm)
+{
+    if (!sys || !tm)
+        return -1;
+    memcpy(tm, &(sys->gps_timing), sizeof(*tm));
+    return 0;
+}
+
+uint64_t gr_system_gps_utc_to_mono(const gr_sys_t *sys, int64_t utc_ms)
+{
+    if (!sys || !sys->gps_timing.valid || utc_ms < 0 || utc_ms >= GR_FIX_MS_PER_DAY)
+        return 0;
+    /* the day closest to the current epoch */
+    int64_t days = sys->epoch_days;
+    int64_t delta = utc_ms - sys->epoch_utc_ms;
+    if (delta > GR_FIX_MS_PER_DAY / 2) {
+        days--;
+    } else if (delta < -GR_FIX_MS_PER_DAY / 2) {
+        days++;
+    }
+    int64_t mono = (days * GR_FIX_MS_PER_DAY + utc_ms) * 1000000LL + sys->gps_timing.offset_ns;
+    return (mono > 0) ? (uint64_t)mono : 0;
+}
+
+void gr_power_config_init(gr_power_config_t *cfg)
+{
+    if (cfg) {
+        memset(cfg, 0, sizeof(*cfg));
+        cfg->idle_below_kmph = GR_POWER_IDLE_BELOW_KMPH;
+        cfg->idle_after_ms = GR_POWER_IDLE_AFTER_MS;
+        cfg->active_above_kmph = GR_POWER_ACTIVE_ABOVE_KMPH;
+        cfg->active_fix_ms = GR_POWER_ACTIVE_FIX_MS;
+        cfg->idle_fix_ms = GR_POWER_IDLE_FIX_MS;
+        cfg->idle_display_ms = GR_POWER_IDLE_DISPLAY_MS;
+        cfg->idle_collect_ms = GR_POWER_IDLE_COLLECT_MS;
+    }
+}
+
+static const char *gr_power_mode_name(gr_power_mode_t mode)
+{
+    return (mode == GR_POWER_MODE_IDLE) ? "stationary" : "moving";
+}
+
+static void gr_system_power_switch(gr_sys_t *sys, gr_power_mode_t mode, uint64_t now_ns)
+{
+    bool idle = (mode == GR_POWER_MODE_IDLE);
+    uint16_t fix_ms = idle ? sys->power.idle_fix_ms : sys->power.active_fix_ms;
+    sys->power_stats.modes[sys->power_mode].time_ns += now_ns - sys->power_mode_ns;
+    sys->power_stats.modes[mode].entered++;
+    sys->power_stats.mode = mode;
+    sys->power_mode = mode;
+    sys->power_mode_ns = now_ns;
+    sys->power_still_ns = 0;
+    if (sys->gps) {
+        if (gr_gps_set_fix_interval(sys->gps, fix_ms) < 0) {
+            GRLOG_WARN("Failed to set the GPS fix interval to %u ms\n", fix_ms);
+        }
+        /* a GPS that was told to be slow is not a silent one */
+        sys->gps_stall_ms = GR_GPS_STALL_TIMEOUT_MS + (idle ? fix_ms : 0);
+        sys->gps_watchdog.repeat = sys->gps_stall_ms / 2000.0;
+        ev_timer_again(sys->loop, &(sys->gps_watchdog));
+    }
+    ev_set_io_collect_interval(sys->loop, idle ? (sys->power.idle_collect_ms / 1000.0) : 0.);
+    GRLOG_INFO("Power: %s, GPS fix every %u ms\n", gr_power_mode_name(mode), fix_ms);
+}
+
+/* going idle needs the car to be still for a while, anything above the
+ * active speed wakes everything up on the same sentence */
+static void gr_system_power_update(gr_sys_t *sys, float kmph, uint64_t now_ns)
+{
+    if (sys->power_mode == GR_POWER_MODE_IDLE) {
+        if (kmph > sys->power.active_above_kmph) {
+            gr_system_power_switch(sys, GR_POWER_MODE_ACTIVE, now_ns);
+        }
+        return;
+    }
+    if (kmph >= sys->power.idle_below_kmph) {
+        sys->power_still_ns = 0;
+    } else if (sys->power_still_ns == 0) {
+        sys->power_still_ns = now_ns;
+    } else if ((now_ns - sys->power_still_ns) >= (sys->power.idle_after_ms * 1000000ULL)) {
+        gr_system_power_switch(sys, GR_POWER_MODE_IDLE, now_ns);
+    }
+}
+
+/* the check watcher runs right after the loop wakes up and the prepare
+ * watcher right before it goes back to sleep */
+static void gr_system_power_check_cb(EV_P_ ev_check *w, int revents)
+{
+    (void)EV_A;
+    if (w && (revents & EV_CHECK)) {
+        gr_sys_t *sys = (gr_sys_t *)(w->data);
+        if (sys) {
+            sys->power_wake_ns = gr_monotonic_ns();
+            sys->power_stats.modes[sys->power_mode].wakeups++;
+        }
+    }
+}
+
+static void gr_system_power_prepare_cb(EV_P_ ev_prepare *w, int revents)
+{
+    (void)EV_A;
+    if (w && (revents & EV_PREPARE)) {
+        gr_sys_t *sys = (gr_sys_t *)(w->data);
+        if (sys && sys->power_wake_ns > 0) {
+            sys->power_stats.modes[sys->power_mode].busy_ns +=
+                            gr_monotonic_ns() - sys->power_wake_ns;
+            sys->power_wake_ns = 0;
+        }
+    }
+}
+
+int gr_system_set_power(gr_sys_t *sys, const gr_power_config_t *cfg)
+{
+    if (!sys || !cfg)
+        return -1;
+    if (sys->power_enabled) {
+        GRLOG_ERROR("Power saving is already set\n");
+        return -1;
+    }
+    if (cfg->active_fix_ms < 100 || cfg->idle_fix_ms > 10000 ||
+        cfg->idle_fix_ms < cfg->active_fix_ms ||
+        cfg->active_above_kmph < cfg->idle_below_kmph) {
+        GRLOG_ERROR("Invalid power saving configuration\n");
+        return -1;
+    }
+    memcpy(&(sys->power), cfg, sizeof(sys->power));
+    memset(&(sys->power_stats), 0, sizeof(sys->power_stats));
+    sys->power_enabled = true;
+    sys->power_mode = GR_POWER_MODE_ACTIVE;
+    sys->power_mode_ns = gr_monotonic_ns();
+    sys->power_still_ns = 0;
+    sys->power_wake_ns = 0;
+    sys->power_stats.modes[GR_POWER_MODE_ACTIVE].entered = 1;
+    if (sys->gps && gr_gps_set_fix_interval(sys->gps, cfg->active_fix_ms) < 0) {
+        GRLOG_WARN("Failed to set the GPS fix interval to %u ms\n", cfg->active_fix_ms);
+    }
+    ev_check_init(&(sys->power_check), gr_system_power_check_cb);
+    sys->power_check.data = (void *)sys;
+    ev_check_start(sys->loop, &(sys->power_check));
+    ev_unref(sys->loop);// long running watcher
+    ev_prepare_init(&(sys->power_prepare), gr_system_power_prepare_cb);
+    sys->power_prepare.data = (void *)sys;
+    ev_prepare_start(sys->loop, &(sys->power_prepare));
+    ev_unref(sys->loop);// long running watcher
+    GRLOG_DEBUG("Power saving after %u ms below %.1f km/h, GPS fix every %u ms when stationary\n",
+            cfg->idle_after_ms, cfg->idle_below_kmph, cfg->idle_fix_ms);
+    return 0;
+}
+
+gr_power_mode_t gr_system_get_power_mode(const gr_sys_t *sys)
+{
+    return sys ? sys->power_mode : GR_POWER_MODE_ACTIVE;
+}
+
+int gr_system_get_power_stats(const gr_sys_t *sys, gr_power_stats_t *st)
+{
+    if (!sys || !st)
+        return -1;
+    memcpy(st, &(sys->power_stats), sizeof(*st));
+    if (sys->power_enabled) {
+        st->modes[sys->power_mode].time_ns += gr_monotonic_ns() - sys->power_mode_ns;
+    }
+    return 0;
+}
+
+bool gr_system_display_due(const gr_sys_t *sys, uint64_t now_ns)
+{
+    if (!sys || !sys->power_enabled || sys->power_mode != GR_POWER_MODE_IDLE)
+        return true;
+    return (now_ns - sys->disp_last_ns) >= (sys->power.idle_display_ms * 1000000ULL);
+}
+
+static void gr_system_power_log(const gr_sys_t *sys)
+{
+    gr_power_stats_t st;
+    gr_system_get_power_stats(sys, &st);
+    for (int m = 0; m < GR_POWER_MODE_MAX; ++m) {
+        const gr_power_mode_stats_t *ms = &(st.modes[m]);
+        if (ms->time_ns == 0)
+            continue;
+        double secs = ms->time_ns / 1e9;
+        GRLOG_INFO("Power %s: %.1f s entered %u times, %.1f wakeups/s, %.2f%% busy, %" PRIu64 " fixes, %" PRIu64 " display frames\n",
+                gr_power_mode_name((gr_power_mode_t)m), secs, ms->entered,
+                ms->wakeups / secs, (100.0 * ms->busy_ns) / ms->time_ns,
+                ms->fixes, ms->display_frames);
+    }
+}
+
+/* arrival of the epoch with this UTC time, 0 if it was not seen */
+static uint64_t gr_system_gps_epoch_rx(const gr_sys_t *sys, int64_t utc_ms)
+{
+    if (utc_ms < 0)
+        return 0;
+    for (size_t i = 0; i < GR_GPS_EPOCH_RING; ++i) {
+        if (sys->epochs[i].utc_ms == utc_ms)
+            return sys->epochs[i].rx_ns;
+    }
+    return 0;
+}
+
+/* merge the parsed item into the consolidated fix and publish it to the bus
+ * once the epoch is complete, with its own position and speed */
+static void gr_system_process_item(gr_sys_t *sys, const gpsdata_data_t *item,
+                    uint64_t now_ns)
+{
+    int rc = gr_fix_update(&(sys->fix), item, now_ns);
+    /* every speed is checked for motion, not only the published ones */
+    if (sys->power_enabled && !isnan(item->speed_kmph)) {
+        gr_system_power_update(sys, item->speed_kmph, now_ns);
+    }
+    if (rc > 0) {
+        gr_bus_record_t rec;
+        /* the UTC time of the fix comes from the parsed item */
+        sys->fix.rx_ns = gr_system_gps_epoch_rx(sys, sys->fix.utc_ms);
+        if (sys->fix.rx_ns > 0 && now_ns >= sys->fix.rx_ns) {
+            gr_gps_timing_t *tm = &(sys->gps_timing);
+            tm->last_delay_ns = now_ns - sys->fix.rx_ns;
+            if (tm->last_delay_ns > tm->max_delay_ns)
+                tm->max_delay_ns = tm->last_delay_ns;
+            sys->delay_sum_ns += tm->last_delay_ns;
+            sys->delay_count++;
+            tm->avg_delay_ns = sys->delay_sum_ns / sys->delay_count;
+        }
+        if (sys->power_enabled) {
+            sys->power_stats.modes[sys->power_mode].fixes++;
+        }
+        rec.lap_events = gr_laptimer_update(sys->laptimer, &(sys->fix));
+        const gr_lap_state_t *lap = gr_laptimer_state(sys->laptimer);
+        if (rec.lap_events > 0 && (rec.lap_events & GR_LAPTIMER_EVENT_LAP)) {
+            GRLOG_INFO("Lap %u: %u.%03us, best %u.%03us\n", lap->lap,
+                    lap->last_lap_ms / 1000, lap->last_lap_ms % 1000,
+                    lap->best_lap_ms / 1000, lap->best_lap_ms % 1000);
+        }
+        memcpy(&(rec.fix), &(sys->fix), sizeof(rec.fix));
+        memcpy(&(rec.lap), lap, sizeof(rec.lap));
+        gr_bus_publish(sys->bus, &rec);
+    }
+}
+
+static void gr_system_gps_reconnect_cb(EV_P_ ev_timer *w, int revents);
+
+/* stop reading and start the reconnect backoff. the error callback is
+ * invoked for every outage */
+static void gr_system_gps_disconnect(gr_sys_t *sys, const char *reason)
+{
+    if (sys->gps_state != GR_GPS_STATE_CONNECTED) {
+        /* failed again before any data came through after a reopen */
+        if (sys->gps_state == GR_GPS_STATE_RECOVERING) {
+            uint32_t next = sys->gps_backoff_ms * 2;
+            sys->gps_backoff_ms = (next > GR_GPS_RECONNECT_MAX_MS) ? GR_GPS_RECONNECT_MAX_MS : next;
+            GRLOG_DEBUG("GPS failed again after reopening: %s\n", reason);
+            ev_io_stop(sys->loop, &(sys->gps_watcher));
+            sys->gps_state = GR_GPS_STATE_DISCONNECTED;
+            gr_gps_close_device(sys->gps);
+            ev_timer_set(&(sys->gps_reconnect_timer), sys->gps_backoff_ms / 1000.0, 0.);
+            ev_timer_start(sys->loop, &(sys->gps_reconnect_timer));
+        }
+        return;
+    }
+    GRLOG_ERROR("GPS disconnected: %s. Reconnecting\n", reason);
+    ev_io_stop(sys->loop, &(sys->gps_watcher));
+    if (sys->gps_io_error_cb) {
+        sys->gps_io_error_cb(sys, sys->gps);
+    }
+    gr_gps_close_device(sys->gps);
+    sys->gps_state = GR_GPS_STATE_DISCONNECTED;
+    sys->gps_fail_ns = gr_monotonic_ns();
+    sys->gps_gap_ns = sys->gps_last_rx_ns;
+    sys->gps_attempts = 0;
+    sys->gps_backoff_ms = GR_GPS_RECONNECT_MIN_MS;
+    sys->gps_empty_reads = 0;
+    sys->gps_stats.disconnects++;
+    ev_timer_set(&(sys->gps_reconnect_timer), 0., 0.);
+    ev_timer_start(sys->loop, &(sys->gps_reconnect_timer));
+}
+
+static void gr_system_gps_reconnect_cb(EV_P_ ev_timer *w, int revents)
+{
+    gr_sys_t *sys = (gr_sys_t *)(w->data);
+    if (!sys || !sys->gps || !(revents & EV_TIMER))
+        return;
+    sys->gps_attempts++;
+    sys->gps_stats.attempts++;
+    if (gr_gps_reopen(sys->gps) < 0) {
+        uint32_t next = sys->gps_backoff_ms * 2;
+        sys->gps_backoff_ms = (next > GR_GPS_RECONNECT_MAX_MS) ? GR_GPS_RECONNECT_MAX_MS : next;
+        GRLOG_DEBUG("GPS reconnect attempt %u failed, retrying in %u ms\n",
+                sys->gps_attempts, sys->gps_backoff_ms);
+        ev_timer_set(w, sys->gps_backoff_ms / 1000.0, 0.);
+        ev_timer_start(EV_A_ w);
+        return;
+    }
+    GRLOG_INFO("GPS device reopened after %u attempts\n", sys->gps_attempts);
+    sys->nmea_collect = false;
+    sys->gps_state = GR_GPS_STATE_RECOVERING;
+    sys->gps_last_rx_ns = gr_monotonic_ns();
+    ev_io_set(&(sys->gps_watcher), sys->gps->fd, EV_READ);
+    ev_io_start(EV_A_ &(sys->gps_watcher));
+}
+
+/* the GPS talks at least once a second, so silence means the link is gone
+ * even if read() never failed */
+static void gr_system_gps_watchdog_cb(EV_P_ ev_timer *w, int revents)
+{
+    gr_sys_t *sys = (gr_sys_t *)(w->data);
+    (void)EV_A;
+    if (!sys || !(revents & EV_TIMER))
+        return;
+    if (sys->gps_state != GR_GPS_STATE_DISCONNECTED &&
+        (gr_monotonic_ns() - sys->gps_last_rx_ns) > (sys->gps_stall_ms * 1000000ULL)) {
+        gr_system_gps_disconnect(sys, "no data received");
+    }
+}
+
+static void gr_system_gps_recovered(gr_sys_t *sys, uint64_t now_ns)
+{
+    uint32_t ms = (uint32_t)((now_ns - sys->gps_fail_ns) / 1000000ULL);
+    uint32_t gap_ms = (uint32_t)((now_ns - sys->gps_gap_ns) / 1000000ULL);
+    sys->gps_state = GR_GPS_STATE_CONNECTED;
+    sys->gps_stats.reconnects++;
+    sys->gps_stats.last_recovery_ms = ms;
+    if (ms > sys->gps_stats.max_recovery_ms)
+        sys->gps_stats.max_recovery_ms = ms;
+    sys->gps_stats.last_gap_ms = gap_ms;
+    if (gap_ms > sys->gps_stats.max_gap_ms)
+        sys->gps_stats.max_gap_ms = gap_ms;
+    GRLOG_INFO("GPS recovered after a %u ms gap in data, %u ms after the failure was detected, in %u attempts\n",
+            gap_ms, ms, sys->gps_attempts);
+}
+
 static void gr_system_gps_cb(EV_P_ ev_io *w, int revents)
 {
     if (w && (revents & EV_READ)) {
         if (w->fd >= 0) {
-            char buf[80];// GPS read buffer
+            char buf[256];// GPS read buffer, holds a collected burst when stationary
             memset(buf, 0, sizeof(buf));
             ssize_t nb = read(w->fd, buf, sizeof(buf));
             gr_sys_t *sys = (gr_sys_t *)(w->data);
             if (nb < 0) {
                 int err = errno;
+                if (err == EAGAIN || err == EWOULDBLOCK || err == EINTR)
+                    return;
                 GRLOG_ERROR("Error reading device fd: %d. Error: %s(%d)\n",
                         w->fd, strerror(err), err);
-                if (sys->gps_io_error_cb) {
-                    sys->gps_io_error_cb(sys, sys->gps);
-                }
-                ev_io_stop(EV_A_ w);
-                gpsdevice_close(w->fd);
+                gr_system_gps_disconnect(sys, strerror(err));
             } else if (nb == 0) {
                 GRLOG_DEBUG("No data received from device, waiting...\n");
+                if (++(sys->gps_empty_reads) >= GR_GPS_MAX_EMPTY_READS) {
+                    gr_system_gps_disconnect(sys, "end of file");
+                }
             } else { // nb > 0
                 gr_gps_t *gps = sys->gps;
+                sys->gps_empty_reads = 0;
+                sys->gps_last_rx_ns = gr_monotonic_ns();
+                gr_system_gps_stamp(sys, buf, (size_t)nb, sys->gps_last_rx_ns);
                 if (!gps || !gps->parser) {
                     GRLOG_ERROR("Invalid parser pointer. Closing I/O\n");
                     if (sys->gps_io_error_cb) {
                         sys->gps_io_error_cb(sys, sys->gps);
                     }
                     ev_io_stop(EV_A_ w);
-                    gpsdevice_close(w->fd);
+                    if (gps) {
+                        gr_gps_close_device(gps);
+                    }
                 } else {
                     /* parser is valid */
                     size_t onum = 0;
@@ -453,10 +1484,15 @@ static void gr_system_gps_cb(EV_P_ ev_io *w, int revents)
                         gpsdata_parser_reset(gps->parser);
                     } else {
                         GRLOG_DEBUG("Parsed %zu packets\n", onum);
-                        if (sys->gps_io_read_cb) {
-                            if (datalistp) {
-                                const gpsdata_data_t *item = NULL;
-                                LL_FOREACH(datalistp, item) {
+                        if (datalistp) {
+                            const gpsdata_data_t *item = NULL;
+                            uint64_t now_ns = gr_monotonic_ns();
+                            if (sys->gps_state == GR_GPS_STATE_RECOVERING) {
+                                gr_system_gps_recovered(sys, now_ns);
+                            }
+                            LL_FOREACH(datalistp, item) {
+                                gr_system_process_item(sys, item, now_ns);
+                                if (sys->gps_io_read_cb) {
                                     sys->gps_io_read_cb(sys, gps, sys->disp, item);
                                 }
                             }
@@ -485,6 +1521,27 @@ int gr_system_watch_gps(gr_sys_t *sys, gr_gps_t *gps,
     sys->gps_io_read_cb = read_cb;
     sys->gps_io_error_cb = err_cb;
     sys->gps_watcher.data = (void *)sys;
+    sys->gps_state = GR_GPS_STATE_CONNECTED;
+    sys->gps_last_rx_ns = gr_monotonic_ns();
+    sys->gps_stall_ms = GR_GPS_STALL_TIMEOUT_MS;
+    if (sys->power_enabled && gr_gps_set_fix_interval(gps, sys->power.active_fix_ms) < 0) {
+        GRLOG_WARN("Failed to set the GPS fix interval to %u ms\n", sys->power.active_fix_ms);
+    }
     ev_io_start(sys->loop, &(sys->gps_watcher));
+    ev_timer_init(&(sys->gps_reconnect_timer), gr_system_gps_reconnect_cb, 0., 0.);
+    sys->gps_reconnect_timer.data = (void *)sys;
+    ev_timer_init(&(sys->gps_watchdog), gr_system_gps_watchdog_cb,
+            GR_GPS_STALL_TIMEOUT_MS / 2000.0, GR_GPS_STALL_TIMEOUT_MS / 2000.0);
+    sys->gps_watchdog.data = (void *)sys;
+    ev_timer_start(sys->loop, &(sys->gps_watchdog));
+    ev_unref(sys->loop);// long running watcher
+    return 0;
+}
+
+int gr_system_get_gps_stats(const gr_sys_t *sys, gr_gps_stats_t *stats)
+{
+    if (!sys || !stats)
+        return -1;
+    memcpy(stats, &(sys->gps_stats), sizeof(*stats));
     return 0;
 }
@@ -0,0 +1,504 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for sendmmsg() */
+#endif
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef GOODRACER_HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef GOODRACER_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_MATH_H
+#include <math.h>
+#endif
+#ifdef GOODRACER_HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef GOODRACER_HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifdef GOODRACER_HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
+#ifdef GOODRACER_HAVE_NETDB_H
+#include <netdb.h>
+#endif
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_laptimer.h>
+#include <goodracer_telemetry.h>
+
+/* packets waiting to be sent. at the default rate this is a few seconds of
+ * data which is enough to ride out a wifi hiccup without growing memory.
+ */
+#define GR_TELEMETRY_QUEUE_LEN 16
+/* worst case size of a delta encoded fix: 5 varints of up to 5 bytes */
+#define GR_TELEMETRY_DELTA_MAX 25
+
+typedef struct {
+    uint8_t buf[GR_TELEMETRY_PACKET_MAX];
+    size_t len;
+    uint8_t num_fixes;
+} gr_telemetry_pkt_t;
+
+struct gr_telemetry_t_ {
+    int fd;
+    struct sockaddr_storage dest;
+    socklen_t dest_len;
+    uint32_t max_pps;
+    uint8_t batch;
+    uint32_t seq;
+    /* packet being filled */
+    gr_telemetry_pkt_t cur;
+    gr_fix_t last; /* previous fix in cur, for delta encoding */
+    /* ring of finished packets */
+    gr_telemetry_pkt_t queue[GR_TELEMETRY_QUEUE_LEN];
+    size_t q_head;
+    size_t q_count;
+    /* token bucket for the rate cap */
+    double tokens;
+    uint64_t last_flush_ns;
+    gr_telemetry_stats_t stats;
+    volatile int _ref; //reference counted
+};
+
+static inline uint8_t *gr_telemetry_put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+    return p + 2;
+}
+
+static inline uint8_t *gr_telemetry_put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+    return p + 4;
+}
+
+static inline uint16_t gr_telemetry_get_u16(const uint8_t *p)
+{
+    return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+}
+
+static inline uint32_t gr_telemetry_get_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+            ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/* zig-zag varint so small negative deltas stay small */
+static inline uint8_t *gr_telemetry_put_varint(uint8_t *p, int32_t v)
+{
+    uint32_t z = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+    while (z >= 0x80) {
+        *p++ = (uint8_t)(z | 0x80);
+        z >>= 7;
+    }
+    *p++ = (uint8_t)z;
+    return p;
+}
+
+static inline const uint8_t *gr_telemetry_get_varint(const uint8_t *p,
+                        const uint8_t *end, int32_t *v)
+{
+    uint32_t z = 0;
+    for (int shift = 0; p < end && shift < 35; shift += 7) {
+        uint8_t b = *p++;
+        z |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = (int32_t)((z >> 1) ^ (~(z & 1) + 1));
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static uint16_t gr_telemetry_speed_encode(float kmph)
+{
+    if (isnan(kmph) || kmph < 0)
+        return GR_TELEMETRY_SPEED_UNKNOWN;
+    long v = lroundf(kmph * 100.0f);
+    return (v >= GR_TELEMETRY_SPEED_UNKNOWN) ? (GR_TELEMETRY_SPEED_UNKNOWN - 1) : (uint16_t)v;
+}
+
+static float gr_telemetry_speed_decode(uint16_t v)
+{
+    return (v == GR_TELEMETRY_SPEED_UNKNOWN) ? NAN : ((float)v / 100.0f);
+}
+
+static void gr_telemetry_start_packet(gr_telemetry_t *tele, const gr_fix_t *fix,
+                            const gr_lap_state_t *lap)
+{
+    gr_telemetry_pkt_t *pkt = &(tele->cur);
+    uint8_t *p = pkt->buf;
+    p = gr_telemetry_put_u32(p, GR_TELEMETRY_MAGIC);
+    *p++ = GR_TELEMETRY_VERSION;
+    *p++ = 0; /* number of fixes, filled in on finish */
+    p = gr_telemetry_put_u16(p, 0);
+    p = gr_telemetry_put_u32(p, tele->seq++);
+    p = gr_telemetry_put_u32(p, lap ? lap->lap : 0);
+    p = gr_telemetry_put_u32(p, lap ? gr_lap_state_elapsed_ms(lap, fix->mono_ns) : 0);
+    p = gr_telemetry_put_u32(p, lap ? lap->last_lap_ms : 0);
+    p = gr_telemetry_put_u32(p, lap ? lap->best_lap_ms : 0);
+    *p++ = lap ? lap->sector : 0;
+    *p++ = lap ? lap->num_sectors : 0;
+    p = gr_telemetry_put_u16(p, 0);
+    /* first fix is absolute */
+    p = gr_telemetry_put_u32(p, (uint32_t)(fix->mono_ns / 1000000ULL));
+    p = gr_telemetry_put_u32(p, fix->seq);
+    p = gr_telemetry_put_u32(p, (uint32_t)fix->lat_e7);
+    p = gr_telemetry_put_u32(p, (uint32_t)fix->lon_e7);
+    p = gr_telemetry_put_u16(p, gr_telemetry_speed_encode(fix->speed_kmph));
+    pkt->len = (size_t)(p - pkt->buf);
+    pkt->num_fixes = 1;
+}
+
+static void gr_telemetry_append_fix(gr_telemetry_t *tele, const gr_fix_t *fix)
+{
+    gr_telemetry_pkt_t *pkt = &(tele->cur);
+    const gr_fix_t *prev = &(tele->last);
+    uint8_t *p = pkt->buf + pkt->len;
+    p = gr_telemetry_put_varint(p, (int32_t)((uint32_t)(fix->mono_ns / 1000000ULL) -
+                    (uint32_t)(prev->mono_ns / 1000000ULL)));
+    p = gr_telemetry_put_varint(p, (int32_t)(fix->seq - prev->seq));
+    p = gr_telemetry_put_varint(p, (int32_t)((uint32_t)fix->lat_e7 - (uint32_t)prev->lat_e7));
+    p = gr_telemetry_put_varint(p, (int32_t)((uint32_t)fix->lon_e7 - (uint32_t)prev->lon_e7));
+    p = gr_telemetry_put_varint(p, (int32_t)gr_telemetry_speed_encode(fix->speed_kmph) -
+                    (int32_t)gr_telemetry_speed_encode(prev->speed_kmph));
+    pkt->len = (size_t)(p - pkt->buf);
+    pkt->num_fixes++;
+}
+
+/* move the packet being filled into the send queue */
+static void gr_telemetry_finish_packet(gr_telemetry_t *tele)
+{
+    gr_telemetry_pkt_t *pkt = &(tele->cur);
+    if (pkt->num_fixes == 0)
+        return;
+    pkt->buf[5] = pkt->num_fixes;
+    if (tele->q_count == GR_TELEMETRY_QUEUE_LEN) {
+        /* the pit wants the latest data, so the oldest packet goes */
+        tele->q_head = (tele->q_head + 1) % GR_TELEMETRY_QUEUE_LEN;
+        tele->q_count--;
+        tele->stats.packets_dropped++;
+    }
+    size_t idx = (tele->q_head + tele->q_count) % GR_TELEMETRY_QUEUE_LEN;
+    memcpy(&(tele->queue[idx]), pkt, sizeof(*pkt));
+    tele->q_count++;
+    pkt->len = 0;
+    pkt->num_fixes = 0;
+}
+
+static int gr_telemetry_parse_dest(const char *dest, struct sockaddr_storage *ss,
+                        socklen_t *sslen)
+{
+    char host[256] = { 0 };
+    const char *port = NULL;
+    const char *colon = strrchr(dest, ':');
+    if (!colon || colon == dest || colon[1] == '\0') {
+        GRLOG_ERROR("Telemetry destination '%s' is not of the form host:port\n", dest);
+        return -1;
+    }
+    size_t hlen = (size_t)(colon - dest);
+    const char *hstart = dest;
+    if (dest[0] == '[' && colon[-1] == ']') {
+        hstart = dest + 1;
+        hlen -= 2;
+    }
+    if (hlen == 0 || hlen >= sizeof(host)) {
+        GRLOG_ERROR("Telemetry destination host in '%s' is invalid\n", dest);
+        return -1;
+    }
+    memcpy(host, hstart, hlen);
+    port = colon + 1;
+    struct addrinfo hints = { 0 };
+    struct addrinfo *res = NULL;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICSERV;
+    int rc = getaddrinfo(host, port, &hints, &res);
+    if (rc != 0 || !res) {
+        GRLOG_ERROR("Unable to resolve telemetry destination %s. Error: %s\n",
+                dest, gai_strerror(rc));
+        return -1;
+    }
+    memcpy(ss, res->ai_addr, res->ai_addrlen);
+    *sslen = res->ai_addrlen;
+    freeaddrinfo(res);
+    return 0;
+}
+
+gr_telemetry_t *gr_telemetry_setup(const char *dest, uint32_t max_pps, uint8_t batch)
+{
+    int rc = 0;
+    gr_telemetry_t *tele = NULL;
+    do {
+        if (!dest) {
+            GRLOG_ERROR("Telemetry destination cannot be NULL\n");
+            rc = -1;
+            break;
+        }
+        tele = GR_CALLOC(1, sizeof(*tele));
+        if (!tele) {
+            GRLOG_OUTOFMEM(sizeof(*tele));
+            rc = -1;
+            break;
+        }
+        tele->fd = -1;
+        tele->max_pps = (max_pps == 0) ? 1 : max_pps;
+        tele->batch = (batch == 0) ? 1 : batch;
+        if (tele->batch > GR_TELEMETRY_BATCH_MAX)
+            tele->batch = GR_TELEMETRY_BATCH_MAX;
+        if (gr_telemetry_parse_dest(dest, &(tele->dest), &(tele->dest_len)) < 0) {
+            rc = -1;
+            break;
+        }
+        tele->fd = socket(tele->dest.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (tele->fd < 0) {
+            int err = errno;
+            GRLOG_ERROR("Failed to create telemetry socket. Error: %s(%d)\n",
+                    strerror(err), err);
+            rc = -1;
+            break;
+        }
+        if (tele->dest.ss_family == AF_INET) {
+            const struct sockaddr_in *sin = (const struct sockaddr_in *)&(tele->dest);
+            if (IN_MULTICAST(ntohl(sin->sin_addr.s_addr))) {
+                /* keep it on the pit LAN */
+                unsigned char ttl = 1;
+                if (setsockopt(tele->fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0) {
+                    GRLOG_WARN("Unable to set multicast TTL on telemetry socket\n");
+                }
+                GRLOG_DEBUG("Telemetry destination is multicast\n");
+            }
+        } else if (tele->dest.ss_family == AF_INET6) {
+            const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)&(tele->dest);
+            if (IN6_IS_ADDR_MULTICAST(&(sin6->sin6_addr))) {
+                int hops = 1;
+                if (setsockopt(tele->fd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &hops, sizeof(hops)) < 0) {
+                    GRLOG_WARN("Unable to set multicast hops on telemetry socket\n");
+                }
+                GRLOG_DEBUG("Telemetry destination is multicast\n");
+            }
+        }
+        tele->tokens = 1.0;
+        SSD1306_ATOMIC_ZERO(&(tele->_ref));
+        SSD1306_ATOMIC_INCREMENT(&(tele->_ref));
+        GRLOG_INFO("Streaming telemetry to %s at max %u packets/s, %u fixes per packet\n",
+                dest, tele->max_pps, tele->batch);
+    } while (0);
+    if (rc < 0) {
+        if (tele && tele->fd >= 0)
+            close(tele->fd);
+        GR_FREE(tele);
+        tele = NULL;
+    }
+    return tele;
+}
+
+void gr_telemetry_inc_ref(gr_telemetry_t *tele)
+{
+    if (tele) {
+        SSD1306_ATOMIC_INCREMENT(&(tele->_ref));
+    }
+}
+
+void gr_telemetry_cleanup(gr_telemetry_t *tele)
+{
+    if (tele) {
+        int zero = 0;
+        SSD1306_ATOMIC_DECREMENT(&(tele->_ref));
+        if (SSD1306_ATOMIC_IS_EQUAL(&(tele->_ref), &zero)) {
+            GRLOG_DEBUG("Telemetry sent %" PRIu64 " packets with %" PRIu64
+                    " fixes, dropped %" PRIu64 " packets, %" PRIu64 " errors\n",
+                    tele->stats.packets_sent, tele->stats.fixes_sent,
+                    tele->stats.packets_dropped, tele->stats.send_errors);
+            if (tele->fd >= 0) {
+                close(tele->fd);
+                tele->fd = -1;
+            }
+            GR_FREE(tele);
+        }
+    }
+}
+
+double gr_telemetry_interval(const gr_telemetry_t *tele)
+{
+    return (tele && tele->max_pps > 0) ? (1.0 / (double)tele->max_pps) : 1.0;
+}
+
+int gr_telemetry_push(gr_telemetry_t *tele, const gr_fix_t *fix,
+                const gr_lap_state_t *lap)
+{
+    if (!tele || !fix)
+        return -1;
+    if (tele->cur.num_fixes == 0) {
+        gr_telemetry_start_packet(tele, fix, lap);
+    } else {
+        gr_telemetry_append_fix(tele, fix);
+    }
+    memcpy(&(tele->last), fix, sizeof(*fix));
+    if (tele->cur.num_fixes >= tele->batch ||
+        (tele->cur.len + GR_TELEMETRY_DELTA_MAX) > GR_TELEMETRY_PACKET_MAX) {
+        gr_telemetry_finish_packet(tele);
+    }
+    return 0;
+}
+
+int gr_telemetry_flush(gr_telemetry_t *tele, uint64_t now_ns)
+{
+    if (!tele || tele->fd < 0)
+        return -1;
+    /* a partial batch goes out on every flush so the latency is bounded by
+     * the flush interval */
+    gr_telemetry_finish_packet(tele);
+    if (tele->last_flush_ns > 0 && now_ns > tele->last_flush_ns) {
+        tele->tokens += ((double)(now_ns - tele->last_flush_ns) / 1e9) * tele->max_pps;
+    }
+    tele->last_flush_ns = now_ns;
+    if (tele->tokens > (double)tele->max_pps)
+        tele->tokens = (double)tele->max_pps; /* allow at most 1s of burst */
+    size_t num = tele->q_count;
+    if ((double)num > tele->tokens)
+        num = (size_t)tele->tokens;
+    if (num == 0)
+        return 0;
+    int sent = 0;
+#ifdef GOODRACER_HAVE_SENDMMSG
+    struct mmsghdr msgs[GR_TELEMETRY_QUEUE_LEN];
+    struct iovec iovs[GR_TELEMETRY_QUEUE_LEN];
+    memset(msgs, 0, sizeof(msgs));
+    for (size_t i = 0; i < num; ++i) {
+        gr_telemetry_pkt_t *pkt = &(tele->queue[(tele->q_head + i) % GR_TELEMETRY_QUEUE_LEN]);
+        iovs[i].iov_base = pkt->buf;
+        iovs[i].iov_len = pkt->len;
+        msgs[i].msg_hdr.msg_name = &(tele->dest);
+        msgs[i].msg_hdr.msg_namelen = tele->dest_len;
+        msgs[i].msg_hdr.msg_iov = &(iovs[i]);
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    sent = sendmmsg(tele->fd, msgs, (unsigned int)num, MSG_DONTWAIT);
+#else
+    for (size_t i = 0; i < num; ++i) {
+        gr_telemetry_pkt_t *pkt = &(tele->queue[(tele->q_head + i) % GR_TELEMETRY_QUEUE_LEN]);
+        if (sendto(tele->fd, pkt->buf, pkt->len, MSG_DONTWAIT,
+                (const struct sockaddr *)&(tele->dest), tele->dest_len) < 0) {
+            if (sent == 0)
+                sent = -1;
+            break;
+        }
+        sent++;
+    }
+#endif
+    if (sent < 0) {
+        int err = errno;
+        if (err == EAGAIN || err == EWOULDBLOCK || err == ENOBUFS) {
+            return 0; /* try again on the next flush */
+        }
+        /* the receiver may just not be up yet, so drop the packet that
+         * failed rather than retrying it forever */
+        GRLOG_DEBUG("Telemetry send failed. Error: %s(%d)\n", strerror(err), err);
+        tele->stats.send_errors++;
+        sent = 1;
+    } else {
+        for (int i = 0; i < sent; ++i) {
+            const gr_telemetry_pkt_t *pkt = &(tele->queue[(tele->q_head + i) % GR_TELEMETRY_QUEUE_LEN]);
+            tele->stats.packets_sent++;
+            tele->stats.fixes_sent += pkt->num_fixes;
+            tele->stats.bytes_sent += pkt->len;
+        }
+    }
+    tele->q_head = (tele->q_head + (size_t)sent) % GR_TELEMETRY_QUEUE_LEN;
+    tele->q_count -= (size_t)sent;
+    tele->tokens -= (double)sent;
+    return sent;
+}
+
+void gr_telemetry_get_stats(const gr_telemetry_t *tele, gr_telemetry_stats_t *stats)
+{
+    if (tele && stats) {
+        memcpy(stats, &(tele->stats), sizeof(*stats));
+    }
+}
+
+int gr_telemetry_decode(const uint8_t *buf, size_t len,
+                gr_telemetry_header_t *hdr, gr_fix_t *fixes, size_t max_fixes)
+{
+    if (!buf || !hdr || len < (GR_TELEMETRY_HEADER_SIZE + GR_TELEMETRY_FIX_SIZE))
+        return -1;
+    if (gr_telemetry_get_u32(buf) != GR_TELEMETRY_MAGIC)
+        return -1;
+    const uint8_t *p = buf + 4;
+    const uint8_t *end = buf + len;
+    hdr->version = *p++;
+    if (hdr->version != GR_TELEMETRY_VERSION)
+        return -1;
+    hdr->num_fixes = *p++;
+    hdr->flags = gr_telemetry_get_u16(p); p += 2;
+    hdr->seq = gr_telemetry_get_u32(p); p += 4;
+    hdr->lap = gr_telemetry_get_u32(p); p += 4;
+    hdr->lap_elapsed_ms = gr_telemetry_get_u32(p); p += 4;
+    hdr->last_lap_ms = gr_telemetry_get_u32(p); p += 4;
+    hdr->best_lap_ms = gr_telemetry_get_u32(p); p += 4;
+    hdr->sector = *p++;
+    hdr->num_sectors = *p++;
+    p += 2;
+    gr_fix_t fix;
+    gr_fix_init(&fix);
+    uint32_t ms = gr_telemetry_get_u32(p); p += 4;
+    fix.seq = gr_telemetry_get_u32(p); p += 4;
+    fix.lat_e7 = (int32_t)gr_telemetry_get_u32(p); p += 4;
+    fix.lon_e7 = (int32_t)gr_telemetry_get_u32(p); p += 4;
+    uint16_t speed = gr_telemetry_get_u16(p); p += 2;
+    fix.speed_kmph = gr_telemetry_speed_decode(speed);
+    fix.mono_ns = (uint64_t)ms * 1000000ULL;
+    size_t count = 0;
+    for (uint8_t i = 0; i < hdr->num_fixes; ++i) {
+        if (i > 0) {
+            int32_t d[5] = { 0 };
+            for (size_t j = 0; j < 5; ++j) {
+                p = gr_telemetry_get_varint(p, end, &d[j]);
+                if (!p)
+                    return -1;
+            }
+            ms += (uint32_t)d[0];
+            fix.seq += (uint32_t)d[1];
+            fix.lat_e7 = (int32_t)((uint32_t)fix.lat_e7 + (uint32_t)d[2]);
+            fix.lon_e7 = (int32_t)((uint32_t)fix.lon_e7 + (uint32_t)d[3]);
+            speed = (uint16_t)((int32_t)speed + d[4]);
+            fix.speed_kmph = gr_telemetry_speed_decode(speed);
+            fix.mono_ns = (uint64_t)ms * 1000000ULL;
+        }
+        if (fixes && count < max_fixes) {
+            memcpy(&(fixes[count]), &fix, sizeof(fix));
+            count++;
+        }
+    }
+    return (int)count;
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ *
+ * receives the telemetry stream from goodracer and prints it. meant for
+ * testing over loopback, for example:
+ *   goodracer-telemetry-recv -p 5005 &
+ *   goodracer --telemetry 127.0.0.1:5005
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_POPT
+#include <popt.h>
+#endif
+#ifdef GOODRACER_HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_SIGNAL_H
+#include <signal.h>
+#endif
+#ifdef GOODRACER_HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifdef GOODRACER_HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
+#ifdef GOODRACER_HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_laptimer.h>
+#include <goodracer_telemetry.h>
+
+static volatile sig_atomic_t gr_recv_done = 0;
+
+static void gr_recv_signal(int sig)
+{
+    (void)sig;
+    gr_recv_done = 1;
+}
+
+static struct poptOption gr_recv_args_table[] = {
+    {
+        .longName = "port",
+        .shortName = 'p',
+        .argInfo = POPT_ARG_INT,
+        .arg = NULL,
+        .val = 'p',
+        .descrip = "UDP port to listen on. Default is 5005",
+        .argDescrip = "5005"
+    },
+    {
+        .longName = "group",
+        .shortName = 'g',
+        .argInfo = POPT_ARG_STRING,
+        .arg = NULL,
+        .val = 'g',
+        .descrip = "IPv4 multicast group to join",
+        .argDescrip = "239.0.0.1"
+    },
+    {
+        .longName = "quiet",
+        .shortName = 'q',
+        .argInfo = POPT_ARG_NONE,
+        .arg = NULL,
+        .val = 'q',
+        .descrip = "Print only the packet summary and not every fix",
+        .argDescrip = NULL
+    },
+    POPT_AUTOHELP
+    POPT_TABLEEND
+};
+
+int main(int argc, const char **argv)
+{
+    int rc = 0, opt = 0, fd = -1;
+    uint16_t port = 5005;
+    char group[64] = { 0 };
+    bool quiet = false;
+    uint64_t packets = 0, fixes = 0, lost = 0;
+    uint32_t next_seq = 0;
+
+    poptContext ctx = poptGetContext(argv[0], argc, argv, gr_recv_args_table, 0);
+    if (!ctx) {
+        GRLOG_ERROR("poptGetContext() error\n");
+        return -1;
+    }
+    while ((opt = poptGetNextOpt(ctx)) >= 0) {
+        char *argbuf = NULL;
+        switch (opt) {
+        case 'p':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                port = (uint16_t)strtoul(argbuf, NULL, 10);
+            }
+            break;
+        case 'g':
+            argbuf = poptGetOptArg(ctx);
+            if (argbuf) {
+                snprintf(group, sizeof(group), "%s", argbuf);
+            }
+            break;
+        case 'q':
+            quiet = true;
+            break;
+        default:
+            break;
+        }
+        GR_FREE(argbuf);
+    }
+    if (opt < -1) {
+        GRLOG_ERROR("%s %s: %s\n", argv[0], poptBadOption(ctx, POPT_BADOPTION_NOALIAS), poptStrerror(opt));
+        poptPrintHelp(ctx, stdout, 0);
+        poptFreeContext(ctx);
+        return -1;
+    }
+    poptFreeContext(ctx);
+    /* without SA_RESTART, which signal() sets on glibc, so the blocking
+     * recv() returns EINTR and the loop sees gr_recv_done */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = gr_recv_signal;
+    sigemptyset(&(sa.sa_mask));
+    sa.sa_flags = 0;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    do {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            GRLOG_ERROR("Failed to create socket. Error: %s\n", strerror(errno));
+            rc = -1;
+            break;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in sin = { 0 };
+        sin.sin_family = AF_INET;
+        sin.sin_port = htons(port);
+        sin.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(fd, (const struct sockaddr *)&sin, sizeof(sin)) < 0) {
+            GRLOG_ERROR("Failed to bind to port %u. Error: %s\n", port, strerror(errno));
+            rc = -1;
+            break;
+        }
+        if (group[0] != '\0') {
+            struct ip_mreq mreq = { 0 };
+            if (inet_pton(AF_INET, group, &(mreq.imr_multiaddr)) != 1) {
+                GRLOG_ERROR("Invalid multicast group %s\n", group);
+                rc = -1;
+                break;
+            }
+            mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+            if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+                GRLOG_ERROR("Failed to join multicast group %s. Error: %s\n", group, strerror(errno));
+                rc = -1;
+                break;
+            }
+        }
+        GRLOG_INFO("Listening for telemetry on port %u\n", port);
+        while (!gr_recv_done) {
+            uint8_t buf[GR_TELEMETRY_PACKET_MAX];
+            gr_fix_t items[GR_TELEMETRY_BATCH_MAX];
+            gr_telemetry_header_t hdr = { 0 };
+            ssize_t nb = recv(fd, buf, sizeof(buf), 0);
+            if (nb < 0) {
+                if (errno == EINTR)
+                    continue;
+                GRLOG_ERROR("Failed to receive. Error: %s\n", strerror(errno));
+                rc = -1;
+                break;
+            }
+            int n = gr_telemetry_decode(buf, (size_t)nb, &hdr, items, GR_TELEMETRY_BATCH_MAX);
+            if (n < 0) {
+                GRLOG_WARN("Ignoring malformed packet of %zd bytes\n", nb);
+                continue;
+            }
+            if (packets > 0 && hdr.seq != next_seq) {
+                lost += (uint32_t)(hdr.seq - next_seq);
+            }
+            next_seq = hdr.seq + 1;
+            packets++;
+            fixes += (uint64_t)n;
+            printf("pkt %u fixes %d lap %u sector %u/%u elapsed %u.%03us last %u.%03us best %u.%03us\n",
+                    hdr.seq, n, hdr.lap, hdr.sector + 1, hdr.num_sectors,
+                    hdr.lap_elapsed_ms / 1000, hdr.lap_elapsed_ms % 1000,
+                    hdr.last_lap_ms / 1000, hdr.last_lap_ms % 1000,
+                    hdr.best_lap_ms / 1000, hdr.best_lap_ms % 1000);
+            if (!quiet) {
+                for (int i = 0; i < n; ++i) {
+                    printf("  fix %u t=%" PRIu64 "ms %0.7f,%0.7f %0.2f kmph\n",
+                            items[i].seq, (uint64_t)(items[i].mono_ns / 1000000ULL),
+                            GR_FIX_E7_TO_DEG(items[i].lat_e7),
+                            GR_FIX_E7_TO_DEG(items[i].lon_e7),
+                            isnan(items[i].speed_kmph) ? 0.0 : items[i].speed_kmph);
+                }
+            }
+            fflush(stdout);
+        }
+    } while (0);
+    if (fd >= 0)
+        close(fd);
+    GRLOG_INFO("Received %" PRIu64 " packets with %" PRIu64 " fixes, %" PRIu64 " packets lost\n",
+            packets, fixes, lost);
+    return rc;
+}
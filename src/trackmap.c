@@ -0,0 +1,336 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef GOODRACER_HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_MATH_H
+#include <math.h>
+#endif
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_fixlog.h>
+#include <goodracer_trackmap.h>
+
+/* meters per degree of latitude, and of longitude at the equator */
+#define GR_TRACKMAP_M_PER_DEG_LAT 110540.0
+#define GR_TRACKMAP_M_PER_DEG_LON 111320.0
+#define GR_TRACKMAP_MIN_SPACING_M 2.0
+/* simplification tolerance as a fraction of the larger track dimension,
+ * which is about half a pixel on a 128 pixel wide display */
+#define GR_TRACKMAP_TOLERANCE (1.0 / 256.0)
+#define GR_TRACKMAP_MARGIN 1
+
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+} gr_trackmap_span_t;
+
+struct gr_trackmap_t_ {
+    size_t max_points;
+    size_t num_points;
+    int32_t *lat_e7;
+    int32_t *lon_e7;
+    /* built outline in meters around the center */
+    float *x;
+    float *y;
+    uint8_t *keep;
+    gr_trackmap_span_t *stack;
+    size_t num_outline;
+    bool built;
+    double lat0;
+    double lon0;
+    double coslat;
+    float xmin, xmax, ymin, ymax;
+};
+
+gr_trackmap_t *gr_trackmap_create(size_t max_points)
+{
+    int rc = 0;
+    gr_trackmap_t *map = NULL;
+    do {
+        if (max_points < 3) {
+            GRLOG_ERROR("Track map needs at least 3 points\n");
+            rc = -1;
+            break;
+        }
+        map = GR_CALLOC(1, sizeof(*map));
+        if (!map) {
+            GRLOG_OUTOFMEM(sizeof(*map));
+            rc = -1;
+            break;
+        }
+        map->max_points = max_points;
+        map->lat_e7 = GR_CALLOC(max_points, sizeof(int32_t));
+        map->lon_e7 = GR_CALLOC(max_points, sizeof(int32_t));
+        map->x = GR_CALLOC(max_points, sizeof(float));
+        map->y = GR_CALLOC(max_points, sizeof(float));
+        map->keep = GR_CALLOC(max_points, sizeof(uint8_t));
+        map->stack = GR_CALLOC(max_points, sizeof(gr_trackmap_span_t));
+        if (!map->lat_e7 || !map->lon_e7 || !map->x || !map->y ||
+            !map->keep || !map->stack) {
+            GRLOG_OUTOFMEM(max_points * (4 * sizeof(int32_t) + 1 + sizeof(gr_trackmap_span_t)));
+            rc = -1;
+            break;
+        }
+    } while (0);
+    if (rc < 0) {
+        gr_trackmap_free(map);
+        map = NULL;
+    }
+    return map;
+}
+
+void gr_trackmap_free(gr_trackmap_t *map)
+{
+    if (map) {
+        GR_FREE(map->lat_e7);
+        GR_FREE(map->lon_e7);
+        GR_FREE(map->x);
+        GR_FREE(map->y);
+        GR_FREE(map->keep);
+        GR_FREE(map->stack);
+        GR_FREE(map);
+    }
+}
+
+int gr_trackmap_add_point(gr_trackmap_t *map, int32_t lat_e7, int32_t lon_e7)
+{
+    if (!map || map->built || map->num_points >= map->max_points)
+        return -1;
+    if (map->num_points > 0) {
+        size_t last = map->num_points - 1;
+        double dy = (double)(lat_e7 - map->lat_e7[last]) * 1e-7 * GR_TRACKMAP_M_PER_DEG_LAT;
+        double dx = (double)(lon_e7 - map->lon_e7[last]) * 1e-7 * GR_TRACKMAP_M_PER_DEG_LON *
+                    cos(GR_FIX_E7_TO_DEG(lat_e7) * M_PI / 180.0);
+        if ((dx * dx + dy * dy) < (GR_TRACKMAP_MIN_SPACING_M * GR_TRACKMAP_MIN_SPACING_M))
+            return 0;
+    }
+    map->lat_e7[map->num_points] = lat_e7;
+    map->lon_e7[map->num_points] = lon_e7;
+    map->num_points++;
+    return 0;
+}
+
+size_t gr_trackmap_num_points(const gr_trackmap_t *map)
+{
+    return map ? map->num_points : 0;
+}
+
+static void gr_trackmap_project(const gr_trackmap_t *map, int32_t lat_e7,
+                int32_t lon_e7, float *x, float *y)
+{
+    *x = (float)((GR_FIX_E7_TO_DEG(lon_e7) - map->lon0) * map->coslat * GR_TRACKMAP_M_PER_DEG_LON);
+    *y = (float)((GR_FIX_E7_TO_DEG(lat_e7) - map->lat0) * GR_TRACKMAP_M_PER_DEG_LAT);
+}
+
+/* distance of p from the line through a and b */
+static float gr_trackmap_line_dist(float px, float py, float ax, float ay,
+                float bx, float by)
+{
+    float dx = bx - ax, dy = by - ay;
+    float len = sqrtf(dx * dx + dy * dy);
+    if (len <= 0.0f)
+        return sqrtf((px - ax) * (px - ax) + (py - ay) * (py - ay));
+    return fabsf(dy * px - dx * py + bx * ay - by * ax) / len;
+}
+
+int gr_trackmap_build(gr_trackmap_t *map)
+{
+    if (!map)
+        return -1;
+    if (map->num_points < 3) {
+        GRLOG_ERROR("Track map has only %zu points, cannot build\n", map->num_points);
+        return -1;
+    }
+    int32_t latmin = INT32_MAX, latmax = INT32_MIN, lonmin = INT32_MAX, lonmax = INT32_MIN;
+    for (size_t i = 0; i < map->num_points; ++i) {
+        if (map->lat_e7[i] < latmin) latmin = map->lat_e7[i];
+        if (map->lat_e7[i] > latmax) latmax = map->lat_e7[i];
+        if (map->lon_e7[i] < lonmin) lonmin = map->lon_e7[i];
+        if (map->lon_e7[i] > lonmax) lonmax = map->lon_e7[i];
+    }
+    map->lat0 = (GR_FIX_E7_TO_DEG(latmin) + GR_FIX_E7_TO_DEG(latmax)) / 2.0;
+    map->lon0 = (GR_FIX_E7_TO_DEG(lonmin) + GR_FIX_E7_TO_DEG(lonmax)) / 2.0;
+    map->coslat = cos(map->lat0 * M_PI / 180.0);
+    for (size_t i = 0; i < map->num_points; ++i) {
+        gr_trackmap_project(map, map->lat_e7[i], map->lon_e7[i], &(map->x[i]), &(map->y[i]));
+        map->keep[i] = 0;
+    }
+    float xmin = INFINITY, xmax = -INFINITY, ymin = INFINITY, ymax = -INFINITY;
+    for (size_t i = 0; i < map->num_points; ++i) {
+        xmin = fminf(xmin, map->x[i]); xmax = fmaxf(xmax, map->x[i]);
+        ymin = fminf(ymin, map->y[i]); ymax = fmaxf(ymax, map->y[i]);
+    }
+    map->xmin = xmin; map->xmax = xmax; map->ymin = ymin; map->ymax = ymax;
+    float tol = fmaxf(xmax - xmin, ymax - ymin) * (float)GR_TRACKMAP_TOLERANCE;
+    /* Douglas-Peucker without recursion, the spans waiting to be split are
+     * on the stack and there are never more of them than points */
+    size_t top = 0;
+    map->keep[0] = 1;
+    map->keep[map->num_points - 1] = 1;
+    map->stack[top++] = (gr_trackmap_span_t){ 0, (uint32_t)(map->num_points - 1) };
+    while (top > 0) {
+        gr_trackmap_span_t sp = map->stack[--top];
+        float dmax = 0.0f;
+        uint32_t imax = sp.first;
+        for (uint32_t i = sp.first + 1; i < sp.last; ++i) {
+            float d = gr_trackmap_line_dist(map->x[i], map->y[i], map->x[sp.first],
+                        map->y[sp.first], map->x[sp.last], map->y[sp.last]);
+            if (d > dmax) {
+                dmax = d;
+                imax = i;
+            }
+        }
+        if (dmax > tol && top + 2 <= map->max_points) {
+            map->keep[imax] = 1;
+            map->stack[top++] = (gr_trackmap_span_t){ sp.first, imax };
+            map->stack[top++] = (gr_trackmap_span_t){ imax, sp.last };
+        }
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < map->num_points; ++i) {
+        if (map->keep[i]) {
+            map->x[n] = map->x[i];
+            map->y[n] = map->y[i];
+            n++;
+        }
+    }
+    map->num_outline = n;
+    map->built = true;
+    GRLOG_INFO("Track map built from %zu points down to %zu, %0.0fm x %0.0fm\n",
+            map->num_points, n, xmax - xmin, ymax - ymin);
+    return 0;
+}
+
+bool gr_trackmap_is_built(const gr_trackmap_t *map)
+{
+    return map ? map->built : false;
+}
+
+int gr_trackmap_load(gr_trackmap_t *map, const char *path)
+{
+    gr_fix_t *fixes = NULL;
+    size_t num = 0;
+    if (!map || !path)
+        return -1;
+    if (gr_fixlog_read_all(path, &fixes, &num) < 0) {
+        GRLOG_ERROR("Failed to read the track from %s\n", path);
+        return -1;
+    }
+    for (size_t i = 0; i < num; ++i) {
+        if (gr_trackmap_add_point(map, fixes[i].lat_e7, fixes[i].lon_e7) < 0)
+            break;
+    }
+    GR_FREE(fixes);
+    return gr_trackmap_build(map);
+}
+
+typedef struct {
+    float scale;
+    float ox;
+    float oy;
+    int height;
+} gr_trackmap_xform_t;
+
+static int gr_trackmap_xform(const gr_trackmap_t *map, uint8_t width,
+                uint8_t height, gr_trackmap_xform_t *xf)
+{
+    if (!map || !map->built || width <= 2 * GR_TRACKMAP_MARGIN ||
+        height <= 2 * GR_TRACKMAP_MARGIN)
+        return -1;
+    float aw = (float)(width - 1 - 2 * GR_TRACKMAP_MARGIN);
+    float ah = (float)(height - 1 - 2 * GR_TRACKMAP_MARGIN);
+    float xr = fmaxf(map->xmax - map->xmin, 1.0f);
+    float yr = fmaxf(map->ymax - map->ymin, 1.0f);
+    xf->scale = fminf(aw / xr, ah / yr);
+    /* centered in the bitmap, north up */
+    xf->ox = GR_TRACKMAP_MARGIN + (aw - xr * xf->scale) / 2.0f;
+    xf->oy = GR_TRACKMAP_MARGIN + (ah - yr * xf->scale) / 2.0f;
+    xf->height = height;
+    return 0;
+}
+
+static void gr_trackmap_xform_point(const gr_trackmap_t *map,
+                const gr_trackmap_xform_t *xf, float x, float y, int *px, int *py)
+{
+    *px = (int)lroundf(xf->ox + (x - map->xmin) * xf->scale);
+    *py = (xf->height - 1) - (int)lroundf(xf->oy + (y - map->ymin) * xf->scale);
+}
+
+static void gr_trackmap_set(uint8_t *bitmap, uint8_t width, uint8_t height,
+                int x, int y)
+{
+    if (x >= 0 && y >= 0 && x < width && y < height) {
+        bitmap[(size_t)y * ((width + 7) / 8) + (x / 8)] |= (uint8_t)(0x80 >> (x % 8));
+    }
+}
+
+int gr_trackmap_rasterize(const gr_trackmap_t *map, uint8_t width,
+                uint8_t height, uint8_t *bitmap, size_t len)
+{
+    gr_trackmap_xform_t xf;
+    if (!bitmap || len < GR_TRACKMAP_BITMAP_SIZE(width, height))
+        return -1;
+    if (gr_trackmap_xform(map, width, height, &xf) < 0)
+        return -1;
+    memset(bitmap, 0, GR_TRACKMAP_BITMAP_SIZE(width, height));
+    int x0, y0, x1, y1;
+    gr_trackmap_xform_point(map, &xf, map->x[0], map->y[0], &x0, &y0);
+    gr_trackmap_set(bitmap, width, height, x0, y0);
+    for (size_t i = 1; i < map->num_outline; ++i) {
+        gr_trackmap_xform_point(map, &xf, map->x[i], map->y[i], &x1, &y1);
+        /* Bresenham */
+        int dx = abs(x1 - x0), sx = (x0 < x1) ? 1 : -1;
+        int dy = -abs(y1 - y0), sy = (y0 < y1) ? 1 : -1;
+        int err = dx + dy;
+        int x = x0, y = y0;
+        for (;;) {
+            gr_trackmap_set(bitmap, width, height, x, y);
+            if (x == x1 && y == y1)
+                break;
+            int e2 = 2 * err;
+            if (e2 >= dy) {
+                err += dy;
+                x += sx;
+            }
+            if (e2 <= dx) {
+                err += dx;
+                y += sy;
+            }
+        }
+        x0 = x1;
+        y0 = y1;
+    }
+    return 0;
+}
+
+int gr_trackmap_locate(const gr_trackmap_t *map, uint8_t width, uint8_t height,
+                int32_t lat_e7, int32_t lon_e7, int *x, int *y)
+{
+    gr_trackmap_xform_t xf;
+    float mx, my;
+    if (!x || !y || gr_trackmap_xform(map, width, height, &xf) < 0)
+        return -1;
+    gr_trackmap_project(map, lat_e7, lon_e7, &mx, &my);
+    gr_trackmap_xform_point(map, &xf, mx, my, x, y);
+    /* off the map, e.g. in the pits, pins to the edge */
+    *x = (*x < 0) ? 0 : ((*x >= width) ? width - 1 : *x);
+    *y = (*y < 0) ? 0 : ((*y >= height) ? height - 1 : *y);
+    return 0;
+}
@@ -0,0 +1,585 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_MATH_H
+#include <math.h>
+#endif
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_laptimer.h>
+#include <goodracer_trackmap.h>
+#include <goodracer_ui.h>
+
+typedef enum {
+    GR_UI_WIDGET_TEXT = 0,
+    GR_UI_WIDGET_BAR,
+    GR_UI_WIDGET_MAP
+} gr_ui_widget_type_t;
+
+#define GR_UI_DOT_RADIUS 1
+
+typedef struct {
+    gr_ui_widget_type_t type;
+    gr_ui_value_t value;
+    gr_ui_rect_t rect;
+    uint8_t fontsize;
+    float max;
+    /* what is on the framebuffer right now */
+    bool drawn;
+    char text[GR_UI_MAX_TEXT];
+    gr_ui_rect_t box; /* the rect and wherever the text went past it */
+    int fill;
+    /* map background and car dot */
+    uint8_t *bitmap;
+    bool cached;
+    int dot_x;
+    int dot_y;
+} gr_ui_widget_t;
+
+typedef struct {
+    char name[16];
+    gr_ui_widget_t widgets[GR_UI_MAX_WIDGETS];
+    size_t num_widgets;
+} gr_ui_screen_t;
+
+struct gr_ui_t_ {
+    ssd1306_framebuffer_t *fbp;
+    ssd1306_graphics_options_t opts;
+    bool custom_font;
+    gr_ui_screen_t screens[GR_UI_MAX_SCREENS];
+    size_t num_screens;
+    size_t current;
+    bool clear; /* screen was switched, wipe before drawing */
+    const gr_trackmap_t *map;
+    uint32_t dirty_pages;
+    gr_ui_stats_t stats;
+};
+
+gr_ui_t *gr_ui_create(ssd1306_framebuffer_t *fbp, const char *font_file)
+{
+    if (!fbp) {
+        GRLOG_ERROR("Framebuffer cannot be NULL for the UI\n");
+        return NULL;
+    }
+    gr_ui_t *ui = GR_CALLOC(1, sizeof(*ui));
+    if (!ui) {
+        GRLOG_OUTOFMEM(sizeof(*ui));
+        return NULL;
+    }
+    ui->fbp = fbp;
+    if (font_file) {
+        ui->opts.type = SSD1306_OPT_FONT_FILE;
+        ui->opts.value.font_file = font_file;
+        ui->custom_font = true;
+    }
+    ui->clear = true;
+    return ui;
+}
+
+void gr_ui_free(gr_ui_t *ui)
+{
+    if (ui) {
+        for (size_t i = 0; i < ui->num_screens; ++i) {
+            for (size_t j = 0; j < ui->screens[i].num_widgets; ++j) {
+                GR_FREE(ui->screens[i].widgets[j].bitmap);
+            }
+        }
+        GRLOG_DEBUG("UI drew %" PRIu64 " widgets and skipped %" PRIu64 " in %" PRIu64 " frames taking %" PRIu64 " us\n",
+                ui->stats.widgets_drawn, ui->stats.widgets_skipped,
+                ui->stats.frames, ui->stats.render_ns / 1000);
+        GR_FREE(ui);
+    }
+}
+
+int gr_ui_add_screen(gr_ui_t *ui, const char *name)
+{
+    if (!ui)
+        return -1;
+    if (ui->num_screens >= GR_UI_MAX_SCREENS) {
+        GRLOG_ERROR("Only %d screens are supported\n", GR_UI_MAX_SCREENS);
+        return -1;
+    }
+    gr_ui_screen_t *scr = &(ui->screens[ui->num_screens]);
+    memset(scr, 0, sizeof(*scr));
+    snprintf(scr->name, sizeof(scr->name), "%s", name ? name : "");
+    return (int)(ui->num_screens++);
+}
+
+static gr_ui_widget_t *gr_ui_new_widget(gr_ui_t *ui, int screen, gr_ui_rect_t rect)
+{
+    if (!ui || screen < 0 || (size_t)screen >= ui->num_screens)
+        return NULL;
+    if ((rect.x + rect.w) > ui->fbp->width || (rect.y + rect.h) > ui->fbp->height ||
+        rect.w == 0 || rect.h == 0) {
+        GRLOG_ERROR("Widget region %ux%u+%u+%u is outside the %ux%u display\n",
+                rect.w, rect.h, rect.x, rect.y, ui->fbp->width, ui->fbp->height);
+        return NULL;
+    }
+    gr_ui_screen_t *scr = &(ui->screens[screen]);
+    if (scr->num_widgets >= GR_UI_MAX_WIDGETS) {
+        GRLOG_ERROR("Only %d widgets per screen are supported\n", GR_UI_MAX_WIDGETS);
+        return NULL;
+    }
+    gr_ui_widget_t *wid = &(scr->widgets[scr->num_widgets++]);
+    memset(wid, 0, sizeof(*wid));
+    wid->rect = rect;
+    wid->fill = -1;
+    return wid;
+}
+
+int gr_ui_add_text(gr_ui_t *ui, int screen, gr_ui_value_t value,
+                gr_ui_rect_t rect, uint8_t fontsize)
+{
+    gr_ui_widget_t *wid = gr_ui_new_widget(ui, screen, rect);
+    if (!wid)
+        return -1;
+    wid->type = GR_UI_WIDGET_TEXT;
+    wid->value = value;
+    wid->fontsize = fontsize;
+    return 0;
+}
+
+int gr_ui_add_bar(gr_ui_t *ui, int screen, gr_ui_value_t value,
+                gr_ui_rect_t rect, float max)
+{
+    if (!(max > 0)) {
+        GRLOG_ERROR("Bar maximum has to be positive\n");
+        return -1;
+    }
+    gr_ui_widget_t *wid = gr_ui_new_widget(ui, screen, rect);
+    if (!wid)
+        return -1;
+    wid->type = GR_UI_WIDGET_BAR;
+    wid->value = value;
+    wid->max = max;
+    return 0;
+}
+
+int gr_ui_add_map(gr_ui_t *ui, int screen, gr_ui_rect_t rect)
+{
+    gr_ui_widget_t *wid = gr_ui_new_widget(ui, screen, rect);
+    if (!wid)
+        return -1;
+    wid->type = GR_UI_WIDGET_MAP;
+    wid->dot_x = wid->dot_y = -1;
+    /* allocated now so that building the map later does not allocate */
+    wid->bitmap = GR_CALLOC(1, GR_TRACKMAP_BITMAP_SIZE(rect.w, rect.h));
+    if (!wid->bitmap) {
+        GRLOG_OUTOFMEM(GR_TRACKMAP_BITMAP_SIZE(rect.w, rect.h));
+        ui->screens[screen].num_widgets--;
+        return -1;
+    }
+    return 0;
+}
+
+void gr_ui_set_trackmap(gr_ui_t *ui, const gr_trackmap_t *map)
+{
+    if (ui) {
+        ui->map = map;
+        for (size_t i = 0; i < ui->num_screens; ++i) {
+            for (size_t j = 0; j < ui->screens[i].num_widgets; ++j) {
+                ui->screens[i].widgets[j].cached = false;
+            }
+        }
+    }
+}
+
+int gr_ui_add_default_screens(gr_ui_t *ui)
+{
+    if (!ui)
+        return -1;
+    uint8_t w = ui->fbp->width;
+    uint8_t h = ui->fbp->height;
+    uint8_t row = h / 3;
+    int rc = 0;
+    /* the original layout: latitude, longitude and speed */
+    int scr = gr_ui_add_screen(ui, "position");
+    rc |= gr_ui_add_text(ui, scr, GR_UI_VALUE_LATITUDE, (gr_ui_rect_t){ 0, 0, w, row }, 3);
+    rc |= gr_ui_add_text(ui, scr, GR_UI_VALUE_LONGITUDE, (gr_ui_rect_t){ 0, row, w, row }, 3);
+    rc |= gr_ui_add_text(ui, scr, GR_UI_VALUE_SPEED, (gr_ui_rect_t){ 0, 2 * row, w, h - 2 * row }, 3);
+    /* running lap time up top, lap number and delta below, speed bar last */
+    scr = gr_ui_add_screen(ui, "lap");
+    rc |= gr_ui_add_text(ui, scr, GR_UI_VALUE_LAP_TIME, (gr_ui_rect_t){ 0, 0, w, h / 2 }, 4);
+    rc |= gr_ui_add_text(ui, scr, GR_UI_VALUE_LAP_NUMBER, (gr_ui_rect_t){ 0, h / 2, w / 4, row }, 3);
+    rc |= gr_ui_add_text(ui, scr, GR_UI_VALUE_DELTA, (gr_ui_rect_t){ w / 4, h / 2, w - w / 4, row }, 3);
+    rc |= gr_ui_add_bar(ui, scr, GR_UI_VALUE_SPEED, (gr_ui_rect_t){ 0, h / 2 + row, w, h - (h / 2 + row) }, 250.0f);
+    scr = gr_ui_add_screen(ui, "laps");
+    rc |= gr_ui_add_text(ui, scr, GR_UI_VALUE_LAST_LAP, (gr_ui_rect_t){ 0, 0, w, row }, 3);
+    rc |= gr_ui_add_text(ui, scr, GR_UI_VALUE_BEST_LAP, (gr_ui_rect_t){ 0, row, w, row }, 3);
+    rc |= gr_ui_add_text(ui, scr, GR_UI_VALUE_SPEED, (gr_ui_rect_t){ 0, 2 * row, w, h - 2 * row }, 3);
+    /* map on the left, lap time and speed on the right */
+    scr = gr_ui_add_screen(ui, "map");
+    rc |= gr_ui_add_map(ui, scr, (gr_ui_rect_t){ 0, 0, w / 2, h });
+    rc |= gr_ui_add_text(ui, scr, GR_UI_VALUE_LAP_TIME, (gr_ui_rect_t){ w / 2, 0, w - w / 2, h / 2 }, 3);
+    rc |= gr_ui_add_text(ui, scr, GR_UI_VALUE_SPEED, (gr_ui_rect_t){ w / 2, h / 2, w - w / 2, h - h / 2 }, 3);
+    return (rc < 0 || scr < 0) ? -1 : 0;
+}
+
+size_t gr_ui_num_screens(const gr_ui_t *ui)
+{
+    return ui ? ui->num_screens : 0;
+}
+
+int gr_ui_current_screen(const gr_ui_t *ui)
+{
+    return (ui && ui->num_screens > 0) ? (int)ui->current : -1;
+}
+
+int gr_ui_set_screen(gr_ui_t *ui, int screen)
+{
+    if (!ui || screen < 0 || (size_t)screen >= ui->num_screens)
+        return -1;
+    if ((size_t)screen != ui->current) {
+        ui->current = (size_t)screen;
+        ui->clear = true;
+        GRLOG_INFO("Switched to screen %s\n", ui->screens[screen].name);
+    }
+    return 0;
+}
+
+int gr_ui_next_screen(gr_ui_t *ui)
+{
+    if (!ui || ui->num_screens == 0)
+        return -1;
+    return gr_ui_set_screen(ui, (int)((ui->current + 1) % ui->num_screens));
+}
+
+static void gr_ui_format_latlon(char *buf, size_t sz, int32_t e7, char pos, char neg)
+{
+    double deg = fabs(GR_FIX_E7_TO_DEG(e7));
+    int d = (int)deg;
+    snprintf(buf, sz, "%d\xb0%0.04f'%c", d, (deg - d) * 60.0, (e7 < 0) ? neg : pos);
+}
+
+static void gr_ui_format_ms(char *buf, size_t sz, uint32_t ms, bool tenths)
+{
+    if (tenths) {
+        snprintf(buf, sz, "%u:%02u.%u", ms / 60000, (ms / 1000) % 60, (ms % 1000) / 100);
+    } else {
+        snprintf(buf, sz, "%u:%02u.%02u", ms / 60000, (ms / 1000) % 60, (ms % 1000) / 10);
+    }
+}
+
+/* formats the value as text and returns it as a number for the bars */
+static double gr_ui_format(gr_ui_value_t value, const gr_fix_t *fix,
+                const gr_lap_state_t *lap, uint64_t now_ns, char *buf, size_t sz)
+{
+    double num = 0.0;
+    bool has_pos = (fix && GR_FIX_HAS_POSITION(fix));
+    switch (value) {
+    case GR_UI_VALUE_LATITUDE:
+        if (has_pos)
+            gr_ui_format_latlon(buf, sz, fix->lat_e7, 'N', 'S');
+        else
+            snprintf(buf, sz, "--\xb0--.----'-");
+        break;
+    case GR_UI_VALUE_LONGITUDE:
+        if (has_pos)
+            gr_ui_format_latlon(buf, sz, fix->lon_e7, 'E', 'W');
+        else
+            snprintf(buf, sz, "---\xb0--.----'-");
+        break;
+    case GR_UI_VALUE_SPEED:
+        if (fix && !isnan(fix->speed_kmph)) {
+            num = fix->speed_kmph;
+            snprintf(buf, sz, "%0.1f kmph", num);
+        } else {
+            snprintf(buf, sz, "--.- kmph");
+        }
+        break;
+    case GR_UI_VALUE_LAP_TIME:
+        if (lap && lap->started) {
+            uint32_t ms = gr_lap_state_elapsed_ms(lap, now_ns);
+            num = ms / 1000.0;
+            gr_ui_format_ms(buf, sz, ms, true);
+        } else {
+            snprintf(buf, sz, "-:--.-");
+        }
+        break;
+    case GR_UI_VALUE_LAST_LAP:
+    case GR_UI_VALUE_BEST_LAP: {
+        uint32_t ms = lap ? ((value == GR_UI_VALUE_LAST_LAP) ?
+                            lap->last_lap_ms : lap->best_lap_ms) : 0;
+        const char *label = (value == GR_UI_VALUE_LAST_LAP) ? "L" : "B";
+        if (ms > 0) {
+            char tbuf[16];
+            gr_ui_format_ms(tbuf, sizeof(tbuf), ms, false);
+            num = ms / 1000.0;
+            snprintf(buf, sz, "%s %s", label, tbuf);
+        } else {
+            snprintf(buf, sz, "%s -:--.--", label);
+        }
+        } break;
+    case GR_UI_VALUE_DELTA:
+        if (lap && lap->last_lap_ms > 0 && lap->best_lap_ms > 0) {
+            int64_t d = (int64_t)lap->last_lap_ms - (int64_t)lap->best_lap_ms;
+            uint64_t ad = (d < 0) ? (uint64_t)(-d) : (uint64_t)d;
+            num = d / 1000.0;
+            snprintf(buf, sz, "%c%" PRIu64 ".%02" PRIu64, (d < 0) ? '-' : '+',
+                    ad / 1000, (ad % 1000) / 10);
+        } else {
+            snprintf(buf, sz, "+-.--");
+        }
+        break;
+    case GR_UI_VALUE_LAP_NUMBER:
+        num = lap ? lap->lap : 0;
+        snprintf(buf, sz, "L%u", lap ? (lap->lap + (lap->started ? 1 : 0)) : 0);
+        break;
+    default:
+        buf[0] = '\0';
+        break;
+    }
+    return num;
+}
+
+static void gr_ui_fill_rect(gr_ui_t *ui, uint8_t x, uint8_t y, uint8_t w,
+                uint8_t h, bool on)
+{
+    for (uint8_t j = y; j < (uint8_t)(y + h); ++j) {
+        for (uint8_t i = x; i < (uint8_t)(x + w); ++i) {
+            ssd1306_framebuffer_put_pixel(ui->fbp, i, j, on);
+        }
+    }
+}
+
+static void gr_ui_mark_dirty(gr_ui_t *ui, const gr_ui_rect_t *r)
+{
+    for (unsigned p = r->y / 8; p <= (unsigned)(r->y + r->h - 1) / 8 && p < 32; ++p) {
+        ui->dirty_pages |= (1U << p);
+    }
+}
+
+/* grow r to also cover the inclusive box x0,y0 to x1,y1 clipped to the
+ * display. an empty box leaves r as it is */
+static void gr_ui_grow_rect(const gr_ui_t *ui, gr_ui_rect_t *r, int x0, int y0,
+                int x1, int y1)
+{
+    x0 = (x0 < 0) ? 0 : x0;
+    y0 = (y0 < 0) ? 0 : y0;
+    x1 = (x1 >= ui->fbp->width) ? ui->fbp->width - 1 : x1;
+    y1 = (y1 >= ui->fbp->height) ? ui->fbp->height - 1 : y1;
+    if (x1 < x0 || y1 < y0)
+        return;
+    int rx1 = r->x + r->w - 1, ry1 = r->y + r->h - 1;
+    x0 = (x0 < r->x) ? x0 : r->x;
+    y0 = (y0 < r->y) ? y0 : r->y;
+    x1 = (x1 > rx1) ? x1 : rx1;
+    y1 = (y1 > ry1) ? y1 : ry1;
+    r->x = (uint8_t)x0;
+    r->y = (uint8_t)y0;
+    r->w = (uint8_t)(x1 - x0 + 1);
+    r->h = (uint8_t)(y1 - y0 + 1);
+}
+
+/* copy the cached background into the framebuffer, clipped to the widget */
+static void gr_ui_blit_map(gr_ui_t *ui, const gr_ui_widget_t *wid, int x0,
+                int y0, int x1, int y1)
+{
+    const gr_ui_rect_t *r = &(wid->rect);
+    x0 = (x0 < 0) ? 0 : x0;
+    y0 = (y0 < 0) ? 0 : y0;
+    x1 = (x1 >= r->w) ? r->w - 1 : x1;
+    y1 = (y1 >= r->h) ? r->h - 1 : y1;
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            ssd1306_framebuffer_put_pixel(ui->fbp, r->x + x, r->y + y,
+                    GR_TRACKMAP_PIXEL(wid->bitmap, r->w, x, y) ? true : false);
+        }
+    }
+}
+
+static void gr_ui_draw_dot(gr_ui_t *ui, const gr_ui_widget_t *wid)
+{
+    const gr_ui_rect_t *r = &(wid->rect);
+    for (int y = wid->dot_y - GR_UI_DOT_RADIUS; y <= wid->dot_y + GR_UI_DOT_RADIUS; ++y) {
+        for (int x = wid->dot_x - GR_UI_DOT_RADIUS; x <= wid->dot_x + GR_UI_DOT_RADIUS; ++x) {
+            if (x >= 0 && y >= 0 && x < r->w && y < r->h) {
+                ssd1306_framebuffer_put_pixel(ui->fbp, r->x + x, r->y + y, true);
+            }
+        }
+    }
+}
+
+static void gr_ui_draw_map(gr_ui_t *ui, gr_ui_widget_t *wid, bool full,
+                int old_x, int old_y)
+{
+    const gr_ui_rect_t *r = &(wid->rect);
+    if (!wid->cached) {
+        ssd1306_framebuffer_box_t bbox = { 0 };
+        gr_ui_fill_rect(ui, r->x, r->y, r->w, r->h, false);
+        ssd1306_framebuffer_draw_text(ui->fbp, "no map", 0, r->x, r->y,
+                    SSD1306_FONT_DEFAULT, 1, &bbox);
+        return;
+    }
+    if (full) {
+        gr_ui_blit_map(ui, wid, 0, 0, r->w - 1, r->h - 1);
+    } else if (old_x >= 0) {
+        gr_ui_blit_map(ui, wid, old_x - GR_UI_DOT_RADIUS, old_y - GR_UI_DOT_RADIUS,
+                old_x + GR_UI_DOT_RADIUS, old_y + GR_UI_DOT_RADIUS);
+    }
+    if (wid->dot_x >= 0) {
+        gr_ui_draw_dot(ui, wid);
+    }
+}
+
+static void gr_ui_draw_widget(gr_ui_t *ui, gr_ui_widget_t *wid, int prev_fill)
+{
+    const gr_ui_rect_t *r = &(wid->rect);
+    if (wid->type == GR_UI_WIDGET_TEXT) {
+        /* the font decides how far the text goes, which can be past the
+         * rect, so the last text is wiped wherever it went */
+        ssd1306_framebuffer_box_t bbox = { 0 };
+        gr_ui_rect_t area = *r;
+        if (wid->drawn) {
+            gr_ui_grow_rect(ui, &area, wid->box.x, wid->box.y,
+                    wid->box.x + wid->box.w - 1, wid->box.y + wid->box.h - 1);
+        }
+        gr_ui_fill_rect(ui, area.x, area.y, area.w, area.h, false);
+        ssize_t nb;
+        if (ui->custom_font) {
+            nb = ssd1306_framebuffer_draw_text_extra(ui->fbp, wid->text, 0, r->x, r->y,
+                    SSD1306_FONT_CUSTOM, wid->fontsize, &(ui->opts), 1, &bbox);
+        } else {
+            nb = ssd1306_framebuffer_draw_text(ui->fbp, wid->text, 0, r->x, r->y,
+                    SSD1306_FONT_DEFAULT, wid->fontsize, &bbox);
+        }
+        wid->box = *r;
+        if (nb > 0) {
+            gr_ui_grow_rect(ui, &(wid->box), bbox.left, bbox.top, bbox.right, bbox.bottom);
+        }
+        gr_ui_grow_rect(ui, &area, wid->box.x, wid->box.y,
+                wid->box.x + wid->box.w - 1, wid->box.y + wid->box.h - 1);
+        gr_ui_mark_dirty(ui, &area);
+    } else {
+        /* outline, then only the part of the inside that changed */
+        int inner = r->w - 2;
+        int from = wid->drawn ? prev_fill : 0;
+        if (!wid->drawn) {
+            gr_ui_fill_rect(ui, r->x, r->y, r->w, r->h, false);
+            gr_ui_fill_rect(ui, r->x, r->y, r->w, 1, true);
+            gr_ui_fill_rect(ui, r->x, r->y + r->h - 1, r->w, 1, true);
+            gr_ui_fill_rect(ui, r->x, r->y, 1, r->h, true);
+            gr_ui_fill_rect(ui, r->x + r->w - 1, r->y, 1, r->h, true);
+        }
+        if (r->h > 2 && inner > 0) {
+            if (wid->fill > from) {
+                gr_ui_fill_rect(ui, r->x + 1 + from, r->y + 1, wid->fill - from, r->h - 2, true);
+            } else if (wid->fill < from) {
+                gr_ui_fill_rect(ui, r->x + 1 + wid->fill, r->y + 1, from - wid->fill, r->h - 2, false);
+            }
+        }
+    }
+    gr_ui_mark_dirty(ui, r);
+}
+
+int gr_ui_render(gr_ui_t *ui, const gr_fix_t *fix, const gr_lap_state_t *lap,
+                uint64_t now_ns)
+{
+    if (!ui)
+        return -1;
+    if (ui->num_screens == 0)
+        return 0;
+    uint64_t t0 = gr_monotonic_ns();
+    gr_ui_screen_t *scr = &(ui->screens[ui->current]);
+    if (ui->clear) {
+        ssd1306_framebuffer_clear(ui->fbp);
+        ui->dirty_pages = 0xFFFFFFFFU;
+        for (size_t i = 0; i < scr->num_widgets; ++i) {
+            scr->widgets[i].drawn = false;
+        }
+        ui->clear = false;
+    }
+    int drawn = 0;
+    for (size_t i = 0; i < scr->num_widgets; ++i) {
+        gr_ui_widget_t *wid = &(scr->widgets[i]);
+        char text[GR_UI_MAX_TEXT];
+        int prev_fill = 0;
+        if (wid->type == GR_UI_WIDGET_MAP) {
+            bool full = !wid->drawn;
+            if (!wid->cached && gr_trackmap_is_built(ui->map)) {
+                wid->cached = (gr_trackmap_rasterize(ui->map, wid->rect.w, wid->rect.h,
+                            wid->bitmap, GR_TRACKMAP_BITMAP_SIZE(wid->rect.w, wid->rect.h)) == 0);
+                full = true;
+            }
+            int x = -1, y = -1;
+            if (wid->cached && fix && GR_FIX_HAS_POSITION(fix)) {
+                gr_trackmap_locate(ui->map, wid->rect.w, wid->rect.h,
+                        fix->lat_e7, fix->lon_e7, &x, &y);
+            }
+            if (!full && x == wid->dot_x && y == wid->dot_y) {
+                ui->stats.widgets_skipped++;
+                continue;
+            }
+            int old_x = wid->dot_x, old_y = wid->dot_y;
+            wid->dot_x = x;
+            wid->dot_y = y;
+            gr_ui_draw_map(ui, wid, full, old_x, old_y);
+            gr_ui_mark_dirty(ui, &(wid->rect));
+            wid->drawn = true;
+            drawn++;
+            continue;
+        }
+        double num = gr_ui_format(wid->value, fix, lap, now_ns, text, sizeof(text));
+        if (wid->type == GR_UI_WIDGET_TEXT) {
+            if (wid->drawn && strcmp(text, wid->text) == 0) {
+                ui->stats.widgets_skipped++;
+                continue;
+            }
+            memcpy(wid->text, text, sizeof(wid->text));
+        } else {
+            int inner = wid->rect.w - 2;
+            double frac = (num > 0) ? (num / wid->max) : 0.0;
+            int fill = (int)lround((frac > 1.0 ? 1.0 : frac) * (inner > 0 ? inner : 0));
+            if (wid->drawn && fill == wid->fill) {
+                ui->stats.widgets_skipped++;
+                continue;
+            }
+            prev_fill = wid->fill;
+            wid->fill = fill;
+        }
+        gr_ui_draw_widget(ui, wid, prev_fill);
+        wid->drawn = true;
+        drawn++;
+    }
+    if (drawn > 0) {
+        ui->stats.frames++;
+        ui->stats.widgets_drawn += (uint64_t)drawn;
+    }
+    ui->stats.render_ns += gr_monotonic_ns() - t0;
+    return drawn;
+}
+
+uint32_t gr_ui_take_dirty_pages(gr_ui_t *ui)
+{
+    uint32_t pages = 0;
+    if (ui) {
+        pages = ui->dirty_pages;
+        ui->dirty_pages = 0;
+    }
+    return pages;
+}
+
+void gr_ui_get_stats(const gr_ui_t *ui, gr_ui_stats_t *stats)
+{
+    if (ui && stats) {
+        memcpy(stats, &(ui->stats), sizeof(*stats));
+    }
+}
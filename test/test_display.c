@@ -0,0 +1,191 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#include <CUnit/Basic.h>
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_laptimer.h>
+#include <goodracer_trackmap.h>
+#include <goodracer_ui.h>
+#include <goodracer_i2cbus.h>
+#include <goodracer_display.h>
+
+#ifndef GR_TEST_SRCDIR
+#define GR_TEST_SRCDIR "."
+#endif
+/* the golden frame of the minimap screen below, as the OLED shows it */
+#define TEST_GOLDEN_PBM GR_TEST_SRCDIR "/test_display.pbm"
+#define TEST_WIDTH 128
+#define TEST_HEIGHT 32
+
+/* a rectangular track of 0.004 degrees by 0.002 degrees with a point about
+ * every 10 meters, so the outline has only straight edges along the axes */
+#define TEST_LAT0 400000000
+#define TEST_LON0 -750000000
+#define TEST_DLAT 20000
+#define TEST_DLON 40000
+#define TEST_STEPS 20
+
+static gr_trackmap_t *test_display_track(void)
+{
+    gr_trackmap_t *map = gr_trackmap_create(GR_TRACKMAP_DEFAULT_POINTS);
+    if (!map)
+        return NULL;
+    const int32_t corners[5][2] = {
+        { TEST_LAT0, TEST_LON0 },
+        { TEST_LAT0, TEST_LON0 + TEST_DLON },
+        { TEST_LAT0 + TEST_DLAT, TEST_LON0 + TEST_DLON },
+        { TEST_LAT0 + TEST_DLAT, TEST_LON0 },
+        { TEST_LAT0, TEST_LON0 }
+    };
+    for (int c = 0; c < 4; ++c) {
+        for (int i = 0; i < TEST_STEPS; ++i) {
+            int32_t lat = corners[c][0] + (corners[c + 1][0] - corners[c][0]) / TEST_STEPS * i;
+            int32_t lon = corners[c][1] + (corners[c + 1][1] - corners[c][1]) / TEST_STEPS * i;
+            gr_trackmap_add_point(map, lat, lon);
+        }
+    }
+    if (gr_trackmap_build(map) < 0) {
+        gr_trackmap_free(map);
+        return NULL;
+    }
+    return map;
+}
+
+/* the minimap on the left and a speed bar on the right, neither of which
+ * draws text, so the frame does not depend on the fonts installed */
+static gr_disp_t *test_display_setup(const gr_trackmap_t *map)
+{
+    gr_disp_t *disp = gr_display_virtual_setup(TEST_WIDTH, TEST_HEIGHT, NULL);
+    if (!disp)
+        return NULL;
+    disp->ui = gr_ui_create(disp->fbp, NULL);
+    int scr = disp->ui ? gr_ui_add_screen(disp->ui, "test") : -1;
+    if (scr < 0 ||
+        gr_ui_add_map(disp->ui, scr, (gr_ui_rect_t){ 0, 0, TEST_WIDTH / 2, TEST_HEIGHT }) < 0 ||
+        gr_ui_add_bar(disp->ui, scr, GR_UI_VALUE_SPEED,
+            (gr_ui_rect_t){ TEST_WIDTH / 2 + 4, 8, TEST_WIDTH / 2 - 8, 16 }, 250.0f) < 0) {
+        gr_display_cleanup(disp);
+        return NULL;
+    }
+    gr_ui_set_trackmap(disp->ui, map);
+    return disp;
+}
+
+static void test_display_fix(gr_fix_t *fix, int32_t lat_e7, int32_t lon_e7,
+                float speed_kmph)
+{
+    fix->lat_e7 = lat_e7;
+    fix->lon_e7 = lon_e7;
+    fix->speed_kmph = speed_kmph;
+    fix->seq++;
+}
+
+/* lit pixels of the display RAM that differ from the golden PBM, -1 if the
+ * PBM cannot be read */
+static int test_display_compare(const uint8_t *ram, size_t len, const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return -1;
+    }
+    unsigned int w = 0, h = 0;
+    uint8_t rows[TEST_HEIGHT][TEST_WIDTH / 8];
+    int rc = -1;
+    /* a single whitespace character separates the header from the data */
+    if (fscanf(fp, "P4 %u %u", &w, &h) == 2 && fgetc(fp) != EOF &&
+        w == TEST_WIDTH && h == TEST_HEIGHT && len == sizeof(rows) &&
+        fread(rows, 1, sizeof(rows), fp) == sizeof(rows)) {
+        rc = 0;
+        for (unsigned int y = 0; y < h; ++y) {
+            for (unsigned int x = 0; x < w; ++x) {
+                int want = (rows[y][x / 8] >> (7 - (x % 8))) & 1;
+                int got = (ram[(y / 8) * w + x] >> (y % 8)) & 1;
+                if (want != got)
+                    rc++;
+            }
+        }
+    } else {
+        fprintf(stderr, "%s is not a %ux%u P4 PBM\n", path, TEST_WIDTH, TEST_HEIGHT);
+    }
+    fclose(fp);
+    return rc;
+}
+
+static void test_display_golden(void)
+{
+    gr_trackmap_t *map = test_display_track();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(map);
+    gr_disp_t *disp = test_display_setup(map);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(disp);
+    gr_fix_t fix;
+    gr_fix_init(&fix);
+    gr_lap_state_t lap;
+    memset(&lap, 0, sizeof(lap));
+
+    /* the first frame draws everything, the second only what changed */
+    test_display_fix(&fix, TEST_LAT0, TEST_LON0, 80.0f);
+    CU_ASSERT_EQUAL(gr_ui_render(disp->ui, &fix, &lap, 1000000000ULL), 2);
+    CU_ASSERT_EQUAL(gr_display_update(disp), 0);
+    test_display_fix(&fix, TEST_LAT0 + TEST_DLAT, TEST_LON0 + TEST_DLON / 2, 175.0f);
+    CU_ASSERT_EQUAL(gr_ui_render(disp->ui, &fix, &lap, 2000000000ULL), 2);
+    CU_ASSERT_EQUAL(gr_display_update(disp), 0);
+    CU_ASSERT_EQUAL(gr_display_virtual_frames(disp), 2);
+
+    size_t len = 0;
+    const uint8_t *ram = gr_display_virtual_ram(disp, &len);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(ram);
+    CU_ASSERT_EQUAL(len, TEST_WIDTH * TEST_HEIGHT / 8);
+    CU_ASSERT_EQUAL(test_display_compare(ram, len, TEST_GOLDEN_PBM), 0);
+
+    /* the same fix drawn from scratch gives the same frame */
+    gr_disp_t *full = test_display_setup(map);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(full);
+    CU_ASSERT_EQUAL(gr_ui_render(full->ui, &fix, &lap, 2000000000ULL), 2);
+    CU_ASSERT_EQUAL(gr_display_update(full), 0);
+    size_t full_len = 0;
+    const uint8_t *full_ram = gr_display_virtual_ram(full, &full_len);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(full_ram);
+    CU_ASSERT_EQUAL(full_len, len);
+    CU_ASSERT(memcmp(full_ram, ram, len) == 0);
+
+    gr_display_cleanup(full);
+    gr_display_cleanup(disp);
+    gr_trackmap_free(map);
+}
+
+int main(void)
+{
+    if (CU_initialize_registry() != CUE_SUCCESS)
+        return CU_get_error();
+    CU_pSuite suite = CU_add_suite("display", NULL, NULL);
+    if (!suite ||
+        !CU_add_test(suite, "virtual display golden frame", test_display_golden)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    unsigned int failures = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    return (failures > 0) ? 1 : 0;
+}
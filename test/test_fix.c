@@ -0,0 +1,141 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_MATH_H
+#include <math.h>
+#endif
+#include <CUnit/Basic.h>
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+
+/* what the parser gives for GGA (position, no speed), RMC (position and
+ * speed) and VTG (speed only) */
+typedef enum {
+    TEST_GGA,
+    TEST_RMC,
+    TEST_VTG
+} test_sentence_t;
+
+static void test_fix_item(gpsdata_data_t *item, test_sentence_t type,
+                int second, float minutes, float speed_kmph)
+{
+    memset(item, 0, sizeof(*item));
+    item->latitude.direction = GPSDATA_DIRECTION_UNSET;
+    item->longitude.direction = GPSDATA_DIRECTION_UNSET;
+    item->speed_kmph = (type == TEST_GGA) ? NAN : speed_kmph;
+    if (type != TEST_VTG) {
+        item->utc_time.hour = 12;
+        item->utc_time.minute = 30;
+        item->utc_time.second = (uint8_t)second;
+        item->latitude.degrees = 40;
+        item->latitude.minutes = minutes;
+        item->latitude.direction = GPSDATA_DIRECTION_NORTH;
+        item->longitude.degrees = 75;
+        item->longitude.minutes = 1.5f;
+        item->longitude.direction = GPSDATA_DIRECTION_WEST;
+    }
+}
+
+static int test_fix_feed(gr_fix_t *fix, test_sentence_t type, int second,
+                float minutes, float speed_kmph)
+{
+    gpsdata_data_t item;
+    test_fix_item(&item, type, second, minutes, speed_kmph);
+    return gr_fix_update(fix, &item, (uint64_t)second * 1000000000ULL);
+}
+
+static void test_fix_gga_rmc_vtg(void)
+{
+    gr_fix_t fix;
+    gr_fix_init(&fix);
+    CU_ASSERT(!GR_FIX_HAS_POSITION(&fix));
+    for (int s = 0; s < 3; ++s) {
+        float speed = 50.0f + 10.0f * s;
+        /* the GGA alone is not the epoch yet */
+        CU_ASSERT_EQUAL(test_fix_feed(&fix, TEST_GGA, s, 1.0f + s, 0), 0);
+        CU_ASSERT_EQUAL(fix.seq, (uint32_t)s);
+        CU_ASSERT_EQUAL(test_fix_feed(&fix, TEST_RMC, s, 1.0f + s, speed), 1);
+        CU_ASSERT_EQUAL(fix.seq, (uint32_t)s + 1);
+        CU_ASSERT_EQUAL(fix.speed_kmph, speed);
+        CU_ASSERT_EQUAL(fix.utc_ms, (int64_t)((12 * 60 + 30) * 60 + s) * 1000);
+        CU_ASSERT_EQUAL(fix.mono_ns, (uint64_t)s * 1000000000ULL);
+        CU_ASSERT_EQUAL(test_fix_feed(&fix, TEST_VTG, s, 0, speed), 0);
+    }
+    CU_ASSERT(GR_FIX_HAS_POSITION(&fix));
+    CU_ASSERT_EQUAL(fix.lat_e7, GR_FIX_DEG_TO_E7(40.0 + 3.0 / 60.0));
+    CU_ASSERT_EQUAL(fix.lon_e7, GR_FIX_DEG_TO_E7(-(75.0 + 1.5 / 60.0)));
+}
+
+static void test_fix_rmc_first(void)
+{
+    gr_fix_t fix;
+    gr_fix_init(&fix);
+    CU_ASSERT_EQUAL(test_fix_feed(&fix, TEST_RMC, 0, 1.0f, 80.0f), 1);
+    CU_ASSERT_EQUAL(test_fix_feed(&fix, TEST_GGA, 0, 1.0f, 0), 0);
+    CU_ASSERT_EQUAL(test_fix_feed(&fix, TEST_VTG, 0, 0, 80.0f), 0);
+    CU_ASSERT_EQUAL(test_fix_feed(&fix, TEST_RMC, 1, 1.1f, 90.0f), 1);
+    CU_ASSERT_EQUAL(fix.seq, 2);
+    CU_ASSERT_EQUAL(fix.speed_kmph, 90.0f);
+}
+
+static void test_fix_gga_only(void)
+{
+    gr_fix_t fix;
+    gr_fix_init(&fix);
+    /* without a speed the first epoch is given up on, then every GGA is one */
+    CU_ASSERT_EQUAL(test_fix_feed(&fix, TEST_GGA, 0, 1.0f, 0), 0);
+    CU_ASSERT_EQUAL(test_fix_feed(&fix, TEST_GGA, 1, 1.1f, 0), 1);
+    CU_ASSERT_EQUAL(test_fix_feed(&fix, TEST_GGA, 2, 1.2f, 0), 1);
+    CU_ASSERT_EQUAL(fix.seq, 2);
+    CU_ASSERT(isnan(fix.speed_kmph));
+    /* once speeds show up again the epoch waits for them */
+    CU_ASSERT_EQUAL(test_fix_feed(&fix, TEST_RMC, 2, 1.2f, 30.0f), 0);
+    CU_ASSERT_EQUAL(test_fix_feed(&fix, TEST_GGA, 3, 1.3f, 0), 0);
+    CU_ASSERT_EQUAL(test_fix_feed(&fix, TEST_RMC, 3, 1.3f, 35.0f), 1);
+    CU_ASSERT_EQUAL(fix.seq, 3);
+    CU_ASSERT_EQUAL(fix.speed_kmph, 35.0f);
+}
+
+static void test_fix_nmea_utc(void)
+{
+    const char *gga = "$GPGGA,123519.250,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47";
+    const char *vtg = "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48";
+    CU_ASSERT_EQUAL(gr_nmea_utc_ms(gga, strlen(gga)), ((12 * 60 + 35) * 60 + 19) * 1000 + 250);
+    CU_ASSERT_EQUAL(gr_nmea_utc_ms(vtg, strlen(vtg)), -1);
+    CU_ASSERT_EQUAL(gr_nmea_utc_ms("$GPRMC,,V", 9), -1);
+}
+
+int main(void)
+{
+    if (CU_initialize_registry() != CUE_SUCCESS)
+        return CU_get_error();
+    CU_pSuite suite = CU_add_suite("fix", NULL, NULL);
+    if (!suite ||
+        !CU_add_test(suite, "GGA, RMC and VTG epochs", test_fix_gga_rmc_vtg) ||
+        !CU_add_test(suite, "RMC before GGA", test_fix_rmc_first) ||
+        !CU_add_test(suite, "GGA only", test_fix_gga_only) ||
+        !CU_add_test(suite, "NMEA UTC time", test_fix_nmea_utc)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    unsigned int failures = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    return (failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#include <CUnit/Basic.h>
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_i2cbus.h>
+
+#define TEST_DISPLAY_ADDR 0x3C
+#define TEST_SENSOR_ADDR 0x68
+#define TEST_SENSOR_REG 0x3B
+#define TEST_PAGES 4
+#define TEST_PAGE_BYTES 16
+
+typedef struct {
+    int order[2 * TEST_PAGES];
+    size_t count;
+    uint8_t rbuf[GR_I2CBUS_MAX_READ];
+    size_t rlen;
+} test_done_t;
+
+static test_done_t test_done;
+/* one per transaction so the callback knows which one finished */
+static int test_ids[2 * TEST_PAGES];
+
+static void test_i2cbus_done(int rc, const uint8_t *rbuf, size_t rlen, void *arg)
+{
+    int id = *(const int *)arg;
+    CU_ASSERT_EQUAL(rc, 0);
+    if (test_done.count < 2 * TEST_PAGES)
+        test_done.order[test_done.count++] = id;
+    if (rlen > 0) {
+        memcpy(test_done.rbuf, rbuf, rlen);
+        test_done.rlen = rlen;
+    }
+}
+
+static int test_i2cbus_page(gr_i2cbus_t *bus, int page, uint8_t fill)
+{
+    uint8_t wbuf[1 + TEST_PAGE_BYTES];
+    wbuf[0] = (uint8_t)(page * TEST_PAGE_BYTES);
+    memset(&wbuf[1], fill, TEST_PAGE_BYTES);
+    gr_i2cbus_txn_t txn = {
+        .addr = TEST_DISPLAY_ADDR,
+        .priority = GR_I2CBUS_PRIO_DISPLAY,
+        .tag = (uint32_t)(page + 1),
+        .wbuf = wbuf,
+        .wlen = sizeof(wbuf),
+        .cb = test_i2cbus_done,
+        .arg = &test_ids[page]
+    };
+    return gr_i2cbus_submit(bus, &txn);
+}
+
+static void test_i2cbus_schedule(void)
+{
+    memset(&test_done, 0, sizeof(test_done));
+    for (int i = 0; i < 2 * TEST_PAGES; ++i)
+        test_ids[i] = i;
+    /* 1 MHz keeps the simulated transfers short */
+    gr_i2cbus_t *bus = gr_i2cbus_mock_setup(1000000);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(bus);
+    CU_ASSERT_EQUAL(gr_i2cbus_mock_add_device(bus, TEST_DISPLAY_ADDR), 0);
+    CU_ASSERT_EQUAL(gr_i2cbus_mock_add_device(bus, TEST_SENSOR_ADDR), 0);
+
+    /* load the sensor registers the read below will fetch */
+    const uint8_t sample[] = { TEST_SENSOR_REG, 1, 2, 3, 4, 5, 6 };
+    gr_i2cbus_txn_t load = {
+        .addr = TEST_SENSOR_ADDR,
+        .priority = GR_I2CBUS_PRIO_CONTROL,
+        .wbuf = sample,
+        .wlen = sizeof(sample)
+    };
+    CU_ASSERT_EQUAL(gr_i2cbus_submit(bus, &load), 0);
+    CU_ASSERT_EQUAL(gr_i2cbus_run(bus, 0), 1);
+
+    /* a full frame of pages is queued before the sensor read */
+    for (int page = 0; page < TEST_PAGES; ++page) {
+        CU_ASSERT_EQUAL(test_i2cbus_page(bus, page, (uint8_t)(page + 1)), 0);
+    }
+    const uint8_t reg = TEST_SENSOR_REG;
+    gr_i2cbus_txn_t read = {
+        .addr = TEST_SENSOR_ADDR,
+        .priority = GR_I2CBUS_PRIO_SENSOR,
+        .wbuf = &reg,
+        .wlen = 1,
+        .rlen = 6,
+        .cb = test_i2cbus_done,
+        .arg = &test_ids[TEST_PAGES]
+    };
+    CU_ASSERT_EQUAL(gr_i2cbus_submit(bus, &read), 0);
+    /* a newer frame replaces the queued page in place */
+    CU_ASSERT_EQUAL(test_i2cbus_page(bus, 2, 0xAA), 0);
+    CU_ASSERT_EQUAL(gr_i2cbus_pending(bus), TEST_PAGES + 1);
+
+    CU_ASSERT_EQUAL(gr_i2cbus_run(bus, UINT64_MAX), TEST_PAGES + 1);
+    CU_ASSERT_EQUAL(gr_i2cbus_pending(bus), 0);
+    CU_ASSERT_EQUAL_FATAL(test_done.count, TEST_PAGES + 1);
+    /* the read goes ahead of the pages, which keep their order */
+    CU_ASSERT_EQUAL(test_done.order[0], TEST_PAGES);
+    for (int page = 0; page < TEST_PAGES; ++page) {
+        CU_ASSERT_EQUAL(test_done.order[page + 1], page);
+    }
+    CU_ASSERT_EQUAL(test_done.rlen, 6);
+    CU_ASSERT(memcmp(test_done.rbuf, &sample[1], 6) == 0);
+
+    const uint8_t *ram = gr_i2cbus_mock_registers(bus, TEST_DISPLAY_ADDR);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(ram);
+    for (int page = 0; page < TEST_PAGES; ++page) {
+        uint8_t fill = (page == 2) ? 0xAA : (uint8_t)(page + 1);
+        for (int i = 0; i < TEST_PAGE_BYTES; ++i) {
+            CU_ASSERT_EQUAL(ram[page * TEST_PAGE_BYTES + i], fill);
+        }
+    }
+
+    gr_i2cbus_stats_t st = { 0 };
+    CU_ASSERT_EQUAL(gr_i2cbus_get_stats(bus, TEST_DISPLAY_ADDR, &st), 0);
+    CU_ASSERT_EQUAL(st.transactions, TEST_PAGES);
+    CU_ASSERT_EQUAL(st.bytes, TEST_PAGES * (1 + TEST_PAGE_BYTES));
+    CU_ASSERT_EQUAL(st.superseded, 1);
+    CU_ASSERT_EQUAL(st.errors, 0);
+    CU_ASSERT(st.bus_ns > 0);
+    CU_ASSERT(st.max_txn_ns <= st.bus_ns);
+    memset(&st, 0, sizeof(st));
+    CU_ASSERT_EQUAL(gr_i2cbus_get_stats(bus, TEST_SENSOR_ADDR, &st), 0);
+    CU_ASSERT_EQUAL(st.transactions, 2);
+    CU_ASSERT_EQUAL(st.bytes, sizeof(sample) + 1 + 6);
+    CU_ASSERT_EQUAL(st.superseded, 0);
+    CU_ASSERT_EQUAL(st.errors, 0);
+    CU_ASSERT_EQUAL(gr_i2cbus_get_stats(bus, 0x10, &st), -1);
+
+    gr_i2cbus_cleanup(bus);
+}
+
+static void test_i2cbus_invalid(void)
+{
+    gr_i2cbus_t *bus = gr_i2cbus_mock_setup(1000000);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(bus);
+    CU_ASSERT_EQUAL(gr_i2cbus_mock_add_device(bus, 0x80), -1);
+    gr_i2cbus_txn_t empty = { .addr = TEST_SENSOR_ADDR };
+    CU_ASSERT_EQUAL(gr_i2cbus_submit(bus, &empty), -1);
+    /* a device that is not on the bus fails the transfer, not the submit */
+    const uint8_t reg = 0;
+    gr_i2cbus_txn_t txn = { .addr = 0x10, .wbuf = &reg, .wlen = 1 };
+    CU_ASSERT_EQUAL(gr_i2cbus_submit(bus, &txn), 0);
+    CU_ASSERT_EQUAL(gr_i2cbus_run(bus, UINT64_MAX), 1);
+    gr_i2cbus_stats_t st = { 0 };
+    CU_ASSERT_EQUAL(gr_i2cbus_get_stats(bus, 0x10, &st), 0);
+    CU_ASSERT_EQUAL(st.errors, 1);
+    gr_i2cbus_cleanup(bus);
+    CU_ASSERT_EQUAL(gr_i2cbus_mock_setup(0), NULL);
+}
+
+int main(void)
+{
+    if (CU_initialize_registry() != CUE_SUCCESS)
+        return CU_get_error();
+    CU_pSuite suite = CU_add_suite("i2cbus", NULL, NULL);
+    if (!suite ||
+        !CU_add_test(suite, "priority, replacement and stats", test_i2cbus_schedule) ||
+        !CU_add_test(suite, "invalid use", test_i2cbus_invalid)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    unsigned int failures = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    return (failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright: 2015-2020. Stealthy Labs LLC. All Rights Reserved.
+ * Date: 18 Oct 2026
+ * Software: GoodRacer
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for the pseudo terminal */
+#endif
+#include <goodracer_config.h>
+#ifdef GOODRACER_HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#ifdef GOODRACER_HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef GOODRACER_HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifdef GOODRACER_HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef GOODRACER_HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef GOODRACER_HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef GOODRACER_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef GOODRACER_HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#include <time.h>
+#include <ev.h>
+#include <CUnit/Basic.h>
+#include <goodracer_utils.h>
+#include <goodracer_fix.h>
+#include <goodracer_laptimer.h>
+#include <goodracer_telemetry.h>
+#include <goodracer_shm.h>
+#include <goodracer_bus.h>
+#include <goodracer_fixlog.h>
+#include <goodracer_trackmap.h>
+#include <goodracer_history.h>
+#include <goodracer_ui.h>
+#include <goodracer_i2cbus.h>
+#include <goodracer_display.h>
+#include <goodracer_rt.h>
+#include <goodracer_system.h>
+
+/* the GPS is the slave side of a pseudo terminal and the test writes the
+ * NMEA sentences of the MTK3339 into the master side */
+typedef struct {
+    gr_sys_t *sys;
+    int master;
+    int second;
+    uint32_t published;
+    float last_kmph;
+    gr_power_mode_t last_mode;
+} test_power_t;
+
+static void test_power_consumer(const gr_bus_record_t *rec, void *arg)
+{
+    test_power_t *tp = (test_power_t *)arg;
+    tp->published++;
+    tp->last_kmph = rec->fix.speed_kmph;
+    tp->last_mode = gr_system_get_power_mode(tp->sys);
+}
+
+static void test_power_sentence(test_power_t *tp, const char *body)
+{
+    char buf[128];
+    uint8_t cs = 0;
+    for (const char *c = body; *c != '\0'; ++c)
+        cs ^= (uint8_t)*c;
+    int len = snprintf(buf, sizeof(buf), "$%s*%02X\r\n", body, cs);
+    CU_ASSERT_EQUAL(write(tp->master, buf, (size_t)len), len);
+}
+
+static void test_power_gga(test_power_t *tp)
+{
+    char body[100];
+    snprintf(body, sizeof(body),
+            "GPGGA,1200%02d.000,4000.0000,N,07500.0000,W,1,08,0.9,10.0,M,-34.0,M,,",
+            tp->second);
+    test_power_sentence(tp, body);
+}
+
+static void test_power_rmc(test_power_t *tp, float kmph)
+{
+    char body[100];
+    snprintf(body, sizeof(body),
+            "GPRMC,1200%02d.000,A,4000.0000,N,07500.0000,W,%0.2f,0.00,181026,,,A",
+            tp->second, kmph / 1.852);
+    test_power_sentence(tp, body);
+}
+
+static void test_power_vtg(test_power_t *tp, float kmph)
+{
+    char body[100];
+    snprintf(body, sizeof(body), "GPVTG,0.00,T,,M,%0.2f,N,%0.2f,K,A",
+            kmph / 1.852, kmph);
+    test_power_sentence(tp, body);
+}
+
+/* run the event loop until something is published or for a while */
+static void test_power_run(test_power_t *tp, uint32_t published, int max_ms)
+{
+    for (int i = 0; i < max_ms && tp->published == published; ++i) {
+        ev_run(EV_DEFAULT, EVRUN_NOWAIT);
+        struct timespec ts = { .tv_sec = 0, .tv_nsec = 1000000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+/* read what the system sent to the GPS */
+static bool test_power_sent(test_power_t *tp, const char *cmd)
+{
+    char buf[1024];
+    ssize_t nb = read(tp->master, buf, sizeof(buf) - 1);
+    if (nb <= 0)
+        return false;
+    buf[nb] = '\0';
+    return strstr(buf, cmd) != NULL;
+}
+
+static gr_gps_t *test_power_setup(test_power_t *tp)
+{
+    memset(tp, 0, sizeof(*tp));
+    tp->master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (tp->master < 0 || grantpt(tp->master) < 0 || unlockpt(tp->master) < 0)
+        return NULL;
+    fcntl(tp->master, F_SETFL, fcntl(tp->master, F_GETFL) | O_NONBLOCK);
+    tp->sys = gr_system_setup(NULL);
+    if (!tp->sys)
+        return NULL;
+    gr_gps_t *gps = gr_gps_setup(ptsname(tp->master), 9600);
+    gr_power_config_t cfg;
+    gr_power_config_init(&cfg);
+    cfg.idle_after_ms = 100;
+    if (!gps || gr_system_watch_gps(tp->sys, gps, NULL, NULL) < 0 ||
+        gr_system_subscribe(tp->sys, "test", test_power_consumer, tp, false) < 0 ||
+        gr_system_set_power(tp->sys, &cfg) < 0) {
+        gr_gps_cleanup(gps);
+        return NULL;
+    }
+    return gps;
+}
+
+static void test_power_cleanup(test_power_t *tp, gr_gps_t *gps)
+{
+    gr_gps_cleanup(gps);
+    gr_system_cleanup(tp->sys);
+    if (tp->master >= 0)
+        close(tp->master);
+}
+
+/* stationary epochs until the power saving kicks in */
+static bool test_power_go_idle(test_power_t *tp)
+{
+    for (int i = 0; i < 50; ++i, tp->second = (tp->second + 1) % 60) {
+        uint32_t published = tp->published;
+        test_power_gga(tp);
+        test_power_rmc(tp, 0.0f);
+        test_power_run(tp, published, 1000);
+        if (tp->published != published + 1)
+            return false;
+        if (gr_system_get_power_mode(tp->sys) == GR_POWER_MODE_IDLE)
+            return test_power_sent(tp, "$PMTK220,5000*");
+        struct timespec ts = { .tv_sec = 0, .tv_nsec = 20000000 };
+        nanosleep(&ts, NULL);
+    }
+    return false;
+}
+
+static void test_power_wakeup(void)
+{
+    test_power_t tp;
+    gr_gps_t *gps = test_power_setup(&tp);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(gps);
+    CU_ASSERT_FATAL(test_power_go_idle(&tp));
+
+    /* the car moves off: the GGA alone is no epoch yet, the RMC of the same
+     * epoch wakes everything up and is published with its own speed */
+    tp.second = (tp.second + 1) % 60;
+    uint32_t published = tp.published;
+    test_power_gga(&tp);
+    test_power_run(&tp, published, 100);
+    CU_ASSERT_EQUAL(tp.published, published);
+    CU_ASSERT_EQUAL(gr_system_get_power_mode(tp.sys), GR_POWER_MODE_IDLE);
+    test_power_rmc(&tp, 30.0f);
+    test_power_run(&tp, published, 1000);
+    CU_ASSERT_EQUAL(tp.published, published + 1);
+    CU_ASSERT(tp.last_kmph > 29.9f && tp.last_kmph < 30.1f);
+    CU_ASSERT_EQUAL(tp.last_mode, GR_POWER_MODE_ACTIVE);
+    CU_ASSERT_EQUAL(gr_system_get_power_mode(tp.sys), GR_POWER_MODE_ACTIVE);
+    CU_ASSERT(test_power_sent(&tp, "$PMTK220,1000*"));
+
+    gr_power_stats_t st;
+    CU_ASSERT_EQUAL(gr_system_get_power_stats(tp.sys, &st), 0);
+    CU_ASSERT_EQUAL(st.modes[GR_POWER_MODE_IDLE].entered, 1);
+    CU_ASSERT_EQUAL(st.modes[GR_POWER_MODE_ACTIVE].entered, 2);
+    test_power_cleanup(&tp, gps);
+}
+
+static void test_power_wakeup_vtg(void)
+{
+    test_power_t tp;
+    gr_gps_t *gps = test_power_setup(&tp);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(gps);
+    CU_ASSERT_FATAL(test_power_go_idle(&tp));
+
+    /* a speed that completes no epoch still counts */
+    uint32_t published = tp.published;
+    test_power_vtg(&tp, 20.0f);
+    for (int i = 0; i < 1000 && gr_system_get_power_mode(tp.sys) == GR_POWER_MODE_IDLE; ++i) {
+        test_power_run(&tp, published, 1);
+    }
+    CU_ASSERT_EQUAL(tp.published, published);
+    CU_ASSERT_EQUAL(gr_system_get_power_mode(tp.sys), GR_POWER_MODE_ACTIVE);
+    test_power_cleanup(&tp, gps);
+}
+
+int main(void)
+{
+    if (CU_initialize_registry() != CUE_SUCCESS)
+        return CU_get_error();
+    CU_pSuite suite = CU_add_suite("power", NULL, NULL);
+    if (!suite ||
+        !CU_add_test(suite, "idle to active on the first moving RMC", test_power_wakeup) ||
+        !CU_add_test(suite, "idle to active on a moving VTG", test_power_wakeup_vtg)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    unsigned int failures = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    return (failures > 0) ? 1 : 0;
+}